@@ -0,0 +1,38 @@
+// C/C++
+#include <cmath>
+#include <string>
+#include <vector>
+
+// application
+#include <application/application.hpp>
+
+// bench
+#include "bench.hpp"
+
+// Throughput of the array health check per instruction set, on a field of
+// 2^24 elements that is mostly valid. Bytes per second are the element
+// size times 2^24 times ops/sec.
+
+template <typename T>
+void run(Bench* bench, char const* name) {
+  size_t n = 1 << 24;
+  std::vector<T> field(n);
+  for (size_t i = 0; i < n; ++i) field[i] = std::sin(1.e-3 * i);
+  field[n / 3] = NAN;
+
+  for (auto isa : {CheckISA::kScalar, CheckISA::kAVX2, CheckISA::kAVX512}) {
+    bench->Run(std::string("CheckArray ") + name + " " + GetCheckISAName(isa),
+               [&]() { CheckArray(field.data(), n, -1., 1., isa); });
+  }
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  Bench bench("array_check");
+  bench.SetBatch(1);
+  run<float>(&bench, "float");
+  run<double>(&bench, "double");
+
+  Application::Destroy();
+}
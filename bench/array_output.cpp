@@ -0,0 +1,42 @@
+// C/C++
+#include <sstream>
+#include <vector>
+
+// application
+#include <application/application.hpp>
+
+// bench
+#include "bench.hpp"
+
+// Cost of logging a field of 10^6 doubles as text, through operator<< and
+// through the bulk formatter, and as a reference into a binary sidecar
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("text", "array_text.out", "array_text.err");
+  app->InstallMonitor("sidecar", "array_sidecar.out", "array_sidecar.err");
+
+  auto text = app->GetMonitor("text");
+  auto sidecar = app->GetMonitor("sidecar");
+  sidecar->SetSidecar("array_sidecar.bin");
+
+  std::vector<double> field(1000000);
+  for (size_t i = 0; i < field.size(); ++i) field[i] = 1. / (i + 1.);
+
+  auto device = app->GetDevice("array_text.out");
+  auto stream = [&]() {
+    std::ostringstream ss;
+    for (auto v : field) ss << v << " ";
+    device->Write(ss.str());
+  };
+
+  Bench bench("array_output");
+  bench.SetBatch(1);
+  bench.Run("field operator<<", stream);
+  bench.Run("field bulk to_chars", [&]() { text->Log("field", field); });
+  bench.Run("field binary sidecar", [&]() { sidecar->Log("field", field); });
+
+  Application::Destroy();
+}
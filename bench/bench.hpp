@@ -0,0 +1,145 @@
+#ifndef BENCH_BENCH_HPP_
+#define BENCH_BENCH_HPP_
+
+// C/C++
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! Minimal harness running a function under 1..N threads
+/*!
+ * Each measurement runs the function in a loop on nthreads threads for a
+ * fixed wall time and reports
+ *
+ *   ns/op    average wall time of one call on one thread
+ *   ops/sec  calls completed per second by all threads together
+ *
+ * Thread counts are 1, 2, 4, ... up to N, N included. N is taken from the
+ * environment variable BENCH_THREADS and defaults to the number of
+ * hardware threads. The measurement time per point is BENCH_SECONDS,
+ * 0.2 by default. Results are printed as a table and written to
+ * <suite>.json when the suite is destroyed, for comparison between
+ * releases.
+ */
+class Bench {
+ public:
+  explicit Bench(std::string const& suite) : suite_(suite) {
+    char const* env = std::getenv("BENCH_THREADS");
+    max_threads_ = env != nullptr ? std::atoi(env)
+                                  : std::thread::hardware_concurrency();
+    max_threads_ = std::max(max_threads_, 1);
+
+    env = std::getenv("BENCH_SECONDS");
+    seconds_ = env != nullptr ? std::atof(env) : 0.2;
+
+    printf("%-40s %8s %12s %14s\n", "benchmark", "threads", "ns/op",
+           "ops/sec");
+  }
+
+  ~Bench() { write(); }
+
+  //! Calls between checks of the stop flag, 64 by default
+  /*!
+   * Functions that take milliseconds per call, e.g. on a large array, are
+   * measured with a batch of 1 so that a point does not overrun its time.
+   */
+  void SetBatch(int batch) { batch_ = std::max(batch, 1); }
+
+  //! Measure func under 1..min(N, max_threads) threads
+  template <typename F>
+  void Run(std::string const& name, F func, int max_threads = 1 << 30) {
+    int nmax = std::min(max_threads_, max_threads);
+
+    for (int nthreads = 1;; nthreads = std::min(2 * nthreads, nmax)) {
+      measure(name, func, nthreads);
+      if (nthreads == nmax) break;
+    }
+  }
+
+ protected:
+  struct Result {
+    std::string name;
+    int threads;
+    double ns_per_op;
+    double ops_per_sec;
+  };
+
+  template <typename F>
+  void measure(std::string const& name, F func, int nthreads) {
+    const int batch = batch_;
+
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false), stop(false);
+    std::vector<uint64_t> ops(nthreads, 0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t) {
+      threads.emplace_back([&, t]() {
+        ready++;
+        while (!go.load(std::memory_order_acquire)) {
+        }
+
+        uint64_t n = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+          for (int i = 0; i < batch; ++i) func();
+          n += batch;
+        }
+        ops[t] = n;
+      });
+    }
+
+    while (ready.load() < nthreads) {
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds_));
+    stop.store(true, std::memory_order_relaxed);
+
+    for (auto& th : threads) th.join();
+    auto t1 = std::chrono::steady_clock::now();
+
+    double elapsed = std::chrono::duration<double>(t1 - t0).count();
+    uint64_t total = 0;
+    for (auto n : ops) total += n;
+
+    Result result = {name, nthreads, 1.e9 * elapsed * nthreads / total,
+                     total / elapsed};
+    results_.push_back(result);
+
+    printf("%-40s %8d %12.2f %14.4g\n", name.c_str(), nthreads,
+           result.ns_per_op, result.ops_per_sec);
+  }
+
+  void write() const {
+    std::ofstream out(suite_ + ".json");
+
+    out << "{\"suite\": \"" << suite_ << "\", \"results\": [";
+    for (size_t i = 0; i < results_.size(); ++i) {
+      auto const& r = results_[i];
+      char buf[64];
+      out << (i > 0 ? ",\n  " : "\n  ") << "{\"name\": \"" << r.name
+          << "\", \"threads\": " << r.threads;
+      snprintf(buf, sizeof(buf), ", \"ns_per_op\": %.3f", r.ns_per_op);
+      out << buf;
+      snprintf(buf, sizeof(buf), ", \"ops_per_sec\": %.6g}", r.ops_per_sec);
+      out << buf;
+    }
+    out << "\n]}\n";
+  }
+
+  std::string suite_;
+  int max_threads_;
+  double seconds_;
+  int batch_ = 64;
+  std::vector<Result> results_;
+};
+
+#endif  // BENCH_BENCH_HPP_
@@ -0,0 +1,129 @@
+// C/C++
+#include <fstream>
+#include <string>
+#include <vector>
+
+// POSIX C extensions
+#include <sys/stat.h>  // mkdir()
+
+// application
+#include <application/application.hpp>
+#include <application/arena.hpp>
+#include <application/exceptions.hpp>
+#include <application/rate_limit.hpp>
+#include <application/signal.hpp>
+
+// bench
+#include "bench.hpp"
+
+// Hot paths of the library under 1..N threads, written to hot_paths.json
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("bench", "hot_paths.out", "hot_paths.err");
+  auto monitor = app->GetMonitor("bench");
+
+  Bench bench("hot_paths");
+
+  // Monitor::Log and its overloads
+  double x = 3.14159;
+  int ia[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+  std::vector<double> va(16, 2.5);
+  std::vector<std::string> sa(4, "word");
+
+  bench.Run("Monitor::Log(msg)", [&]() { monitor->Log("message"); });
+  bench.Run("Monitor::Log(msg, double)", [&]() { monitor->Log("x", x); });
+  bench.Run("Monitor::Log(msg, int*, 16)",
+            [&]() { monitor->Log("ia", ia, 16); });
+  bench.Run("Monitor::Log(msg, vector<double>(16))",
+            [&]() { monitor->Log("va", va); });
+  bench.Run("Monitor::Log(msg, vector<string>(4))",
+            [&]() { monitor->Log("sa", sa); });
+  bench.Run("Monitor::Log(msg, double*, {4, 4})",
+            [&]() { monitor->Log("va", va.data(), {4, 4}); });
+  bench.Run("Monitor::Warn(msg)", [&]() { monitor->Warn("warning"); });
+  bench.Run("Monitor::Log(msg, 2 fields)",
+            [&]() { monitor->Log("step", {"x", x}, {"i", 7}); });
+
+  // suppressed warnings after the first occurrence
+  bench.Run("APP_WARN_ONCE", [&]() { APP_WARN_ONCE(monitor, "once"); });
+  bench.Run("APP_WARN_LIMITED(every 1000)",
+            [&]() { APP_WARN_LIMITED(monitor, 1000, 0, 1., "limited"); });
+
+  app->InstallMonitor("dedup", "hot_paths.out", "hot_paths.err");
+  auto dedup = app->GetMonitor("dedup");
+  dedup->SetDeduplicate(true);
+
+  bench.Run("Monitor::Warn(msg) deduplicated",
+            [&]() { dedup->Warn("duplicate"); });
+
+  app->InstallMonitor("json", "hot_paths.jsonl", "hot_paths.jsonl");
+  auto json = app->GetMonitor("json");
+  json->SetFormat(Monitor::kJSON);
+
+  bench.Run("Monitor::Log(msg, 2 fields) as JSON",
+            [&]() { json->Log("step", {"x", x}, {"i", 7}); });
+
+  app->InstallMonitor("shm", "shm:hot_paths", "shm:hot_paths");
+  auto shm = app->GetMonitor("shm");
+
+  bench.Run("Monitor::Log(msg, 2 fields) to shm ring",
+            [&]() { shm->Log("step", {"x", x}, {"i", 7}); });
+
+  // commits of full buffers written in the background
+  app->InstallMonitor("async", "async:hot_paths_async.out", "hot_paths.err");
+  auto async = app->GetMonitor("async");
+
+  bench.Run("Monitor::Log(msg) to async file",
+            [&]() { async->Log("message"); });
+
+  // Logger sections
+  bench.Run("Logger(name)", []() { Application::Logger log("bench"); });
+  bench.Run("Logger(APP_MONITOR)",
+            []() { Application::Logger log(APP_MONITOR("bench")); });
+
+  // temporaries of a section from malloc and from the thread's arena
+  bench.Run("Logger + vector<double>(64)", []() {
+    Application::Logger log(APP_MONITOR("bench"));
+    std::vector<double> tmp(64);
+  });
+  bench.Run("Logger + arena vector<double>(64)", []() {
+    Application::Logger log(APP_MONITOR("bench"));
+    std::vector<double, ArenaAllocator<double>> tmp(64);
+  });
+
+  // resource lookup, found in the first and in the last of 65 directories
+  mkdir("bench_resources", 0775);
+  std::ofstream("bench_resources/resource.txt") << "resource\n";
+  std::ofstream("resource_here.txt") << "resource\n";
+
+  Application paths;
+  paths.AddResourceDirectory("bench_resources");
+  for (int i = 0; i < 64; ++i) {
+    paths.AddResourceDirectory("bench_missing_" + std::to_string(i));
+  }
+
+  bench.Run("FindResource (first of 1 dirs)",
+            [&]() { app->FindResource("resource_here.txt"); });
+  bench.Run("FindResource (last of 65 dirs)",
+            [&]() { paths.FindResource("resource.txt"); });
+
+  // probing for a missing file, with and without an exception
+  bench.Run("FindResource (missing, caught)", [&]() {
+    try {
+      app->FindResource("resource_missing.txt");
+    } catch (NotFoundError const&) {
+    }
+  });
+  bench.Run("TryFindResource (missing)",
+            [&]() { app->TryFindResource("resource_missing.txt"); });
+
+  // signal checks are collective over the ranks of a member, one thread only
+  auto sig = Signal::GetInstance();
+  bench.Run("Signal::CheckSignalFlags", [&]() { sig->CheckSignalFlags(); },
+            1);
+
+  Application::Destroy();
+}
@@ -0,0 +1,27 @@
+// C/C++
+#include <cstdio>
+
+// application
+#include <application/application.hpp>
+
+// bench
+#include "bench.hpp"
+
+// Cost of entering and leaving a Logger section that does not log anything
+
+void by_name() { Application::Logger app("A"); }
+
+void by_key() { Application::Logger app(APP_MONITOR("A")); }
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("A", "logger_overhead.out", "logger_overhead.err");
+
+  Bench bench("logger_overhead");
+  bench.Run("Logger by name", by_name);
+  bench.Run("Logger by key", by_key);
+
+  Application::Destroy();
+}
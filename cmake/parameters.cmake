@@ -17,3 +17,24 @@ SET_IF_EMPTY(MPI_OPTION "NOT_MPI_PARALLEL")
 if(MPI_OPTION STREQUAL "MPI_PARALLEL")
   find_package(MPI COMPONENTS CXX REQUIRED)
 endif()
+
+# MPI time per Logger section by PMPI wrappers (PMPI_PROFILING or
+# NOT_PMPI_PROFILING), requires MPI_PARALLEL
+SET_IF_EMPTY(PMPI_OPTION "NOT_PMPI_PROFILING")
+
+if(PMPI_OPTION STREQUAL "PMPI_PROFILING" AND
+   NOT MPI_OPTION STREQUAL "MPI_PARALLEL")
+  message(FATAL_ERROR "PMPI_OPTION=PMPI_PROFILING requires MPI_PARALLEL")
+endif()
+
+# USDT probes at Monitor sections and messages (USDT_PROBES or
+# NOT_USDT_PROBES), with <sys/sdt.h> if it is installed
+SET_IF_EMPTY(USDT_OPTION "NOT_USDT_PROBES")
+
+include(CheckIncludeFileCXX)
+check_include_file_cxx(sys/sdt.h HAVE_SYS_SDT_H)
+if(HAVE_SYS_SDT_H)
+  set(SDT_HEADER "HAVE_SYS_SDT_H")
+else()
+  set(SDT_HEADER "NOT_HAVE_SYS_SDT_H")
+endif()
@@ -0,0 +1,357 @@
+// C/C++
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// POSIX C extensions
+#include <dirent.h>  // opendir()
+#include <sched.h>   // sched_setaffinity()
+
+// application
+#include "affinity.hpp"
+#include "exceptions.hpp"
+#include "globals.hpp"
+
+#ifdef MPI_PARALLEL
+#include <mpi.h>
+#endif
+
+static std::mutex aff_mutex;
+
+static int readInt(std::string const& fname, int def) {
+  std::ifstream fin(fname);
+  int value;
+  if (fin >> value) return value;
+  return def;
+}
+
+static std::string readLine(std::string const& fname) {
+  std::ifstream fin(fname);
+  std::string line;
+  std::getline(fin, line);
+  return line;
+}
+
+static std::vector<int> getMask() {
+  std::vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+    for (int i = 0; i < CPU_SETSIZE; ++i)
+      if (CPU_ISSET(i, &mask)) cpus.push_back(i);
+  }
+#endif
+  return cpus;
+}
+
+static bool setMask(std::vector<int> const& cpus) {
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (auto c : cpus)
+    if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &mask);
+  return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+  return false;
+#endif
+}
+
+//! Take part ipart out of nparts of a list of cores
+/*!
+ * Each core is a list of its hardware threads. Cores are split first; if
+ * there are fewer cores than parts, hardware threads are split instead.
+ * Cpus are returned one thread per core before the sibling threads.
+ */
+static std::vector<int> takePart(std::vector<std::vector<int>> cores,
+                                 int nparts, int ipart) {
+  std::vector<int> result;
+  if (cores.empty() || nparts <= 0) return result;
+
+  if (static_cast<int>(cores.size()) < nparts) {
+    std::vector<std::vector<int>> threads;
+    for (auto const& core : cores)
+      for (auto c : core) threads.push_back({c});
+    cores.swap(threads);
+  }
+
+  size_t ncores = cores.size();
+  size_t first, last;
+  if (static_cast<int>(ncores) < nparts) {
+    // oversubscribed: ranks have to share cpus
+    first = ipart % ncores;
+    last = first + 1;
+  } else {
+    first = ncores * ipart / nparts;
+    last = ncores * (ipart + 1) / nparts;
+  }
+
+  size_t nsmt = 0;
+  for (size_t i = first; i < last; ++i)
+    nsmt = std::max(nsmt, cores[i].size());
+
+  for (size_t t = 0; t < nsmt; ++t)
+    for (size_t i = first; i < last; ++i)
+      if (t < cores[i].size()) result.push_back(cores[i][t]);
+
+  return result;
+}
+
+Affinity* Affinity::GetInstance() {
+  // RAII
+  std::unique_lock<std::mutex> lock(aff_mutex);
+
+  if (Affinity::myaff_ == nullptr) {
+    Affinity::myaff_ = new Affinity();
+  }
+
+  return myaff_;
+}
+
+void Affinity::Destroy() {
+  std::unique_lock<std::mutex> lock(aff_mutex);
+
+  if (Affinity::myaff_ != nullptr) {
+    delete Affinity::myaff_;
+    Affinity::myaff_ = nullptr;
+  }
+}
+
+Affinity::Affinity() : policy_(kNone), local_rank_(0), local_size_(1) {
+  readTopology();
+}
+
+void Affinity::SetPolicy(std::string const& policy) {
+  if (policy == "none") {
+    policy_ = kNone;
+  } else if (policy == "compact") {
+    policy_ = kCompact;
+  } else if (policy == "scatter") {
+    policy_ = kScatter;
+  } else if (!policy.empty() &&
+             policy.find_first_not_of("0123456789,-:") == std::string::npos) {
+    policy_ = kList;
+    cpu_lists_ = policy;
+  } else {
+    throw RuntimeError("Affinity::SetPolicy",
+                       "Unknown affinity policy '" + policy + "'");
+  }
+}
+
+bool Affinity::BindRank() {
+  locateNodeRank();
+
+  if (policy_ == kNone) {
+    rank_cpus_ = getMask();
+    return true;
+  }
+
+  rank_cpus_ = selectCPUs();
+  if (rank_cpus_.empty()) return false;
+
+  return setMask(rank_cpus_);
+}
+
+bool Affinity::BindThread(int tid) {
+  if (rank_cpus_.empty() || tid < 0) return false;
+
+  return setMask({rank_cpus_[tid % rank_cpus_.size()]});
+}
+
+std::vector<int> Affinity::FindOverlaps() const {
+  std::vector<int> overlaps;
+
+#ifdef MPI_PARALLEL
+  MPI_Comm node_comm;
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, Globals::my_rank,
+                      MPI_INFO_NULL, &node_comm);
+
+  int nwords = CPU_SETSIZE / 64;
+  std::vector<uint64_t> mine(nwords, 0);
+  for (auto c : getMask()) mine[c / 64] |= uint64_t(1) << (c % 64);
+
+  std::vector<uint64_t> all(nwords * local_size_);
+  MPI_Allgather(mine.data(), nwords, MPI_UINT64_T, all.data(), nwords,
+                MPI_UINT64_T, node_comm);
+  MPI_Comm_free(&node_comm);
+
+  for (int r = 0; r < local_size_; ++r) {
+    if (r == local_rank_) continue;
+    for (int w = 0; w < nwords; ++w) {
+      if (mine[w] & all[r * nwords + w]) {
+        overlaps.push_back(r);
+        break;
+      }
+    }
+  }
+#endif
+
+  return overlaps;
+}
+
+std::string Affinity::GetTopology() const {
+  std::set<int> sockets, numas;
+  std::set<std::pair<int, int>> cores;
+
+  for (auto const& cpu : cpus_) {
+    sockets.insert(cpu.socket);
+    numas.insert(cpu.numa);
+    cores.insert({cpu.socket, cpu.core});
+  }
+
+  std::stringstream ss;
+  ss << sockets.size() << " sockets, " << numas.size() << " numa nodes, "
+     << cores.size() << " cores, " << cpus_.size() << " cpus";
+  return ss.str();
+}
+
+std::string Affinity::GetBinding() const { return FormatCPUList(getMask()); }
+
+std::vector<int> Affinity::ParseCPUList(std::string const& str) {
+  std::vector<int> cpus;
+  std::stringstream ss(str);
+  std::string item;
+
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) continue;
+    auto dash = item.find('-');
+    if (dash == std::string::npos) {
+      cpus.push_back(std::atoi(item.c_str()));
+    } else {
+      int first = std::atoi(item.substr(0, dash).c_str());
+      int last = std::atoi(item.substr(dash + 1).c_str());
+      for (int c = first; c <= last; ++c) cpus.push_back(c);
+    }
+  }
+
+  return cpus;
+}
+
+std::string Affinity::FormatCPUList(std::vector<int> cpus) {
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+
+  std::string str;
+  for (size_t i = 0; i < cpus.size();) {
+    size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+    if (!str.empty()) str += ",";
+    str += std::to_string(cpus[i]);
+    if (j > i) str += "-" + std::to_string(cpus[j]);
+    i = j + 1;
+  }
+
+  return str;
+}
+
+void Affinity::readTopology() {
+  std::string sysfs = "/sys/devices/system";
+
+  auto online = ParseCPUList(readLine(sysfs + "/cpu/online"));
+  if (online.empty()) online = getMask();
+
+  // numa node of each cpu
+  std::vector<std::pair<int, std::vector<int>>> nodes;
+  if (DIR* dir = opendir((sysfs + "/node").c_str())) {
+    while (struct dirent* entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+          name.find_first_not_of("0123456789", 4) != std::string::npos)
+        continue;
+      nodes.push_back({std::atoi(name.c_str() + 4),
+                       ParseCPUList(readLine(sysfs + "/node/" + name +
+                                             "/cpulist"))});
+    }
+    closedir(dir);
+  }
+
+  cpus_.clear();
+  for (auto id : online) {
+    std::string path = sysfs + "/cpu/cpu" + std::to_string(id) + "/topology/";
+
+    CPU cpu;
+    cpu.id = id;
+    cpu.core = readInt(path + "core_id", id);
+    cpu.socket = readInt(path + "physical_package_id", 0);
+    cpu.numa = 0;
+    for (auto const& node : nodes) {
+      if (std::find(node.second.begin(), node.second.end(), id) !=
+          node.second.end()) {
+        cpu.numa = node.first;
+      }
+    }
+    cpus_.push_back(cpu);
+  }
+
+  std::sort(cpus_.begin(), cpus_.end(), [](CPU const& a, CPU const& b) {
+    if (a.socket != b.socket) return a.socket < b.socket;
+    if (a.core != b.core) return a.core < b.core;
+    return a.id < b.id;
+  });
+}
+
+void Affinity::locateNodeRank() {
+#ifdef MPI_PARALLEL
+  MPI_Comm node_comm;
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, Globals::my_rank,
+                      MPI_INFO_NULL, &node_comm);
+  MPI_Comm_rank(node_comm, &local_rank_);
+  MPI_Comm_size(node_comm, &local_size_);
+  MPI_Comm_free(&node_comm);
+#else
+  local_rank_ = 0;
+  local_size_ = 1;
+#endif
+}
+
+std::vector<int> Affinity::selectCPUs() const {
+  if (policy_ == kList) {
+    std::vector<std::string> lists;
+    std::stringstream ss(cpu_lists_);
+    std::string item;
+    while (std::getline(ss, item, ':')) lists.push_back(item);
+    if (lists.empty()) return {};
+    return ParseCPUList(lists[local_rank_ % lists.size()]);
+  }
+
+  // group cpus into cores, per socket
+  std::vector<int> sockets;
+  std::vector<std::vector<std::vector<int>>> cores;
+  for (auto const& cpu : cpus_) {
+    if (sockets.empty() || sockets.back() != cpu.socket) {
+      sockets.push_back(cpu.socket);
+      cores.emplace_back();
+    }
+    auto& socket = cores.back();
+    if (socket.empty() || cpus_[socket.back().front()].core != cpu.core) {
+      socket.push_back({});
+    }
+    socket.back().push_back(&cpu - cpus_.data());
+  }
+
+  // translate positions back into cpu ids
+  for (auto& socket : cores)
+    for (auto& core : socket)
+      for (auto& c : core) c = cpus_[c].id;
+
+  if (policy_ == kCompact) {
+    std::vector<std::vector<int>> all;
+    for (auto& socket : cores) all.insert(all.end(), socket.begin(), socket.end());
+    return takePart(all, local_size_, local_rank_);
+  }
+
+  // scatter
+  int nsockets = cores.size();
+  if (nsockets == 0) return {};
+  int isocket = local_rank_ % nsockets;
+  int nparts = (local_size_ - isocket + nsockets - 1) / nsockets;
+  return takePart(cores[isocket], nparts, local_rank_ / nsockets);
+}
+
+Affinity* Affinity::myaff_ = nullptr;
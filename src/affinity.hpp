@@ -0,0 +1,113 @@
+#ifndef SRC_AFFINITY_HPP_
+#define SRC_AFFINITY_HPP_
+
+// C/C++
+#include <string>
+#include <vector>
+
+//! Hardware topology and CPU/NUMA placement of ranks and threads
+/*!
+ * The topology is read from sysfs (/sys/devices/system/cpu and
+ * /sys/devices/system/node). A placement policy decides which logical
+ * cpus a rank owns among the ranks sharing the same node:
+ *
+ *   - "none"     report the topology and the launcher's binding only
+ *   - "compact"  fill one socket before moving on to the next
+ *   - "scatter"  distribute consecutive ranks round robin over sockets
+ *   - a list     explicit cpu lists per node-local rank, separated by ':'
+ *                for example "0-7:8-15" or "0,2,4,6:1,3,5,7"
+ *
+ * Worker threads of a rank are placed by BindThread() on the rank's cpus,
+ * one thread per physical core before hyper-threads are used.
+ */
+class Affinity {
+ protected:
+  Affinity();
+
+ public:
+  enum Policy {
+    kNone = 0,
+    kCompact = 1,
+    kScatter = 2,
+    kList = 3,
+  };
+
+  //! One logical cpu as seen by the operating system
+  struct CPU {
+    int id;
+    int core;
+    int socket;
+    int numa;
+  };
+
+  static Affinity* GetInstance();
+  static void Destroy();
+
+  //! Set placement policy from a string (see class description)
+  void SetPolicy(std::string const& policy);
+
+  Policy GetPolicy() const { return policy_; }
+
+  //! Bind the calling process according to the policy
+  /*!
+   * Must be called after MPI initialization. Node-local rank and size are
+   * determined from a shared-memory split of MPI_COMM_WORLD.
+   *
+   * @return false if the operating system refused the binding
+   */
+  bool BindRank();
+
+  //! Bind the calling thread to one of the rank's cpus
+  /*!
+   * @param tid thread index within the rank, starting at 0
+   * @return false if the operating system refused the binding
+   */
+  bool BindThread(int tid);
+
+  //! Node-local ranks whose binding overlaps with this rank's binding
+  /*!
+   * This is a collective call over the ranks of a node.
+   */
+  std::vector<int> FindOverlaps() const;
+
+  //! Summary of the topology, e.g. "2 sockets, 2 numa nodes, 64 cores"
+  std::string GetTopology() const;
+
+  //! Current binding of the calling thread as a cpu list, e.g. "0-7,16-23"
+  std::string GetBinding() const;
+
+  //! Logical cpus assigned to this rank, in thread placement order
+  std::vector<int> const& GetRankCPUs() const { return rank_cpus_; }
+
+  int GetLocalRank() const { return local_rank_; }
+
+  int GetLocalSize() const { return local_size_; }
+
+  //! Parse a cpu list such as "0-3,8,10-11"
+  static std::vector<int> ParseCPUList(std::string const& str);
+
+  //! Format a cpu list into its compact form "0-3,8,10-11"
+  static std::string FormatCPUList(std::vector<int> cpus);
+
+ protected:
+  void readTopology();
+
+  void locateNodeRank();
+
+  std::vector<int> selectCPUs() const;
+
+  Policy policy_;
+  std::string cpu_lists_;
+
+  std::vector<CPU> cpus_;
+  std::vector<int> rank_cpus_;
+
+  int local_rank_;
+  int local_size_;
+
+ private:
+  //! Pointer to the single Affinity instance
+  static Affinity* myaff_;
+};
+
+#endif  // SRC_AFFINITY_HPP_
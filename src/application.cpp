@@ -15,12 +15,20 @@
 #include <unistd.h>    // chdir()
 
 // application
+#include "affinity.hpp"
 #include "application.hpp"
+#include "control.hpp"
+#include "device.hpp"
 #include "exceptions.hpp"
+#include "flight_recorder.hpp"
 #include "globals.hpp"
+#include "heartbeat.hpp"
+#include "imbalance.hpp"
 #include "monitor.hpp"
 #include "command_line.hpp"
+#include "rate_limit.hpp"
 #include "signal.hpp"
+#include "watchdog.hpp"
 
 #ifdef MPI_PARALLEL
 #include <mpi.h>
@@ -29,6 +37,15 @@
 namespace Globals {
 clock_t tstart;
 int mpi_tag_ub;
+
+int member_id;
+int nmembers;
+int member_rank;
+int member_size;
+
+#ifdef MPI_PARALLEL
+MPI_Comm member_comm;
+#endif
 }  // namespace Globals
    
 std::string stripnonprint(const std::string& s) {
@@ -42,39 +59,46 @@ std::string stripnonprint(const std::string& s) {
 }
 
 //! Mutex for creating singletons within the application object
-static std::mutex dir_mutex;
 static std::mutex app_mutex;
 
-Application::Logger::Logger(std::string name) {
-  auto app = Application::GetInstance();
+//! Serial number of the next application context, starting at 1
+static std::atomic<uint64_t> next_serial(1);
 
-  if (!app->HasMonitor(name)) {
-    app->InstallMonitor(name, "stdout", "stderr");
-  }
+Application::Logger::Logger(std::string const& name)
+    : Logger(name, Application::GetCurrent()) {}
 
-  cur_monitor_ = app->GetMonitor(name);
+Application::Logger::Logger(std::string const& name, Application* app) {
+  cur_monitor_ = app->findMonitor(name);
   cur_monitor_->Enter();
+  if (auto arena = Arena::FindCurrent()) mark_ = arena->GetMark();
 }
 
-Application::Logger::~Logger() { cur_monitor_->Leave(); }
-
-Application::Application() {
+Application::Application() : serial_(next_serial++) {
   // install a default log_writer that writes to standard
   // output / standard error
   setDefaultDirectories();
 }
 
 Application* Application::GetInstance() {
+  auto app = myapp_.load(std::memory_order_acquire);
+  if (app != nullptr) return app;
+
   // RAII
   std::unique_lock<std::mutex> lock(app_mutex);
 
-  if (myapp_ == nullptr) {
-    myapp_ = new Application();
+  if (myapp_.load(std::memory_order_relaxed) == nullptr) {
+    myapp_.store(new Application(), std::memory_order_release);
   }
 
-  return myapp_;
+  return myapp_.load(std::memory_order_relaxed);
+}
+
+Application::Scope::Scope(Application* app) : prev_(mycurrent_) {
+  mycurrent_ = app;
 }
 
+Application::Scope::~Scope() { mycurrent_ = prev_; }
+
 void Application::ChangeRunDir(const char *pdir) {
   std::stringstream msg;
 
@@ -90,7 +114,7 @@ void Application::ChangeRunDir(const char *pdir) {
   return;
 }
 
-void Application::Start(int argc, char** argv) {
+void Application::Start(int argc, char** argv, int nmembers) {
   auto cli = CommandLine::ParseArguments(argc, argv);
   auto sig = Signal::GetInstance();
 
@@ -100,7 +124,12 @@ void Application::Start(int argc, char** argv) {
     sig->SetWallTimeAlarm(cli->wtlim);
 
 #ifdef MPI_PARALLEL
-  if (MPI_SUCCESS != MPI_Init(&argc, &argv)) {
+  // a host program that initialized MPI also finalizes it
+  int initialized;
+  MPI_Initialized(&initialized);
+  mpi_started_ = !initialized;
+
+  if (!initialized && MPI_SUCCESS != MPI_Init(&argc, &argv)) {
     throw RuntimeError("Start", "MPI initialization failed");
   }
 
@@ -120,10 +149,41 @@ void Application::Start(int argc, char** argv) {
   MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &tag_ub_ptr, &att_flag);
   Globals::mpi_tag_ub = *tag_ub_ptr;
 
+  if (nmembers < 1 || nmembers > Globals::nranks) {
+    throw RuntimeError("Start", "Cannot split " +
+                                    std::to_string(Globals::nranks) +
+                                    " ranks into " + std::to_string(nmembers) +
+                                    " ensemble members");
+  }
+
+  // Split ranks into contiguous blocks of ensemble members
+  Globals::nmembers = nmembers;
+  Globals::member_id =
+      static_cast<int64_t>(Globals::my_rank) * nmembers / Globals::nranks;
+
+  if (MPI_SUCCESS != MPI_Comm_split(MPI_COMM_WORLD, Globals::member_id,
+                                    Globals::my_rank, &Globals::member_comm)) {
+    throw RuntimeError("Start", "MPI_Comm_split failed");
+  }
+
+  MPI_Comm_rank(Globals::member_comm, &Globals::member_rank);
+  MPI_Comm_size(Globals::member_comm, &Globals::member_size);
+
+  sig->ConnectMembers();
+
 #else  // no MPI
   Globals::my_rank = 0;
   Globals::nranks = 1;
   Globals::mpi_tag_ub = 0;
+
+  if (nmembers != 1) {
+    throw RuntimeError("Start", "Ensembles require MPI_PARALLEL");
+  }
+
+  Globals::member_id = 0;
+  Globals::nmembers = 1;
+  Globals::member_rank = 0;
+  Globals::member_size = 1;
 #endif
 
   if (Globals::my_rank == 0) {
@@ -131,6 +191,88 @@ void Application::Start(int argc, char** argv) {
   }
 
   Monitor::Start(); 
+
+  // records left in the buffers of idle or finished threads
+  Device::StartFlusher(1.);
+
+  // parse the input file once and share it with all ranks
+  auto params = Application::GetInstance()->GetParameters();
+  if (cli->input_filename != nullptr) {
+    params->LoadShared(cli->input_filename);
+  }
+  params->ApplyOverrides(argc, argv);
+
+  if (cli->flight > 0) {
+    FlightRecorder::Enable(cli->flight);
+  }
+
+  if (cli->index) {
+    Application::GetInstance()->SetIndexed(true);
+  }
+
+  if (cli->log_stats) {
+    Monitor::SetTimingWrites(true);
+  }
+
+  if (cli->control != nullptr) {
+    SetControlFile(cli->control);
+  }
+
+  if (cli->affinity != nullptr) {
+    bindProcessors(cli->affinity);
+  }
+
+  if (cli->imbalance > 0) {
+    SetImbalanceInterval(cli->imbalance);
+  }
+
+  auto dog = Watchdog::GetInstance();
+  if (cli->watchdog > 0.) {
+    dog->Start(cli->watchdog, cli->watchdog_abort != 0);
+  }
+
+  auto beat = Heartbeat::GetInstance();
+  if (Globals::member_rank == 0 && cli->heartbeat > 0.) {
+    auto app = Application::GetInstance();
+    if (!app->HasMonitor("main")) {
+      app->InstallMonitor("main", "stdout", "stderr");
+    }
+    beat->Start(cli->heartbeat, app->GetMonitor("main"), cli->wtlim);
+  }
+}
+
+void Application::bindProcessors(const char* policy) {
+  auto aff = Affinity::GetInstance();
+  aff->SetPolicy(policy);
+
+  auto app = Application::GetInstance();
+  if (!app->HasMonitor("main")) {
+    app->InstallMonitor("main", "stdout", "stderr");
+  }
+  auto log = app->GetMonitor("main");
+
+  if (!aff->BindRank()) {
+    log->Warn("Cannot bind rank " + std::to_string(Globals::my_rank) +
+              " with policy " + policy);
+  }
+
+  char buf[80];
+  snprintf(buf, sizeof(buf), "rank %d (node-local %d of %d)",
+           Globals::my_rank, aff->GetLocalRank(), aff->GetLocalSize());
+
+  log->Log("Topology", aff->GetTopology());
+  log->Log(std::string("Binding of ") + buf, aff->GetBinding());
+  std::string placement;
+  for (auto cpu : aff->GetRankCPUs()) {
+    if (!placement.empty()) placement += ' ';
+    placement += std::to_string(cpu);
+  }
+  log->Log("Thread placement", placement);
+
+  for (auto r : aff->FindOverlaps()) {
+    log->Warn(std::string("Binding of ") + buf +
+              " overlaps with node-local rank " + std::to_string(r));
+  }
 }
 
 void Application::Destroy() {
@@ -138,6 +280,24 @@ void Application::Destroy() {
 
   auto sig = Signal::GetInstance();
   auto cli = CommandLine::GetInstance();
+  auto app = myapp_.load();
+
+  // what logging cost, taken before the summary below adds to it
+  std::string stats;
+  if (app != nullptr && cli->log_stats) stats = app->GetLogStats();
+
+  // warnings held back by rate limits and deduplication
+  auto summary = RateLimit::GetSummary();
+  if (app != nullptr && !summary.empty()) {
+    auto log = app->findMonitor("main");
+    for (auto const& line : summary) log->Log(line);
+  }
+
+  if (!stats.empty()) {
+    std::istringstream lines(stats);
+    auto log = app->findMonitor("main");
+    for (std::string line; std::getline(lines, line);) log->Log(line);
+  }
 
   if (Globals::my_rank == 0) {
     if (sig->GetSignalFlag(SIGTERM) != 0) {
@@ -162,31 +322,345 @@ void Application::Destroy() {
   if (Globals::my_rank == 0 && cli->wtlim > 0)
     sig->CancelWallTimeAlarm();
 
-  if (Application::myapp_ != nullptr) {
-    delete Application::myapp_;
-    Application::myapp_ = nullptr;
+  // give SIGHUP and SIGUSR1 back to the host program
+  if (!control_file_.empty()) SetControlFile("");
+
+  // all ranks call Destroy, so the final report can be collective
+  if (imbalance_interval_ > 0 && app != nullptr) {
+    Imbalance::Report(app);
   }
+  SetImbalanceInterval(0);
+
+  // the PMPI wrappers look up the context while profiling
+  Profiler::Disable();
+  Monitor::SetTimingWrites(false);
+
+  // the heartbeat writes through a monitor of the default context, the
+  // watchdog reads its section counters
+  Heartbeat::Destroy();
+  Watchdog::Destroy();
+  Device::StopFlusher();
+
+  delete Application::myapp_.exchange(nullptr);
+
+  FlightRecorder::Disable();
+
+  sig->DisconnectMembers();
 
   CommandLine::Destroy();
   Signal::Destroy();
+  Affinity::Destroy();
+
+#ifdef MPI_PARALLEL
+  int finalized;
+  MPI_Finalized(&finalized);
+  if (!finalized) {
+    MPI_Comm_free(&Globals::member_comm);
+    if (mpi_started_) MPI_Finalize();
+  }
+#endif
+}
+
+//! Insert suffix before the extension of a file name
+static std::string insertSuffix(std::string const& fname, char const* suffix) {
+  auto slash = fname.find_last_of('/');
+  auto dot = fname.find_last_of('.');
+  if (dot == std::string::npos || dot == 0 ||
+      (slash != std::string::npos && dot < slash + 2)) {
+    return fname + suffix;
+  }
+
+  return fname.substr(0, dot) + suffix + fname.substr(dot);
+}
+
+std::string Application::GetMemberFileName(std::string const& fname) {
+  if (Globals::nmembers <= 1 || fname == "stdout" || fname == "stderr") {
+    return fname;
+  }
+
+  char suffix[16];
+  snprintf(suffix, sizeof(suffix), ".m%03d", Globals::member_id);
+  return insertSuffix(fname, suffix);
+}
+
+std::string Application::GetRankFileName(std::string const& fname) {
+  if (Globals::nranks <= 1) return fname;
+
+  char suffix[16];
+  snprintf(suffix, sizeof(suffix), ".r%04d", Globals::my_rank);
+  return insertSuffix(fname, suffix);
 }
 
 bool Application::InstallMonitor(std::string const& mod,
                                  std::string const& log_name,
                                  std::string const& err_name) {
-  if (mymonitor_.count(mod)) {
-    mymonitor_[mod]->SetLogOutput(log_name);
-    mymonitor_[mod]->SetErrOutput(err_name);
-  } else {
-    auto monitor = std::make_unique<Monitor>(mod);
+  std::unique_lock<std::mutex> lock(monitor_mutex_);
+  installMonitor(mod, log_name, err_name);
+  return true;
+}
+
+Monitor* Application::installMonitor(std::string const& mod,
+                                     std::string const& log_name,
+                                     std::string const& err_name) {
+  Monitor* monitor;
+  auto it = mymonitor_.find(mod);
+  if (it != mymonitor_.end()) {
+    monitor = it->second.get();
     monitor->SetLogOutput(log_name);
     monitor->SetErrOutput(err_name);
-    mymonitor_.insert({mod, std::move(monitor)});
+  } else {
+    auto created = std::make_unique<Monitor>(mod, this);
+    created->SetIndexed(indexed_);
+    created->SetLogOutput(log_name);
+    created->SetErrOutput(err_name);
+    monitor = created.get();
+    mymonitor_.insert({mod, std::move(created)});
   }
 
-  mymonitor_[mod]->Log("Installing monitor " + mod);
+  // publish the monitor to lookups by interned key
+  size_t id = MonitorKey(mod).GetID();
+  if (id < kMaxMonitorKeys) {
+    monitor_index_[id].store(monitor, std::memory_order_release);
+  }
 
-  return true;
+  monitor->Log("Installing monitor " + mod);
+
+  return monitor;
+}
+
+void Application::WarnDeprecated(std::string_view method,
+                                 const std::string& extra) {
+  std::string msg = std::string(method) + " is deprecated";
+  if (!extra.empty()) msg += ". " + extra;
+
+  if (fatal_deprecation_warnings_) {
+    throw RuntimeError("WarnDeprecated", msg);
+  }
+  if (suppress_deprecation_warnings_) return;
+
+  // once per method, later calls are counted as duplicates
+  uint64_t hash = DedupSet::Hash(method, DedupSet::Hash("deprecated:"));
+  if (!DedupSet::Global().Insert(hash, msg)) return;
+
+  findMonitor("main")->Warn(msg);
+}
+
+void Application::SetIndexed(bool indexed) {
+  std::unique_lock<std::mutex> lock(monitor_mutex_);
+
+  indexed_ = indexed;
+  for (auto& it : mymonitor_) it.second->SetIndexed(indexed);
+}
+
+std::vector<std::string> Application::GetMonitorNames() {
+  std::unique_lock<std::mutex> lock(monitor_mutex_);
+
+  std::vector<std::string> names;
+  for (auto const& it : mymonitor_) names.push_back(it.first);
+  return names;
+}
+
+std::string Application::GetProfile() {
+  std::unique_lock<std::mutex> lock(monitor_mutex_);
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-24s %12s %14s %14s %14s %14s\n", "monitor",
+           "sections", "seconds", "us/section", "mpi seconds", "mpi bytes");
+  std::string table = buf;
+
+  for (auto const& it : mymonitor_) {
+    uint64_t calls;
+    double seconds;
+    it.second->GetProfile(&calls, &seconds);
+    if (calls == 0) continue;
+
+    uint64_t comm_calls, comm_bytes;
+    double comm_seconds;
+    it.second->GetCommunication(&comm_calls, &comm_seconds, &comm_bytes);
+
+    snprintf(buf, sizeof(buf), "%-24s %12lu %14.6f %14.3f %14.6f %14lu\n",
+             it.first.c_str(), static_cast<unsigned long>(calls), seconds,
+             1.e6 * seconds / calls, comm_seconds,
+             static_cast<unsigned long>(comm_bytes));
+    table += buf;
+  }
+
+  return table;
+}
+
+std::string Application::GetArenaStats() {
+  std::unique_lock<std::mutex> lock(monitor_mutex_);
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-24s %14s\n", "monitor", "peak bytes");
+  std::string table = buf;
+
+  for (auto const& it : mymonitor_) {
+    uint64_t peak = it.second->GetArenaPeak();
+    if (peak == 0) continue;
+
+    snprintf(buf, sizeof(buf), "%-24s %14lu\n", it.first.c_str(),
+             static_cast<unsigned long>(peak));
+    table += buf;
+  }
+
+  return table;
+}
+
+std::string Application::GetLogStats() {
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-24s %12s %14s %12s %10s %10s\n", "monitor",
+           "records", "bytes", "suppressed", "p50 us", "p99 us");
+  std::string table = buf;
+
+  {
+    std::unique_lock<std::mutex> lock(monitor_mutex_);
+
+    for (auto const& it : mymonitor_) {
+      uint64_t records, bytes, suppressed;
+      it.second->GetVolume(&records, &bytes, &suppressed);
+      if (records == 0 && suppressed == 0) continue;
+
+      auto const& latency = it.second->GetWriteLatency();
+      snprintf(buf, sizeof(buf), "%-24s %12lu %14lu %12lu %10.3g %10.3g\n",
+               it.first.c_str(), static_cast<unsigned long>(records),
+               static_cast<unsigned long>(bytes),
+               static_cast<unsigned long>(suppressed),
+               1.e6 * latency.GetQuantile(0.5),
+               1.e6 * latency.GetQuantile(0.99));
+      table += buf;
+    }
+  }
+
+  snprintf(buf, sizeof(buf), "%-24s %12s %14s %12s %10s %10s\n", "device",
+           "records", "bytes", "commits", "p50 us", "p99 us");
+  table += buf;
+
+  std::unique_lock<std::mutex> lock(device_mutex_);
+  for (auto const& it : mydevice_) {
+    auto const& device = it.second;
+    auto const& latency = device->GetCommitLatency();
+
+    uint64_t commits = 0;
+    for (auto n : latency.GetCounts()) commits += n;
+
+    snprintf(buf, sizeof(buf), "%-24s %12lu %14lu %12lu %10.3g %10.3g\n",
+             it.first.c_str(), static_cast<unsigned long>(device->GetRecords()),
+             static_cast<unsigned long>(device->GetBytes()),
+             static_cast<unsigned long>(commits),
+             1.e6 * latency.GetQuantile(0.5),
+             1.e6 * latency.GetQuantile(0.99));
+    table += buf;
+  }
+
+  return table;
+}
+
+void Application::SetControlFile(std::string const& fname) {
+  control_file_ = fname;
+  Signal::SetControlHandler(fname.empty() ? nullptr : applyControl);
+}
+
+void Application::applyControl() {
+  Control::Apply(control_file_, GetInstance());
+}
+
+void Application::SetImbalanceInterval(int checks) {
+  imbalance_interval_ = std::max(checks, 0);
+  imbalance_steps_ = 0;
+
+  if (imbalance_interval_ > 0) Profiler::Enable();
+  Signal::SetStepHandler(imbalance_interval_ > 0 ? reportImbalance : nullptr);
+}
+
+void Application::reportImbalance() {
+  if (++imbalance_steps_ < imbalance_interval_) return;
+
+  imbalance_steps_ = 0;
+  Imbalance::Report(GetInstance());
+}
+
+Monitor* Application::findMonitor(std::string const& name) {
+  // one critical section, so that concurrent lookups install it once
+  std::unique_lock<std::mutex> lock(monitor_mutex_);
+
+  auto it = mymonitor_.find(name);
+  if (it != mymonitor_.end()) return it->second.get();
+
+  return installMonitor(name, "stdout", "stderr");
+}
+
+std::shared_ptr<Sidecar> Application::GetSidecar(std::string const& fname) {
+  std::unique_lock<std::mutex> lock(monitor_mutex_);
+
+  auto& sidecar = mysidecar_[fname];
+  if (sidecar == nullptr) {
+    sidecar = std::make_shared<Sidecar>(GetMemberFileName(fname));
+  }
+
+  return sidecar;
+}
+
+std::string Application::GetSectionStacks() {
+  std::unique_lock<std::mutex> lock(section_mutex_);
+
+  std::string stacks;
+  for (auto const& it : sections_) {
+    if (!it->owned.load(std::memory_order_acquire)) continue;
+
+    std::ostringstream ss;
+    ss << "thread " << it->thread << ": " << it->counter.GetStack() << "\n";
+    stacks += ss.str();
+  }
+
+  return stacks;
+}
+
+SectionCounter* Application::findSections() {
+  //! Counters of this thread, released when it exits
+  struct Holder {
+    ~Holder() {
+      for (auto& it : claimed) {
+        it->owned.store(false, std::memory_order_release);
+      }
+    }
+
+    std::vector<std::shared_ptr<ThreadCounter>> claimed;
+  };
+  static thread_local Holder holder;
+
+  // counters of destroyed contexts are only held here
+  auto& claimed = holder.claimed;
+  claimed.erase(
+      std::remove_if(claimed.begin(), claimed.end(),
+                     [](auto const& it) { return it.use_count() == 1; }),
+      claimed.end());
+
+  for (auto const& it : claimed) {
+    if (it->serial == serial_) {
+      mysections_ = {serial_, &it->counter};
+      return &it->counter;
+    }
+  }
+
+  auto counter = std::make_shared<ThreadCounter>();
+  counter->thread = std::this_thread::get_id();
+  counter->serial = serial_;
+  claimed.push_back(counter);
+
+  {
+    std::unique_lock<std::mutex> lock(section_mutex_);
+
+    // drop the counters of exited threads
+    sections_.erase(
+        std::remove_if(sections_.begin(), sections_.end(),
+                       [](auto const& it) { return !it->owned.load(); }),
+        sections_.end());
+    sections_.push_back(counter);
+  }
+
+  mysections_ = {serial_, &counter->counter};
+  return &counter->counter;
 }
 
 void Application::setDefaultDirectories() {
@@ -211,7 +685,7 @@ void Application::setDefaultDirectories() {
 }
 
 void Application::AddResourceDirectory(const std::string& dir) {
-  std::unique_lock<std::mutex> dirLock(dir_mutex);
+  std::unique_lock<std::mutex> dirLock(dir_mutex_);
   if (input_dirs_.empty()) {
     setDefaultDirectories();
   }
@@ -239,7 +713,14 @@ void Application::AddResourceDirectory(const std::string& dir) {
 }
 
 std::string Application::FindResource(const std::string& name) {
-  std::unique_lock<std::mutex> dirLock(dir_mutex);
+  return TryFindResource(name).Value();
+}
+
+Expected<std::string, NotFoundError> Application::TryFindResource(
+    const std::string& name) {
+  using Result = Expected<std::string, NotFoundError>;
+
+  std::unique_lock<std::mutex> dirLock(dir_mutex_);
   std::string::size_type islash = name.find('/');
   std::string::size_type ibslash = name.find('\\');
   std::string::size_type icolon = name.find(':');
@@ -257,7 +738,7 @@ std::string Application::FindResource(const std::string& name) {
       if (fin) {
         return full_name;
       } else {
-        throw NotFoundError("FindResource", "Resource " + name);
+        return Result::Error("FindResource", "Resource " + name);
       }
     }
   }
@@ -269,7 +750,7 @@ std::string Application::FindResource(const std::string& name) {
     if (fin) {
       return name;
     } else {
-      throw NotFoundError("FindResource", "Resource " + name);
+      return Result::Error("FindResource", "Resource " + name);
     }
   }
 
@@ -283,10 +764,10 @@ std::string Application::FindResource(const std::string& name) {
       return full_name;
     }
   }
-  std::string msg = "\nResource " + name + " not found in director";
+  std::string msg = "Resource " + name + " in director";
   msg += (nd_ == 1 ? "y " : "ies ");
   for (size_t i = 0; i < nd_; i++) {
-    msg += "\n'" + dirs[i] + "'";
+    msg += "'" + dirs[i] + "'";
     if (i + 1 < nd_) {
       msg += ", ";
     }
@@ -295,7 +776,7 @@ std::string Application::FindResource(const std::string& name) {
   msg += "To fix this problem, either:\n";
   msg += "    a) move the missing files into the local directory;\n";
   msg += "    b) define -DMYPATH= during build\n";
-  throw NotFoundError(msg);
+  return Result::Error("FindResource", msg);
 }
 
 std::string Application::GetResourceDirectories(const std::string& sep) {
@@ -313,5 +794,5 @@ std::string Application::GetResourceDirectories(const std::string& sep) {
 //     ba::split(m_pythonSearchVersions, versions, ba::is_any_of(","));
 // }
 
-Application* Application::myapp_ = nullptr;
+std::atomic<Application*> Application::myapp_ = nullptr;
 // MonitorMap Application::mymonitor_ = {};
@@ -2,13 +2,22 @@
 #define SRC_APPLICATION_HPP_
 
 // C/C++
+#include <array>
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <cstdint>
 
 // application
+#include "arena.hpp"
+#include "exceptions.hpp"
+#include "metrics.hpp"
 #include "monitor.hpp"
+#include "parameters.hpp"
 
 //! Strip non-printing characters wherever they are
 /*!
@@ -17,17 +26,55 @@
  */
 std::string stripnonprint(const std::string& s);
 
+//! Application context
+/*!
+ * An application context owns monitors, devices, resource directories and
+ * the section counter. The context returned by GetInstance() is the
+ * default context. Additional, independent contexts can be created to run
+ * several cases concurrently in threads of the same process; they do not
+ * share locks or output with each other.
+ */
 class Application {
- protected:
+ public:
   //! Constructor for class sets up the initial conditions
-  //! Protected ctor access thru static member function Instance
+  /*!
+   * The default context is accessed thru static member function GetInstance.
+   * Other contexts are owned by the caller.
+   */
   Application();
 
- public:
+  //! Section of a monitor for the lifetime of the object
+  /*!
+   * Arena memory that the thread allocates within the section is released
+   * when the section ends, see Arena.
+   */
   class Logger {
    public:
-    explicit Logger(std::string name);
-    ~Logger();
+    //! Enter a section of monitor name in the current context
+    explicit Logger(std::string const& name);
+
+    //! Enter a section of monitor name in context app
+    Logger(std::string const& name, Application* app);
+
+    //! Enter a section of an interned monitor in the current context
+    /*!
+     * This is the fast path for functions called many times:
+     *   Application::Logger app(APP_MONITOR("name"));
+     */
+    explicit Logger(MonitorKey const& key)
+        : cur_monitor_(GetCurrent()->GetMonitor(key)) {
+      cur_monitor_->Enter();
+      if (auto arena = Arena::FindCurrent()) mark_ = arena->GetMark();
+    }
+
+    ~Logger() {
+      // an arena created within the section is released as a whole
+      if (auto arena = Arena::FindCurrent()) {
+        size_t peak = arena->Release(mark_);
+        if (peak > 0) cur_monitor_->AddArenaPeak(peak);
+      }
+      cur_monitor_->Leave();
+    }
 
     //! Provide a pointer dereferencing overloaded operator
     /*!
@@ -37,6 +84,9 @@ class Application {
 
    protected:
     Monitor* cur_monitor_;
+
+    //! Position of the thread's arena when the section was entered
+    Arena::Mark mark_;
   };
 
   //! Return a pointer to the one and only instance of class Application
@@ -45,26 +95,121 @@ class Application {
    */
   static Application* GetInstance();
 
-  size_t CountMonitors() { return mymonitor_.size(); }
+  //! Return the context of the calling thread
+  /*!
+   * This is the context made current by a Scope on the calling thread, or
+   * the default context if there is none.
+   */
+  static Application* GetCurrent() {
+    if (mycurrent_ != nullptr) return mycurrent_;
+    return GetInstance();
+  }
+
+  //! Make a context current on the calling thread for the lifetime of Scope
+  class Scope {
+   public:
+    explicit Scope(Application* app);
+    ~Scope();
+
+   protected:
+    Application* prev_;
+  };
+
+  size_t CountMonitors() {
+    std::unique_lock<std::mutex> lock(monitor_mutex_);
+    return mymonitor_.size();
+  }
 
   bool HasMonitor(std::string const& name) {
+    std::unique_lock<std::mutex> lock(monitor_mutex_);
     return mymonitor_.count(name) > 0;
   }
 
+  //! Get an installed monitor, nullptr if there is none of that name
   Monitor* GetMonitor(std::string const& name) {
-    return mymonitor_[name].get();
+    std::unique_lock<std::mutex> lock(monitor_mutex_);
+    auto it = mymonitor_.find(name);
+    return it != mymonitor_.end() ? it->second.get() : nullptr;
+  }
+
+  //! Get an interned monitor, installing it on stdout/stderr if needed
+  Monitor* GetMonitor(MonitorKey const& key) {
+    size_t id = key.GetID();
+    if (id < kMaxMonitorKeys) {
+      auto monitor = monitor_index_[id].load(std::memory_order_acquire);
+      if (monitor != nullptr) return monitor;
+    }
+    return findMonitor(key.GetName());
   }
 
   bool InstallMonitor(std::string const& name, std::string const& log_name,
                       std::string const& err_name);
 
+  //! Names of the installed monitors
+  std::vector<std::string> GetMonitorNames();
+
+  //! Table of the sections of each monitor timed by the Profiler
+  /*!
+   * One line per monitor with sections: number of sections left while
+   * profiling, seconds spent in them (children included), microseconds
+   * per section, and seconds and bytes of the MPI calls made within them.
+   * MPI calls are only counted in a build with PMPI_PROFILING.
+   */
+  std::string GetProfile();
+
+  //! Arena of the calling thread, created on first use
+  static Arena* GetArena() { return Arena::GetCurrent(); }
+
+  //! Table of the largest arena use of each monitor's sections
+  /*!
+   * One line per monitor whose sections allocated from an arena: the
+   * peak bytes in use within one section, children included.
+   */
+  std::string GetArenaStats();
+
+  //! Tables of the logging volume and latency of monitors and devices
+  /*!
+   * One line per monitor that wrote or suppressed records: records and
+   * bytes written, records suppressed (see Monitor::GetVolume) and the
+   * median and 99th percentile of the time to hand a record to a device.
+   * Then one line per device: records and bytes written, commits to the
+   * file and the median and 99th percentile of the commit time.
+   * Percentiles are upper bounds of histogram buckets, in microseconds.
+   * Written to the "main" monitor by Destroy with the -s option.
+   */
+  std::string GetLogStats();
+
+  //! Apply fname on SIGHUP and SIGUSR1 to the default context
+  /*!
+   * See Control for the commands of the file. An empty name stops
+   * watching for the signals.
+   */
+  static void SetControlFile(std::string const& fname);
+
+  //! Report the load imbalance of the default context every checks steps
+  /*!
+   * A step is a call of Signal::CheckSignalFlags. Enables the Profiler.
+   * The last report is written by Destroy. Zero stops reporting. See
+   * Imbalance::Report.
+   */
+  static void SetImbalanceInterval(int checks);
+
   //! Destructor for class deletes global data
   virtual ~Application() {}
 
   //! Static function that starts section counter
-  static void Start(int argc, char** argv);
+  /*!
+   * @param nmembers Number of ensemble members. MPI_COMM_WORLD is split into
+   *        nmembers sub-communicators of contiguous ranks. Each member logs
+   *        to its own member-suffixed devices and checks signals among its
+   *        own ranks.
+   */
+  static void Start(int argc, char** argv, int nmembers = 1);
 
   //! Static function that destroys the application class's data
+  /*!
+   * MPI is finalized only if Start initialized it.
+   */
   static void Destroy();
 
   //!  Add a directory to the data file search path.
@@ -98,6 +243,17 @@ class Application {
    */
   std::string FindResource(const std::string& name);
 
+  //! Find a resource file without throwing if it is missing
+  /*!
+   * Same search as FindResource(), for callers that probe for optional
+   * files and expect misses. A missing file gives a failed result, whose
+   * Value() throws the NotFoundError of FindResource().
+   *
+   * @ingroup resource
+   */
+  Expected<std::string, NotFoundError> TryFindResource(
+      const std::string& name);
+
   //! Get the data directories
   /*!
    * This routine returns a string including the names of all the
@@ -119,7 +275,9 @@ class Application {
   //! Print a warning indicating that *method* is deprecated. Additional
   //! information (removal version, alternatives) can be specified in
   //! *extra*. Deprecation warnings are printed once per method per
-  //! invocation of the application.
+  //! invocation of the application, through monitor "main". Use
+  //! APP_WARN_DEPRECATED in the deprecated method itself, so that later
+  //! calls cost a single atomic load.
   void WarnDeprecated(std::string_view method, const std::string& extra = "");
 
   //! Globally disable printing of deprecation warnings. Used primarily to
@@ -147,16 +305,74 @@ class Application {
   //! suite to make sure that your warning message are being raised.
   void MakeWarningsFatal() { fatal_warnings_ = true; }
 
-  bool HasDevice(std::string const& name) { return mydevice_.count(name) > 0; }
+  bool HasDevice(std::string const& name) {
+    std::unique_lock<std::mutex> lock(device_mutex_);
+    return mydevice_.count(name) > 0;
+  }
 
-  DevicePtr GetDevice(std::string const& name) { return mydevice_[name]; }
+  //! Get an installed device, nullptr if there is none of that name
+  DevicePtr GetDevice(std::string const& name) {
+    std::unique_lock<std::mutex> lock(device_mutex_);
+    auto it = mydevice_.find(name);
+    return it != mydevice_.end() ? it->second : nullptr;
+  }
 
+  //! Install device under name, its stale buffers are flushed periodically
   void InstallDevice(std::string const& name, DevicePtr device) {
-    mydevice_.insert({name, device});
+    {
+      std::unique_lock<std::mutex> lock(device_mutex_);
+      mydevice_.insert({name, device});
+    }
+    Device::Watch(device);
   }
 
+  //! Get the sidecar file fname, opening it if needed
+  std::shared_ptr<Sidecar> GetSidecar(std::string const& fname);
+
   static void ChangeRunDir(const char *pdir);
 
+  //! Device file name of this ensemble member
+  /*!
+   * "main.out" becomes "main.m002.out" for member 2 if there is more than
+   * one member. Standard output and standard error are not renamed.
+   */
+  static std::string GetMemberFileName(std::string const& fname);
+
+  //! File name of this rank
+  /*!
+   * "metrics.prom" becomes "metrics.r0003.prom" for rank 3 if there is
+   * more than one rank.
+   */
+  static std::string GetRankFileName(std::string const& fname);
+
+  //! Index the records of all monitors of this context
+  /*!
+   * Applies to monitors installed later as well, see Monitor::SetIndexed.
+   */
+  void SetIndexed(bool indexed);
+
+  //! Metrics registry of this context
+  Metrics* GetMetrics() { return &metrics_; }
+
+  //! Parameters of this context
+  /*!
+   * Application::Start fills the parameters of the default context from
+   * the input file given with -i and the block/par=value arguments.
+   */
+  Parameters* GetParameters() { return &params_; }
+
+  //! Section stack of each thread of this context, one line per thread
+  std::string GetSectionStacks();
+
+  //! Unique number of this context, never reused within the process
+  uint64_t GetSerial() const { return serial_; }
+
+  //! Section counter of the calling thread in this context
+  SectionCounter* GetSections() {
+    if (mysections_.serial == serial_) return mysections_.counter;
+    return findSections();
+  }
+
  protected:
   //! Set the default directories for input files.
   /*!
@@ -172,6 +388,29 @@ class Application {
    */
   void setDefaultDirectories();
 
+  //! Find a monitor by name, installing it on stdout/stderr if needed
+  Monitor* findMonitor(std::string const& name);
+
+  //! Install or redirect a monitor, with monitor_mutex_ held
+  Monitor* installMonitor(std::string const& name,
+                          std::string const& log_name,
+                          std::string const& err_name);
+
+  //! Find or create the section counter of the calling thread
+  SectionCounter* findSections();
+
+  //! Apply the control file, called by Signal at a safe point
+  static void applyControl();
+
+  //! Count a step and report the load imbalance when due
+  static void reportImbalance();
+
+  //! Bind this rank to processors and report the bindings to monitor "main"
+  /*!
+   * @param policy Placement policy, see Affinity::SetPolicy
+   */
+  static void bindProcessors(const char* policy);
+
   //! Current vector of input directories to search for input files
   std::vector<std::string> input_dirs_;
 
@@ -183,12 +422,92 @@ class Application {
   bool suppress_warnings_ = false;
   bool fatal_warnings_ = false;
 
+  //! Whether monitors index their records
+  bool indexed_ = false;
+
   MonitorMap mymonitor_;
   DeviceMap mydevice_;
+  std::map<std::string, std::shared_ptr<Sidecar>> mysidecar_;
+
+  Metrics metrics_;
+
+  Parameters params_;
+
+  //! Number of interned monitors that are looked up without locking
+  static constexpr size_t kMaxMonitorKeys = 256;
+
+  //! Monitors indexed by MonitorKey id
+  std::array<std::atomic<Monitor*>, kMaxMonitorKeys> monitor_index_ = {};
+
+  //! Mutex protecting installation of monitors
+  std::mutex monitor_mutex_;
+
+  //! Mutex protecting mydevice_, taken with monitor_mutex_ held
+  std::mutex device_mutex_;
+
+  //! Unique number of this context, never reused within the process
+  uint64_t serial_;
+
+  //! Section counter of a thread in one context
+  struct ThreadCounter {
+    SectionCounter counter;
+    std::thread::id thread;
+    uint64_t serial;  //!< serial number of the context
+
+    //! Cleared when the thread exits, the counter is then dropped
+    std::atomic<bool> owned{true};
+  };
+
+  //! Section counters of the threads that use this context
+  std::vector<std::shared_ptr<ThreadCounter>> sections_;
+
+  //! Mutex protecting the section counters
+  std::mutex section_mutex_;
+
+  //! Mutex protecting the input directories
+  std::mutex dir_mutex_;
 
  private:
-  //! Pointer to the single Application instance
-  static Application* myapp_;
+  //! Pointer to the default Application instance
+  static std::atomic<Application*> myapp_;
+
+  //! Whether Start initialized MPI
+  inline static bool mpi_started_ = false;
+
+  //! Control file applied on SIGHUP and SIGUSR1
+  inline static std::string control_file_;
+
+  //! Steps between load imbalance reports, zero if not reporting
+  inline static int imbalance_interval_ = 0;
+  inline static int imbalance_steps_ = 0;
+
+  //! Context made current on this thread
+  inline static thread_local Application* mycurrent_ = nullptr;
+
+  //! Section counter of the context last used on this thread
+  struct ThreadSections {
+    uint64_t serial;
+    SectionCounter* counter;
+  };
+
+  inline static thread_local ThreadSections mysections_ = {0, nullptr};
 };
 
+//! Warn once that the enclosing function is deprecated
+/*!
+ * Example:
+ *   void OldStep() {
+ *     APP_WARN_DEPRECATED("Use Step() instead.");
+ *     ...
+ *   }
+ */
+#define APP_WARN_DEPRECATED(extra)                                     \
+  do {                                                                 \
+    static std::atomic<bool> app_deprecated(false);                    \
+    if (!app_deprecated.load(std::memory_order_relaxed)) {             \
+      Application::GetCurrent()->WarnDeprecated(__func__, extra);      \
+      app_deprecated.store(true, std::memory_order_relaxed);           \
+    }                                                                  \
+  } while (0)
+
 #endif  // SRC_APPLICATION_HPP_
@@ -0,0 +1,64 @@
+// C/C++
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
+// application
+#include "arena.hpp"
+
+Arena::~Arena() {
+  for (auto& chunk : chunks_) std::free(chunk.data);
+}
+
+Arena* Arena::createCurrent() {
+  // the arena is destroyed with its thread
+  static thread_local std::unique_ptr<Arena> arena;
+
+  arena.reset(new Arena);
+  mycurrent_ = arena.get();
+  return mycurrent_;
+}
+
+size_t Arena::GetCapacity() const {
+  size_t capacity = 0;
+  for (auto const& chunk : chunks_) capacity += chunk.size;
+  return capacity;
+}
+
+void* Arena::allocateSlow(size_t size, size_t align) {
+  // the rest of the current chunk is left unused
+  if (chunk_ < chunks_.size()) {
+    used_ += chunks_[chunk_].size - offset_;
+    chunk_++;
+  }
+
+  // reuse the next chunk if it is large enough, else insert a new one
+  size_t need = size + align;
+  if (chunk_ == chunks_.size() || chunks_[chunk_].size < need) {
+    size_t bytes = std::max(kChunkSize, need);
+    char* data = static_cast<char*>(std::malloc(bytes));
+    if (data == nullptr) throw std::bad_alloc();
+    chunks_.insert(chunks_.begin() + chunk_, {data, bytes});
+  }
+
+  offset_ = 0;
+  return Allocate(size, align);
+}
+
+void Arena::rewind(Mark const& mark) {
+  if (IsPoisoned()) {
+    for (size_t i = mark.chunk; i <= chunk_ && i < chunks_.size(); ++i) {
+      size_t begin = i == mark.chunk ? mark.offset : 0;
+      size_t end = i == chunk_ ? offset_ : chunks_[i].size;
+      if (end > begin) memset(chunks_[i].data + begin, kPoison, end - begin);
+    }
+  }
+
+  chunk_ = mark.chunk;
+  offset_ = mark.offset;
+  used_ = mark.used;
+}
+
+const size_t Arena::kChunkSize;
@@ -0,0 +1,183 @@
+#ifndef SRC_ARENA_HPP_
+#define SRC_ARENA_HPP_
+
+// C/C++
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! Bump allocator of one thread
+/*!
+ * Allocating from an arena moves a pointer forward within a chunk, so
+ * short-lived temporaries cost neither malloc nor its locks. Memory is
+ * not returned one allocation at a time but wholesale, by rewinding to a
+ * mark taken earlier. Application::Logger takes a mark when it enters a
+ * section and rewinds to it when the section ends, so that everything the
+ * thread allocated from its arena within the section is released then:
+ *
+ *   {
+ *     Application::Logger log(APP_MONITOR("flux"));
+ *     std::vector<double, ArenaAllocator<double>> tmp(n);
+ *     ...
+ *   }  // tmp and all other arena memory of the section are released
+ *
+ * Memory must therefore not outlive the section it was allocated in.
+ * Chunks are kept for reuse after a rewind and only freed with the arena,
+ * i.e. when its thread exits. With SetPoison(true), released memory is
+ * overwritten with kPoison to expose later use.
+ */
+class Arena {
+ public:
+  //! Size of a chunk unless an allocation needs a larger one
+  static const size_t kChunkSize = 64 * 1024;
+
+  //! Byte written over released memory in poison mode
+  static const unsigned char kPoison = 0xdb;
+
+  //! Position of an arena to rewind to
+  struct Mark {
+    size_t chunk = 0;
+    size_t offset = 0;
+    size_t used = 0;
+    size_t peak = 0;
+  };
+
+  Arena() = default;
+
+  Arena(Arena const&) = delete;
+  Arena& operator=(Arena const&) = delete;
+
+  ~Arena();
+
+  //! Arena of the calling thread, created on first use
+  static Arena* GetCurrent() {
+    return mycurrent_ != nullptr ? mycurrent_ : createCurrent();
+  }
+
+  //! Arena of the calling thread, nullptr if it has none yet
+  static Arena* FindCurrent() { return mycurrent_; }
+
+  //! Overwrite released memory of all arenas with kPoison
+  static void SetPoison(bool poison) {
+    poison_.store(poison, std::memory_order_relaxed);
+  }
+
+  static bool IsPoisoned() { return poison_.load(std::memory_order_relaxed); }
+
+  //! Allocate size bytes aligned to align, a power of two
+  void* Allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+    if (chunk_ < chunks_.size()) {
+      auto& chunk = chunks_[chunk_];
+      // chunks are only aligned as malloc guarantees, align the address
+      uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data);
+      size_t offset = ((base + offset_ + align - 1) & ~(align - 1)) - base;
+      if (offset + size <= chunk.size) {
+        used_ += offset + size - offset_;
+        offset_ = offset + size;
+        if (used_ > peak_) peak_ = used_;
+        return chunk.data + offset;
+      }
+    }
+
+    return allocateSlow(size, align);
+  }
+
+  //! Take a mark to release to later, starting a new high-water mark
+  Mark GetMark() {
+    Mark mark = {chunk_, offset_, used_, peak_};
+    peak_ = used_;
+    return mark;
+  }
+
+  //! Release everything allocated since mark was taken
+  /*!
+   * A default mark releases everything.
+   *
+   * @return largest number of bytes in use since the mark
+   */
+  size_t Release(Mark const& mark) {
+    size_t peak = peak_ - mark.used;
+    if (chunk_ != mark.chunk || offset_ != mark.offset) rewind(mark);
+
+    // the high-water mark of the enclosing section includes this one
+    if (mark.peak > peak_) peak_ = mark.peak;
+    return peak;
+  }
+
+  //! Bytes in use, alignment padding included
+  size_t GetUsed() const { return used_; }
+
+  //! Largest number of bytes in use since the last open mark was taken
+  size_t GetPeak() const { return peak_; }
+
+  //! Bytes held in chunks
+  size_t GetCapacity() const;
+
+ protected:
+  struct Chunk {
+    char* data;
+    size_t size;
+  };
+
+  static Arena* createCurrent();
+
+  void* allocateSlow(size_t size, size_t align);
+
+  void rewind(Mark const& mark);
+
+  std::vector<Chunk> chunks_;
+  size_t chunk_ = 0;
+  size_t offset_ = 0;
+  size_t used_ = 0;
+
+  //! High-water mark of the innermost open section
+  size_t peak_ = 0;
+
+  inline static std::atomic<bool> poison_{false};
+
+  inline static thread_local Arena* mycurrent_ = nullptr;
+};
+
+//! Allocator of std containers drawing from the arena of a thread
+/*!
+ * Deallocation is a no-op; the memory is released with the section, see
+ * Arena. A container must only grow on the thread that owns the arena.
+ */
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  //! Allocate from the arena of the calling thread
+  ArenaAllocator() : arena_(Arena::GetCurrent()) {}
+
+  explicit ArenaAllocator(Arena* arena) : arena_(arena) {}
+
+  template <typename U>
+  ArenaAllocator(ArenaAllocator<U> const& other)
+      : arena_(other.GetArena()) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, size_t) {}
+
+  Arena* GetArena() const { return arena_; }
+
+  template <typename U>
+  bool operator==(ArenaAllocator<U> const& other) const {
+    return arena_ == other.GetArena();
+  }
+
+  template <typename U>
+  bool operator!=(ArenaAllocator<U> const& other) const {
+    return arena_ != other.GetArena();
+  }
+
+ protected:
+  Arena* arena_;
+};
+
+#endif  // SRC_ARENA_HPP_
@@ -0,0 +1,411 @@
+// C/C++
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// POSIX C extensions
+#include <fcntl.h>        // fcntl()
+#include <sys/mman.h>     // mmap()
+#include <sys/syscall.h>  // SYS_io_uring_setup, SYS_io_uring_enter
+#include <unistd.h>       // pwrite(), syscall()
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+// application
+#include "async_device.hpp"
+#include "exceptions.hpp"
+
+#if defined(__linux__) && defined(SYS_io_uring_setup) && \
+    defined(SYS_io_uring_enter)
+#define APP_HAS_URING 1
+#else
+#define APP_HAS_URING 0
+#endif
+
+//! Submission and completion rings shared with the kernel
+/*!
+ * Set up with the raw system calls, as liburing is not required. Only one
+ * thread uses the rings at a time, under the slot mutex of the device.
+ */
+struct AsyncFileDevice::Uring {
+#if APP_HAS_URING
+  ~Uring() {
+    if (sqes != nullptr) munmap(sqes, sqes_size);
+    if (cq_ring != nullptr && cq_ring != sq_ring) munmap(cq_ring, cq_size);
+    if (sq_ring != nullptr) munmap(sq_ring, sq_size);
+    if (fd >= 0) close(fd);
+  }
+
+  //! Create the rings, false if the kernel does not allow it
+  bool Setup(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    fd = syscall(SYS_io_uring_setup, entries, &params);
+    if (fd < 0) return false;
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes +
+              params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) sq_size = cq_size = std::max(sq_size, cq_size);
+
+    sq_ring = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+      sq_ring = nullptr;
+      return false;
+    }
+
+    if (single) {
+      cq_ring = sq_ring;
+    } else {
+      cq_ring = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+      if (cq_ring == MAP_FAILED) {
+        cq_ring = nullptr;
+        return false;
+      }
+    }
+
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ptr == MAP_FAILED) return false;
+    sqes = static_cast<struct io_uring_sqe*>(ptr);
+
+    char* sq = static_cast<char*>(sq_ring);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char* cq = static_cast<char*>(cq_ring);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    return true;
+  }
+
+  //! Queue a vectored write of one iovec, see Submit
+  void Write(int file, struct iovec const* iov, uint64_t offset,
+             uint64_t user_data) {
+    unsigned tail = *sq_tail;
+    unsigned index = tail & sq_mask;
+
+    struct io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = file;
+    sqe->addr = reinterpret_cast<uint64_t>(iov);
+    sqe->len = 1;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  //! Hand the queued writes to the kernel
+  /*!
+   * Writes the kernel did not take stay queued, EAGAIN and EBUSY ask to
+   * submit them again later.
+   *
+   * @return false with errno set if some are still queued
+   */
+  bool Submit() {
+    unsigned queued;
+    while ((queued = *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE)) >
+           0) {
+      if (syscall(SYS_io_uring_enter, fd, queued, 0, 0, nullptr, 0) < 0 &&
+          errno != EINTR) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //! Withdraw the queued writes that the kernel has not taken
+  void Cancel() {
+    __atomic_store_n(sq_tail, __atomic_load_n(sq_head, __ATOMIC_ACQUIRE),
+                     __ATOMIC_RELEASE);
+  }
+
+  //! Block until a completion is available
+  void Wait() {
+    while (syscall(SYS_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS,
+                   nullptr, 0) < 0) {
+      if (errno != EINTR) return;
+    }
+  }
+
+  //! Take the next completion, false if there is none
+  bool Next(uint64_t* user_data, int32_t* res) {
+    unsigned head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) return false;
+
+    struct io_uring_cqe const& cqe = cqes[head & cq_mask];
+    *user_data = cqe.user_data;
+    *res = cqe.res;
+
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  int fd = -1;
+
+  void* sq_ring = nullptr;
+  void* cq_ring = nullptr;
+  size_t sq_size = 0;
+  size_t cq_size = 0;
+
+  struct io_uring_sqe* sqes = nullptr;
+  size_t sqes_size = 0;
+
+  unsigned* sq_head = nullptr;
+  unsigned* sq_tail = nullptr;
+  unsigned sq_mask = 0;
+  unsigned* sq_array = nullptr;
+
+  unsigned* cq_head = nullptr;
+  unsigned* cq_tail = nullptr;
+  unsigned cq_mask = 0;
+  struct io_uring_cqe* cqes = nullptr;
+#else
+  bool Setup(unsigned) { return false; }
+  void Write(int, struct iovec const*, uint64_t, uint64_t) {}
+  bool Submit() {
+    errno = ENOSYS;
+    return false;
+  }
+  void Cancel() {}
+  void Wait() {}
+  bool Next(uint64_t*, int32_t*) { return false; }
+#endif
+};
+
+AsyncFileDevice::AsyncFileDevice(std::string const& fname, bool uring)
+    : FileDevice(fname), backend_(kThreadPool) {
+  // writes go to reserved offsets, which O_APPEND would ignore
+  int flags = fcntl(fd_, F_GETFL);
+  if (flags < 0 || fcntl(fd_, F_SETFL, flags & ~O_APPEND) < 0) {
+    throw RuntimeError("AsyncFileDevice", "Cannot write at offsets of " +
+                                              fname);
+  }
+  offset_.store(0);
+
+  for (int i = kMaxInFlight - 1; i >= 0; --i) free_slots_.push_back(i);
+
+  if (uring) {
+    uring_ = std::make_unique<Uring>();
+    if (uring_->Setup(kMaxInFlight)) {
+      backend_ = kUring;
+    } else {
+      uring_ = nullptr;
+    }
+  }
+
+  if (backend_ == kThreadPool) {
+    for (int i = 0; i < kThreads; ++i) {
+      writers_.emplace_back(&AsyncFileDevice::runWriter, this);
+    }
+  }
+}
+
+AsyncFileDevice::~AsyncFileDevice() {
+  // commit and wait here, the base classes cannot call back
+  Flush();
+
+  {
+    std::unique_lock<std::mutex> lock(slot_mutex_);
+    stop_ = true;
+  }
+  queue_cv_.notify_all();
+  for (auto& writer : writers_) writer.join();
+}
+
+bool AsyncFileDevice::EnableIndex() {
+  if (index_fd_.load() >= 0) return true;
+
+  // the file ends at the reserved offset once nothing is in flight
+  Flush();
+
+  std::unique_lock<std::shared_mutex> lock(commit_mutex_);
+  if (index_fd_.load() >= 0) return true;
+
+  std::string iname = fname_ + ".idx";
+  int index_fd =
+      open(iname.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+  if (index_fd < 0) {
+    throw RuntimeError("AsyncFileDevice::EnableIndex",
+                       "Cannot open file " + iname);
+  }
+
+  index_fd_.store(index_fd);
+  return true;
+}
+
+int64_t AsyncFileDevice::commit(struct iovec const* iov, int iovcnt) {
+  size_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) total += iov[i].iov_len;
+  if (total == 0) return offset_.load();
+
+  std::unique_lock<std::mutex> lock(slot_mutex_);
+  int slot = acquireSlot(lock);
+
+  // a taken slot belongs to this thread until it is submitted
+  lock.unlock();
+
+  Slot& s = slots_[slot];
+  s.data.clear();
+  for (int i = 0; i < iovcnt; ++i) {
+    s.data.append(static_cast<char const*>(iov[i].iov_base), iov[i].iov_len);
+  }
+
+  uint64_t offset = offset_.fetch_add(total);
+  s.offset = offset;
+  s.iov = {&s.data[0], s.data.size()};
+
+  lock.lock();
+  submit(slot);
+
+  // pick up finished writes and their errors without waiting
+  if (backend_ == kUring) reap(false);
+  return offset;
+}
+
+void AsyncFileDevice::drain() {
+  std::unique_lock<std::mutex> lock(slot_mutex_);
+
+  while (free_slots_.size() < static_cast<size_t>(kMaxInFlight)) {
+    if (backend_ == kUring) {
+      reap(true);
+    } else {
+      slot_cv_.wait(lock);
+    }
+  }
+}
+
+int AsyncFileDevice::acquireSlot(std::unique_lock<std::mutex>& lock) {
+  while (free_slots_.empty()) {
+    if (backend_ == kUring) {
+      reap(true);
+    } else {
+      slot_cv_.wait(lock);
+    }
+  }
+
+  int slot = free_slots_.back();
+  free_slots_.pop_back();
+  return slot;
+}
+
+void AsyncFileDevice::releaseSlot(int slot) {
+  free_slots_.push_back(slot);
+  slot_cv_.notify_all();
+}
+
+void AsyncFileDevice::submit(int slot) {
+  if (backend_ == kThreadPool) {
+    queue_.push_back(slot);
+    queue_cv_.notify_one();
+    return;
+  }
+
+  // the rings have room for every slot, so queueing never waits
+  Slot& s = slots_[slot];
+  uring_->Write(fd_, &s.iov, s.offset, slot);
+
+  // the kernel may be short of resources for a while
+  bool submitted = uring_->Submit();
+  for (int i = 0; !submitted && (errno == EAGAIN || errno == EBUSY) &&
+                  i < kSubmitRetries;
+       ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    submitted = uring_->Submit();
+  }
+  if (submitted) return;
+
+  // the data is not written, the slot is released with an error
+  int err = errno;
+  uring_->Cancel();
+  pushError("Cannot submit " + std::to_string(s.iov.iov_len) +
+            " bytes at offset " + std::to_string(s.offset) + " of " + fname_ +
+            ": " + strerror(err));
+  releaseSlot(slot);
+}
+
+void AsyncFileDevice::reap(bool wait) {
+  uint64_t slot;
+  int32_t res;
+
+  if (!uring_->Next(&slot, &res)) {
+    if (!wait) return;
+    do {
+      uring_->Wait();
+    } while (!uring_->Next(&slot, &res));
+  }
+
+  do {
+    bool done = res < 0 ? complete(slot, -1, -res) : complete(slot, res, 0);
+    if (done) {
+      releaseSlot(slot);
+    } else {
+      submit(slot);
+    }
+  } while (uring_->Next(&slot, &res));
+}
+
+bool AsyncFileDevice::complete(int slot, ssize_t n, int err) {
+  Slot& s = slots_[slot];
+
+  if (n < 0) {
+    // io_uring cancels the writes of a thread that exits, write them again
+    if (err == EINTR || err == EAGAIN || err == ECANCELED) return false;
+  } else if (n > 0) {
+    s.offset += n;
+    s.iov.iov_base = static_cast<char*>(s.iov.iov_base) + n;
+    s.iov.iov_len -= n;
+    return s.iov.iov_len == 0;
+  }
+
+  // failed, or no progress at all
+  pushError("Cannot write " + std::to_string(s.iov.iov_len) +
+            " bytes at offset " + std::to_string(s.offset) + " of " +
+            fname_ + ": " + (n < 0 ? strerror(err) : "nothing written"));
+  return true;
+}
+
+void AsyncFileDevice::runWriter() {
+  std::unique_lock<std::mutex> lock(slot_mutex_);
+
+  while (true) {
+    queue_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) return;
+
+    int slot = queue_.front();
+    queue_.pop_front();
+    Slot& s = slots_[slot];
+
+    // write without holding the lock, the slot belongs to this thread
+    bool done = false;
+    while (!done) {
+      lock.unlock();
+      ssize_t n = pwrite(fd_, s.iov.iov_base, s.iov.iov_len, s.offset);
+      int err = errno;
+      lock.lock();
+
+      done = complete(slot, n, err);
+    }
+
+    releaseSlot(slot);
+  }
+}
@@ -0,0 +1,119 @@
+#ifndef SRC_ASYNC_DEVICE_HPP_
+#define SRC_ASYNC_DEVICE_HPP_
+
+// C/C++
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX C extensions
+#include <sys/uio.h>  // iovec
+
+// application
+#include "device.hpp"
+
+//! File device whose commits do not wait for the write
+/*!
+ * A commit copies the records into one of kMaxInFlight slots, reserves
+ * their place in the file and hands the write to the kernel. The thread
+ * that filled its buffer goes on while the data is written. Writes are
+ * submitted through io_uring where the kernel allows it, and otherwise
+ * done by a pool of kThreads writer threads. Memory in flight is bounded
+ * by the slots. A commit waits for a free slot if all are in flight.
+ *
+ * Flush() and the destructor wait until every write has completed. Failed
+ * writes are queued as errors of the device, see Device::TakeErrors. A
+ * monitor writing to the device reports them with Monitor::Error.
+ *
+ * Monitors select the device with the prefix "async:" of a file name,
+ * e.g. InstallMonitor("hydro", "async:hydro.out", "hydro.err").
+ */
+class AsyncFileDevice : public FileDevice {
+ public:
+  //! Largest number of commits in flight
+  static const int kMaxInFlight = 8;
+
+  //! Writer threads without io_uring
+  static const int kThreads = 2;
+
+  //! Attempts, 1 ms apart, to submit to io_uring while it is busy
+  static const int kSubmitRetries = 1000;
+
+  enum Backend {
+    kUring = 0,       //!< io_uring
+    kThreadPool = 1,  //!< writer threads with pwrite
+  };
+
+  //! Open (and truncate) fname
+  /*!
+   * @param uring use io_uring if the kernel supports it
+   */
+  explicit AsyncFileDevice(std::string const& fname, bool uring = true);
+
+  ~AsyncFileDevice();
+
+  Backend GetBackend() const { return backend_; }
+
+  bool EnableIndex() override;
+
+ protected:
+  //! Copy of one commit while it is written
+  struct Slot {
+    std::string data;
+    uint64_t offset;   //!< file offset of the unwritten rest
+    struct iovec iov;  //!< unwritten rest of data
+  };
+
+  struct Uring;
+
+  int64_t commit(struct iovec const* iov, int iovcnt) override;
+
+  //! Wait until no write is in flight
+  void drain() override;
+
+  //! Take a free slot, waiting for a completion if there is none
+  int acquireSlot(std::unique_lock<std::mutex>& lock);
+
+  void releaseSlot(int slot);
+
+  //! Hand the unwritten rest of slot to the backend
+  void submit(int slot);
+
+  //! Process the io_uring completions that are ready
+  /*!
+   * @param wait block until there is at least one
+   */
+  void reap(bool wait);
+
+  //! Account for n bytes of slot written or a failure with errno err
+  /*!
+   * @return true if the slot is done, false to write the rest
+   */
+  bool complete(int slot, ssize_t n, int err);
+
+  void runWriter();
+
+  Backend backend_;
+
+  std::unique_ptr<Uring> uring_;
+
+  Slot slots_[kMaxInFlight];
+  std::vector<int> free_slots_;
+
+  std::mutex slot_mutex_;
+  std::condition_variable slot_cv_;
+
+  //! Slots waiting for a writer thread
+  std::deque<int> queue_;
+  std::condition_variable queue_cv_;
+  bool stop_ = false;
+  std::vector<std::thread> writers_;
+};
+
+#endif  // SRC_ASYNC_DEVICE_HPP_
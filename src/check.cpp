@@ -0,0 +1,351 @@
+// C/C++
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// application
+#include "check.hpp"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CHECK_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+//! Partial results of a scan
+struct Partial {
+  double sum = 0.;
+  double sumsq = 0.;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+};
+
+void report(ArrayStats* stats, size_t i) {
+  if (stats->nfirst < ArrayStats::kMaxReport) {
+    stats->first[stats->nfirst++] = i;
+  }
+}
+
+template <typename T>
+void scanScalar(T const* a, size_t begin, size_t end, double vmin,
+                double vmax, ArrayStats* stats, Partial* p) {
+  for (size_t i = begin; i < end; ++i) {
+    double x = a[i];
+    if (std::isnan(x)) {
+      stats->nnan++;
+      report(stats, i);
+    } else if (std::isinf(x)) {
+      stats->ninf++;
+      report(stats, i);
+    } else {
+      if (x < vmin || x > vmax) {
+        stats->nout++;
+        report(stats, i);
+      }
+      p->sum += x;
+      p->sumsq += x * x;
+      p->min = std::min(p->min, x);
+      p->max = std::max(p->max, x);
+    }
+  }
+}
+
+#ifdef CHECK_X86_KERNELS
+//! Classify the lanes of a vector that are not finite or out of range
+/*!
+ * Only called for vectors with at least one offending lane.
+ */
+template <typename T>
+void classifyLanes(T const* a, size_t base, int lanes, unsigned finite,
+                   unsigned out, ArrayStats* stats) {
+  for (int j = 0; j < lanes; ++j) {
+    if (!(finite >> j & 1)) {
+      if (std::isnan(a[base + j])) {
+        stats->nnan++;
+      } else {
+        stats->ninf++;
+      }
+      report(stats, base + j);
+    } else if (out >> j & 1) {
+      stats->nout++;
+      report(stats, base + j);
+    }
+  }
+}
+
+//! Smallest float not less than v
+float floatAbove(double v) {
+  float f = static_cast<float>(v);
+  if (static_cast<double>(f) < v) f = std::nextafter(f, HUGE_VALF);
+  return f;
+}
+
+//! Largest float not greater than v
+float floatBelow(double v) {
+  float f = static_cast<float>(v);
+  if (static_cast<double>(f) > v) f = std::nextafter(f, -HUGE_VALF);
+  return f;
+}
+
+__attribute__((target("avx2"))) size_t scanAVX2(double const* a, size_t n,
+                                                double vmin, double vmax,
+                                                ArrayStats* stats,
+                                                Partial* p) {
+  const __m256d lo = _mm256_set1_pd(vmin);
+  const __m256d hi = _mm256_set1_pd(vmax);
+  const __m256d pinf = _mm256_set1_pd(HUGE_VAL);
+  const __m256d ninf = _mm256_set1_pd(-HUGE_VAL);
+  const __m256d absmask =
+      _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+
+  __m256d sum = _mm256_setzero_pd(), sumsq = _mm256_setzero_pd();
+  __m256d vlo = pinf, vhi = ninf;
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d x = _mm256_loadu_pd(a + i);
+    __m256d finite =
+        _mm256_cmp_pd(_mm256_and_pd(x, absmask), pinf, _CMP_LT_OQ);
+    __m256d out = _mm256_and_pd(
+        finite, _mm256_or_pd(_mm256_cmp_pd(x, lo, _CMP_LT_OQ),
+                             _mm256_cmp_pd(x, hi, _CMP_GT_OQ)));
+
+    __m256d xf = _mm256_and_pd(x, finite);
+    sum = _mm256_add_pd(sum, xf);
+    sumsq = _mm256_add_pd(sumsq, _mm256_mul_pd(xf, xf));
+    vlo = _mm256_min_pd(vlo, _mm256_blendv_pd(pinf, x, finite));
+    vhi = _mm256_max_pd(vhi, _mm256_blendv_pd(ninf, x, finite));
+
+    unsigned mfinite = _mm256_movemask_pd(finite);
+    unsigned mout = _mm256_movemask_pd(out);
+    if (mfinite != 0xf || mout != 0) {
+      classifyLanes(a, i, 4, mfinite, mout, stats);
+    }
+  }
+
+  alignas(32) double buf[4][4];
+  _mm256_store_pd(buf[0], sum);
+  _mm256_store_pd(buf[1], sumsq);
+  _mm256_store_pd(buf[2], vlo);
+  _mm256_store_pd(buf[3], vhi);
+  for (int j = 0; j < 4; ++j) {
+    p->sum += buf[0][j];
+    p->sumsq += buf[1][j];
+    p->min = std::min(p->min, buf[2][j]);
+    p->max = std::max(p->max, buf[3][j]);
+  }
+
+  return i;
+}
+
+__attribute__((target("avx2"))) size_t scanAVX2(float const* a, size_t n,
+                                                double vmin, double vmax,
+                                                ArrayStats* stats,
+                                                Partial* p) {
+  // float bounds that compare like the double bounds
+  const __m256 lo = _mm256_set1_ps(floatAbove(vmin));
+  const __m256 hi = _mm256_set1_ps(floatBelow(vmax));
+  const __m256 pinf = _mm256_set1_ps(HUGE_VALF);
+  const __m256 ninf = _mm256_set1_ps(-HUGE_VALF);
+  const __m256 absmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+  __m256d sum = _mm256_setzero_pd(), sumsq = _mm256_setzero_pd();
+  __m256 vlo = pinf, vhi = ninf;
+
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 x = _mm256_loadu_ps(a + i);
+    __m256 finite = _mm256_cmp_ps(_mm256_and_ps(x, absmask), pinf, _CMP_LT_OQ);
+    __m256 out = _mm256_and_ps(
+        finite, _mm256_or_ps(_mm256_cmp_ps(x, lo, _CMP_LT_OQ),
+                             _mm256_cmp_ps(x, hi, _CMP_GT_OQ)));
+
+    // accumulate in double precision
+    __m256 xf = _mm256_and_ps(x, finite);
+    __m256d x0 = _mm256_cvtps_pd(_mm256_castps256_ps128(xf));
+    __m256d x1 = _mm256_cvtps_pd(_mm256_extractf128_ps(xf, 1));
+    sum = _mm256_add_pd(sum, _mm256_add_pd(x0, x1));
+    sumsq = _mm256_add_pd(
+        sumsq, _mm256_add_pd(_mm256_mul_pd(x0, x0), _mm256_mul_pd(x1, x1)));
+    vlo = _mm256_min_ps(vlo, _mm256_blendv_ps(pinf, x, finite));
+    vhi = _mm256_max_ps(vhi, _mm256_blendv_ps(ninf, x, finite));
+
+    unsigned mfinite = _mm256_movemask_ps(finite);
+    unsigned mout = _mm256_movemask_ps(out);
+    if (mfinite != 0xff || mout != 0) {
+      classifyLanes(a, i, 8, mfinite, mout, stats);
+    }
+  }
+
+  alignas(32) double buf[2][4];
+  alignas(32) float fbuf[2][8];
+  _mm256_store_pd(buf[0], sum);
+  _mm256_store_pd(buf[1], sumsq);
+  _mm256_store_ps(fbuf[0], vlo);
+  _mm256_store_ps(fbuf[1], vhi);
+  for (int j = 0; j < 4; ++j) {
+    p->sum += buf[0][j];
+    p->sumsq += buf[1][j];
+  }
+  for (int j = 0; j < 8; ++j) {
+    p->min = std::min(p->min, static_cast<double>(fbuf[0][j]));
+    p->max = std::max(p->max, static_cast<double>(fbuf[1][j]));
+  }
+
+  return i;
+}
+
+__attribute__((target("avx512f"))) size_t scanAVX512(double const* a,
+                                                     size_t n, double vmin,
+                                                     double vmax,
+                                                     ArrayStats* stats,
+                                                     Partial* p) {
+  const __m512d lo = _mm512_set1_pd(vmin);
+  const __m512d hi = _mm512_set1_pd(vmax);
+  const __m512d pinf = _mm512_set1_pd(HUGE_VAL);
+
+  __m512d sum = _mm512_setzero_pd(), sumsq = _mm512_setzero_pd();
+  __m512d vlo = pinf, vhi = _mm512_set1_pd(-HUGE_VAL);
+
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d x = _mm512_loadu_pd(a + i);
+    __mmask8 finite = _mm512_cmp_pd_mask(_mm512_abs_pd(x), pinf, _CMP_LT_OQ);
+    __mmask8 out = _mm512_mask_cmp_pd_mask(finite, x, lo, _CMP_LT_OQ) |
+                   _mm512_mask_cmp_pd_mask(finite, x, hi, _CMP_GT_OQ);
+
+    __m512d xf = _mm512_maskz_mov_pd(finite, x);
+    sum = _mm512_add_pd(sum, xf);
+    sumsq = _mm512_add_pd(sumsq, _mm512_mul_pd(xf, xf));
+    vlo = _mm512_mask_min_pd(vlo, finite, vlo, x);
+    vhi = _mm512_mask_max_pd(vhi, finite, vhi, x);
+
+    if (finite != 0xff || out != 0) {
+      classifyLanes(a, i, 8, finite, out, stats);
+    }
+  }
+
+  p->sum += _mm512_reduce_add_pd(sum);
+  p->sumsq += _mm512_reduce_add_pd(sumsq);
+  p->min = std::min(p->min, _mm512_reduce_min_pd(vlo));
+  p->max = std::max(p->max, _mm512_reduce_max_pd(vhi));
+
+  return i;
+}
+
+__attribute__((target("avx512f"))) size_t scanAVX512(float const* a, size_t n,
+                                                     double vmin, double vmax,
+                                                     ArrayStats* stats,
+                                                     Partial* p) {
+  const __m512 lo = _mm512_set1_ps(floatAbove(vmin));
+  const __m512 hi = _mm512_set1_ps(floatBelow(vmax));
+  const __m512 pinf = _mm512_set1_ps(HUGE_VALF);
+
+  __m512d sum = _mm512_setzero_pd(), sumsq = _mm512_setzero_pd();
+  __m512 vlo = pinf, vhi = _mm512_set1_ps(-HUGE_VALF);
+
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512 x = _mm512_loadu_ps(a + i);
+    __mmask16 finite =
+        _mm512_cmp_ps_mask(_mm512_abs_ps(x), pinf, _CMP_LT_OQ);
+    __mmask16 out = _mm512_mask_cmp_ps_mask(finite, x, lo, _CMP_LT_OQ) |
+                    _mm512_mask_cmp_ps_mask(finite, x, hi, _CMP_GT_OQ);
+
+    // accumulate in double precision
+    __m512 xf = _mm512_maskz_mov_ps(finite, x);
+    __m512d x0 = _mm512_cvtps_pd(_mm512_castps512_ps256(xf));
+    __m512d x1 = _mm512_cvtps_pd(_mm256_castpd_ps(
+        _mm512_extractf64x4_pd(_mm512_castps_pd(xf), 1)));
+    sum = _mm512_add_pd(sum, _mm512_add_pd(x0, x1));
+    sumsq = _mm512_add_pd(
+        sumsq, _mm512_add_pd(_mm512_mul_pd(x0, x0), _mm512_mul_pd(x1, x1)));
+    vlo = _mm512_mask_min_ps(vlo, finite, vlo, x);
+    vhi = _mm512_mask_max_ps(vhi, finite, vhi, x);
+
+    if (finite != 0xffff || out != 0) {
+      classifyLanes(a, i, 16, finite, out, stats);
+    }
+  }
+
+  p->sum += _mm512_reduce_add_pd(sum);
+  p->sumsq += _mm512_reduce_add_pd(sumsq);
+  p->min = std::min(p->min, static_cast<double>(_mm512_reduce_min_ps(vlo)));
+  p->max = std::max(p->max, static_cast<double>(_mm512_reduce_max_ps(vhi)));
+
+  return i;
+}
+#endif  // CHECK_X86_KERNELS
+
+template <typename T>
+ArrayStats checkArray(T const* a, size_t n, double vmin, double vmax,
+                      CheckISA isa) {
+  ArrayStats stats;
+  Partial p;
+  size_t i = 0;
+
+  stats.count = n;
+
+  // never run instructions the cpu does not have
+  if (static_cast<int>(isa) > static_cast<int>(GetCheckISA())) {
+    isa = GetCheckISA();
+  }
+
+#ifdef CHECK_X86_KERNELS
+  if (isa == CheckISA::kAVX512) {
+    i = scanAVX512(a, n, vmin, vmax, &stats, &p);
+  } else if (isa == CheckISA::kAVX2) {
+    i = scanAVX2(a, n, vmin, vmax, &stats, &p);
+  }
+#endif
+
+  // remainder, or the whole array without vector kernels
+  scanScalar(a, i, n, vmin, vmax, &stats, &p);
+
+  size_t nfinite = n - stats.nnan - stats.ninf;
+  if (nfinite > 0) {
+    stats.min = p.min;
+    stats.max = p.max;
+    stats.mean = p.sum / nfinite;
+    stats.l2 = std::sqrt(p.sumsq);
+  }
+
+  return stats;
+}
+
+}  // namespace
+
+CheckISA GetCheckISA() {
+  static const CheckISA isa = []() {
+#ifdef CHECK_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return CheckISA::kAVX512;
+    if (__builtin_cpu_supports("avx2")) return CheckISA::kAVX2;
+#endif
+    return CheckISA::kScalar;
+  }();
+
+  return isa;
+}
+
+char const* GetCheckISAName(CheckISA isa) {
+  switch (isa) {
+    case CheckISA::kAVX512:
+      return "avx512";
+    case CheckISA::kAVX2:
+      return "avx2";
+    default:
+      return "scalar";
+  }
+}
+
+ArrayStats CheckArray(float const* a, size_t n, double vmin, double vmax,
+                      CheckISA isa) {
+  return checkArray(a, n, vmin, vmax, isa);
+}
+
+ArrayStats CheckArray(double const* a, size_t n, double vmin, double vmax,
+                      CheckISA isa) {
+  return checkArray(a, n, vmin, vmax, isa);
+}
@@ -0,0 +1,62 @@
+#ifndef SRC_CHECK_HPP_
+#define SRC_CHECK_HPP_
+
+// C/C++
+#include <cstddef>
+#include <cstdint>
+
+//! Health statistics of an array of floating point numbers
+/*!
+ * min, max, mean and l2 are taken over the finite elements only.
+ */
+struct ArrayStats {
+  //! Number of offending indices remembered
+  static const int kMaxReport = 8;
+
+  size_t count = 0;  //!< number of elements
+  size_t nnan = 0;   //!< number of NaN
+  size_t ninf = 0;   //!< number of +/-Inf
+  size_t nout = 0;   //!< number of finite elements outside [vmin, vmax]
+
+  double min = 0.;
+  double max = 0.;
+  double mean = 0.;
+  double l2 = 0.;  //!< Euclidean norm
+
+  //! First offending indices, in increasing order
+  size_t first[kMaxReport];
+  int nfirst = 0;
+
+  bool IsValid() const { return nnan == 0 && ninf == 0 && nout == 0; }
+};
+
+//! Instruction sets available for array checks
+enum class CheckISA {
+  kScalar = 0,
+  kAVX2 = 1,
+  kAVX512 = 2,
+};
+
+//! Best instruction set supported by the running cpu
+CheckISA GetCheckISA();
+
+//! Name of an instruction set, e.g. "avx2"
+char const* GetCheckISAName(CheckISA isa);
+
+//! Scan an array for NaN, Inf and values outside [vmin, vmax]
+/*!
+ * Statistics are computed in the same pass.
+ *
+ * @param a    pointer to the elements
+ * @param n    number of elements
+ * @param vmin smallest valid value
+ * @param vmax largest valid value
+ * @param isa  instruction set to use, must be supported by the cpu
+ */
+ArrayStats CheckArray(float const* a, size_t n, double vmin, double vmax,
+                      CheckISA isa = GetCheckISA());
+
+ArrayStats CheckArray(double const* a, size_t n, double vmin, double vmax,
+                      CheckISA isa = GetCheckISA());
+
+#endif  // SRC_CHECK_HPP_
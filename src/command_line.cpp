@@ -21,11 +21,20 @@ CommandLine::CommandLine(int argc, char** argv):
   input_filename(nullptr),
   restart_filename(nullptr),
   prundir(nullptr),
+  affinity(nullptr),
+  control(nullptr),
   res_flag(0),
   narg_flag(0),
   iarg_flag(0),
   mesh_flag(0),
   wtlim(0),
+  heartbeat(0.),
+  flight(0),
+  watchdog(0.),
+  watchdog_abort(0),
+  imbalance(0),
+  index(0),
+  log_stats(0),
   argc(0),
   argv(nullptr)
 {}
@@ -64,6 +73,8 @@ CommandLine* CommandLine::ParseArguments(int argc, char** argv) {
         // options that do not take arguments:
         case 'n':
         case 'c':
+        case 'x':
+        case 's':
         case 'h':
           break;
           // options that require arguments:
@@ -88,6 +99,22 @@ CommandLine* CommandLine::ParseArguments(int argc, char** argv) {
         case 'd':  // -d <run_directory>
           mycli_->prundir = argv[++i];
           break;
+        case 'a':  // -a <affinity_policy>
+          mycli_->affinity = argv[++i];
+          break;
+        case 'w':  // -w <seconds>
+          mycli_->watchdog = std::strtod(argv[++i], nullptr);
+          break;
+        case 'W':  // -W <seconds>
+          mycli_->watchdog = std::strtod(argv[++i], nullptr);
+          mycli_->watchdog_abort = 1;
+          break;
+        case 'p':  // -p <checks>
+          mycli_->imbalance = static_cast<int>(std::strtol(argv[++i], nullptr, 10));
+          break;
+        case 'k':  // -k <control_file>
+          mycli_->control = argv[++i];
+          break;
         case 'n':
           mycli_->narg_flag = 1;
           break;
@@ -99,6 +126,18 @@ CommandLine* CommandLine::ParseArguments(int argc, char** argv) {
           std::sscanf(argv[++i], "%d:%d:%d", &wth, &wtm, &wts);
           mycli_->wtlim = wth * 3600 + wtm * 60 + wts;
           break;
+        case 'b':  // -b <seconds>
+          mycli_->heartbeat = std::strtod(argv[++i], nullptr);
+          break;
+        case 'f':  // -f <nrecords>
+          mycli_->flight = static_cast<int>(std::strtol(argv[++i], nullptr, 10));
+          break;
+        case 'x':
+          mycli_->index = 1;
+          break;
+        case 's':
+          mycli_->log_stats = 1;
+          break;
         case 'c':
           // if (Globals::my_rank == 0) ShowConfig();
 #ifdef MPI_PARALLEL
@@ -115,6 +154,24 @@ CommandLine* CommandLine::ParseArguments(int argc, char** argv) {
             std::cout << "  -i <file>       specify input file\n";
             std::cout << "  -r <file>       restart with this file\n";
             std::cout << "  -d <directory>  specify run dir [current dir]\n";
+            std::cout << "  -a <policy>     bind ranks: none|compact|scatter|"
+                         "cpu lists\n";
+            std::cout << "  -b <seconds>    write a heartbeat line every "
+                         "seconds\n";
+            std::cout << "  -f <nrecords>   keep the last records of each "
+                         "thread for crash dumps\n";
+            std::cout << "  -w <seconds>    report a rank without progress "
+                         "for seconds\n";
+            std::cout << "  -W <seconds>    report and abort a rank without "
+                         "progress\n";
+            std::cout << "  -p <checks>     report load imbalance across "
+                         "ranks every checks steps\n";
+            std::cout << "  -k <file>       apply control file on SIGHUP or "
+                         "SIGUSR1\n";
+            std::cout << "  -x              index log files for logindex "
+                         "queries and merges\n";
+            std::cout << "  -s              summarize logging volume and "
+                         "latency at exit\n";
             std::cout << "  -c              show configuration and quit\n";
             std::cout << "  -t hh:mm:ss     wall time limit for final output\n";
             std::cout << "  -h              this help\n";
@@ -126,8 +183,8 @@ CommandLine* CommandLine::ParseArguments(int argc, char** argv) {
           return mycli_;
           break;
       }
-    }  // else if argv[i] not of form "-?" ignore it here (tested in
-       // ModifyFromCmdline)
+    }  // else if argv[i] not of form "-?" ignore it here (applied by
+       // Parameters::ApplyOverrides)
   }
 
   return mycli_;
@@ -9,11 +9,20 @@ public:
   char *input_filename;
   char *restart_filename;
   char *prundir;
+  char *affinity;
+  char *control;
   int res_flag;
   int narg_flag;
   int iarg_flag;
   int mesh_flag;
   int wtlim;
+  double heartbeat;
+  int flight;
+  double watchdog;
+  int watchdog_abort;
+  int imbalance;
+  int index;
+  int log_stats;
   int argc;
   char **argv;
 
@@ -0,0 +1,122 @@
+// C/C++
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// application
+#include "application.hpp"
+#include "control.hpp"
+#include "exceptions.hpp"
+#include "profiler.hpp"
+
+static bool parseLevel(std::string const& name, Monitor::Level* level) {
+  static const std::pair<char const*, Monitor::Level> levels[] = {
+      {"debug", Monitor::kDebug}, {"log", Monitor::kLog},
+      {"warn", Monitor::kWarn},   {"error", Monitor::kError},
+      {"off", Monitor::kOff},
+  };
+
+  for (auto const& it : levels) {
+    if (name == it.first) {
+      *level = it.second;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int Control::Apply(std::string const& fname, Application* app) {
+  std::ifstream in(fname);
+  if (!in) {
+    app->GetMonitor(APP_MONITOR("main"))
+        ->Warn("Cannot open control file " + fname);
+    return 0;
+  }
+
+  int napplied = 0;
+  int nline = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    nline++;
+
+    auto comment = line.find('#');
+    if (comment != std::string::npos) line.erase(comment);
+    if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+    bool applied;
+    try {
+      applied = ApplyCommand(line, app);
+    } catch (ExceptionBase const&) {
+      applied = false;
+    }
+
+    if (applied) {
+      napplied++;
+    } else {
+      app->GetMonitor(APP_MONITOR("main"))
+          ->Warn(fname + ":" + std::to_string(nline) +
+                 ": cannot apply \"" + line + "\"");
+    }
+  }
+
+  return napplied;
+}
+
+bool Control::ApplyCommand(std::string const& line, Application* app) {
+  std::istringstream ss(line);
+  std::vector<std::string> words;
+  for (std::string word; ss >> word;) words.push_back(word);
+
+  if (words.empty()) return false;
+  auto const& command = words[0];
+
+  if (command == "level" && words.size() == 3) {
+    Monitor::Level level;
+    if (!parseLevel(words[2], &level)) return false;
+
+    if (words[1] == "*") {
+      for (auto const& name : app->GetMonitorNames()) {
+        app->GetMonitor(name)->SetLevel(level);
+      }
+    } else if (app->HasMonitor(words[1])) {
+      app->GetMonitor(words[1])->SetLevel(level);
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  if (command == "output" && (words.size() == 3 || words.size() == 4)) {
+    return app->InstallMonitor(words[1], words[2],
+                               words.size() == 4 ? words[3] : words[2]);
+  }
+
+  if (command == "profile" && words.size() == 2) {
+    if (words[1] == "on") {
+      Profiler::Enable();
+    } else if (words[1] == "off") {
+      Profiler::Disable();
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  if (command == "dump" && (words.size() == 2 || words.size() == 3)) {
+    if (words[1] == "profile") {
+      auto fname = words.size() == 3 ? words[2] : "profile.txt";
+      std::ofstream out(Application::GetRankFileName(fname));
+      out << app->GetProfile();
+      return out.good();
+    } else if (words[1] == "metrics") {
+      auto fname = words.size() == 3 ? words[2] : "metrics.prom";
+      app->GetMetrics()->Export(Application::GetRankFileName(fname));
+      return true;
+    }
+    return false;
+  }
+
+  return false;
+}
@@ -0,0 +1,48 @@
+#ifndef SRC_CONTROL_HPP_
+#define SRC_CONTROL_HPP_
+
+// C/C++
+#include <string>
+
+class Application;
+
+//! Runtime reconfiguration of logging and profiling from a control file
+/*!
+ * The control file holds one command per line, "#" starts a comment:
+ *
+ *   level <monitor|*> debug|log|warn|error|off
+ *   output <monitor> <log file> [<error file>]
+ *   profile on|off
+ *   dump profile [<file>]       default profile.txt
+ *   dump metrics [<file>]       default metrics.prom
+ *
+ * Dump files get the rank suffix of Application::GetRankFileName. With
+ * the command line option -k <file>, the file is read and applied on the
+ * next Signal::CheckSignalFlags after SIGHUP or SIGUSR1, e.g.
+ *
+ *   echo "level hydro debug" > control.txt; kill -HUP <pid>
+ *
+ * Levels and profiling change without locking the writers. A new output
+ * is installed with Application::InstallMonitor, which switches the
+ * devices of the monitor atomically. Records being written meanwhile go
+ * to the old device, which stays open with the context.
+ */
+class Control {
+ public:
+  //! Read fname and apply its commands to app
+  /*!
+   * Lines that cannot be applied are reported as warnings on monitor
+   * "main" of app.
+   *
+   * @return number of commands applied
+   */
+  static int Apply(std::string const& fname, Application* app);
+
+  //! Apply one command
+  /*!
+   * @return false if the command is not understood
+   */
+  static bool ApplyCommand(std::string const& line, Application* app);
+};
+
+#endif  // SRC_CONTROL_HPP_
@@ -0,0 +1,524 @@
+// C/C++
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX C extensions
+#include <fcntl.h>    // open(), fcntl()
+#include <unistd.h>   // close(), lseek(), write()
+#include <sys/uio.h>  // writev(), pwritev()
+
+// application
+#include "device.hpp"
+#include "exceptions.hpp"
+
+//! Serial number of the next device, starting at 1
+static std::atomic<uint64_t> next_serial(1);
+
+//! Background thread of Device::StartFlusher and the devices it watches
+struct Flusher {
+  std::vector<std::weak_ptr<Device>> watched;
+  std::thread thread;
+  bool stop = false;
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+//! Never destroyed, the thread may still run when the program exits
+static Flusher* getFlusher() {
+  static Flusher* flusher = new Flusher();
+  return flusher;
+}
+
+Device::Device() : serial_(next_serial++) {}
+
+Device::~Device() {
+  if (index_fd_.load() >= 0) close(index_fd_.load());
+}
+
+//! Append a number in decimal
+static void appendNumber(std::string* out, uint64_t value) {
+  char buf[24];
+  auto end = std::to_chars(buf, buf + sizeof(buf), value).ptr;
+  out->append(buf, end - buf);
+}
+
+//! Append the index line of a record, except for its offset
+static void appendIndexLine(std::string* out, size_t length,
+                            RecordInfo const& info) {
+  out->push_back('\t');
+  appendNumber(out, length);
+  out->push_back('\t');
+  appendNumber(out, info.seq);
+  out->push_back('\t');
+  appendNumber(out, info.time);
+  out->push_back('\t');
+  out->append(info.monitor);
+  out->push_back('\t');
+  out->append(info.section);
+  out->push_back('\n');
+}
+
+void Device::Write(struct iovec const* iov, int iovcnt,
+                   RecordInfo const* info) {
+  bool indexed = info != nullptr && index_fd_.load() >= 0;
+
+  size_t length = 0;
+  for (int i = 0; i < iovcnt; ++i) length += iov[i].iov_len;
+
+  records_.Add();
+  bytes_.Add(length);
+
+  auto mode = policy_mode_.load(std::memory_order_acquire);
+  if (mode == FlushPolicy::kRecord) {
+    int64_t offset = timedCommit(iov, iovcnt);
+    if (indexed) {
+      std::string index;
+      appendIndexLine(&index, length, *info);
+      writeIndex(offset, index, {0});
+    }
+    return;
+  }
+
+  auto buf = getBuffer();
+  std::unique_lock<std::mutex> lock(buf->mutex);
+
+  if (indexed) {
+    buf->index_offsets.push_back(buf->data.size());
+    appendIndexLine(&buf->index, length, *info);
+  }
+
+  for (int i = 0; i < iovcnt; ++i) {
+    buf->data.append(static_cast<char const*>(iov[i].iov_base),
+                     iov[i].iov_len);
+  }
+
+  bool full;
+  if (mode == FlushPolicy::kBytes) {
+    full = buf->data.size() >= policy_bytes_.load(std::memory_order_relaxed);
+  } else {
+    std::chrono::duration<double> age =
+        std::chrono::steady_clock::now() - buf->last_commit;
+    full = age.count() >= policy_interval_.load(std::memory_order_relaxed);
+  }
+
+  if (full) commitBuffer(buf);
+}
+
+void Device::Flush() {
+  {
+    std::unique_lock<std::mutex> lock(buffer_mutex_);
+
+    for (auto& it : buffers_) {
+      std::unique_lock<std::mutex> buffer_lock(it.second->mutex);
+      commitBuffer(it.second.get());
+    }
+  }
+
+  drain();
+}
+
+void Device::SetFlushPolicy(FlushPolicy const& policy) {
+  Flush();
+
+  policy_bytes_.store(policy.bytes, std::memory_order_relaxed);
+  policy_interval_.store(policy.interval, std::memory_order_relaxed);
+  policy_mode_.store(policy.mode, std::memory_order_release);
+}
+
+FlushPolicy Device::GetFlushPolicy() const {
+  FlushPolicy policy;
+  policy.mode = policy_mode_.load(std::memory_order_acquire);
+  policy.bytes = policy_bytes_.load(std::memory_order_relaxed);
+  policy.interval = policy_interval_.load(std::memory_order_relaxed);
+  return policy;
+}
+
+void Device::FlushStale(double max_age) {
+  FlushPolicy policy = GetFlushPolicy();
+
+  double limit = 0.;
+  if (policy.mode == FlushPolicy::kBytes) limit = max_age;
+  if (policy.mode == FlushPolicy::kInterval) limit = policy.interval;
+
+  auto now = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(buffer_mutex_);
+
+  for (auto& it : buffers_) {
+    Buffer* buf = it.second.get();
+    std::unique_lock<std::mutex> buffer_lock(buf->mutex);
+
+    std::chrono::duration<double> age = now - buf->last_commit;
+    if (!buf->data.empty() && age.count() >= limit) commitBuffer(buf);
+  }
+}
+
+void Device::StartFlusher(double period) {
+  StopFlusher();
+
+  auto flusher = getFlusher();
+  std::unique_lock<std::mutex> lock(flusher->mutex);
+  flusher->stop = false;
+
+  flusher->thread = std::thread([flusher, period]() {
+    auto wait = std::chrono::duration<double>(period);
+    std::vector<std::shared_ptr<Device>> devices;
+
+    std::unique_lock<std::mutex> lock(flusher->mutex);
+    while (!flusher->cv.wait_for(lock, wait,
+                                 [flusher]() { return flusher->stop; })) {
+      auto& watched = flusher->watched;
+      for (auto it = watched.begin(); it != watched.end();) {
+        auto device = it->lock();
+        if (device == nullptr) {
+          it = watched.erase(it);
+        } else {
+          devices.push_back(device);
+          ++it;
+        }
+      }
+
+      // commit without the lock, a device released last is destroyed here
+      lock.unlock();
+      for (auto const& device : devices) device->FlushStale(period);
+      devices.clear();
+      lock.lock();
+    }
+  });
+}
+
+void Device::StopFlusher() {
+  auto flusher = getFlusher();
+  if (!flusher->thread.joinable()) return;
+
+  {
+    std::unique_lock<std::mutex> lock(flusher->mutex);
+    flusher->stop = true;
+  }
+  flusher->cv.notify_all();
+
+  flusher->thread.join();
+}
+
+void Device::Watch(std::shared_ptr<Device> const& device) {
+  auto flusher = getFlusher();
+  std::unique_lock<std::mutex> lock(flusher->mutex);
+
+  auto& watched = flusher->watched;
+  watched.erase(std::remove_if(watched.begin(), watched.end(),
+                               [](std::weak_ptr<Device> const& w) {
+                                 return w.expired();
+                               }),
+                watched.end());
+  watched.push_back(device);
+}
+
+std::vector<std::string> Device::TakeErrors() {
+  std::unique_lock<std::mutex> lock(error_mutex_);
+
+  std::vector<std::string> errors;
+  errors.swap(errors_);
+  if (dropped_errors_ > 0) {
+    errors.push_back("and " + std::to_string(dropped_errors_) +
+                     " more failed writes");
+    dropped_errors_ = 0;
+  }
+  nerrors_.store(0, std::memory_order_relaxed);
+
+  return errors;
+}
+
+void Device::pushError(std::string const& msg) {
+  std::unique_lock<std::mutex> lock(error_mutex_);
+
+  if (errors_.size() < kMaxErrors) {
+    errors_.push_back(msg);
+  } else {
+    dropped_errors_++;
+  }
+  nerrors_.fetch_add(1, std::memory_order_relaxed);
+}
+
+Device::Buffer* Device::getBuffer() {
+  // small cache of the buffers this thread used last, keyed by device serial
+  static thread_local std::array<std::pair<uint64_t, Buffer*>, 8> cache = {};
+  static thread_local size_t next = 0;
+
+  for (auto const& entry : cache) {
+    if (entry.first == serial_) return entry.second;
+  }
+
+  std::unique_lock<std::mutex> lock(buffer_mutex_);
+
+  auto& buf = buffers_[std::this_thread::get_id()];
+  if (buf == nullptr) {
+    buf = std::make_unique<Buffer>();
+    buf->last_commit = std::chrono::steady_clock::now();
+  }
+
+  cache[next] = {serial_, buf.get()};
+  next = (next + 1) % cache.size();
+
+  return buf.get();
+}
+
+void Device::commitBuffer(Buffer* buf) {
+  if (buf->data.size() > 0) {
+    struct iovec iov = {&buf->data[0], buf->data.size()};
+    int64_t offset = timedCommit(&iov, 1);
+    buf->data.clear();
+
+    if (!buf->index_offsets.empty()) {
+      writeIndex(offset, buf->index, buf->index_offsets);
+      buf->index.clear();
+      buf->index_offsets.clear();
+    }
+  }
+
+  buf->last_commit = std::chrono::steady_clock::now();
+}
+
+int64_t Device::timedCommit(struct iovec const* iov, int iovcnt) {
+  std::shared_lock<std::shared_mutex> lock(commit_mutex_);
+
+  auto start = std::chrono::steady_clock::now();
+  int64_t offset = commit(iov, iovcnt);
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  commit_latency_.Observe(elapsed.count());
+  return offset;
+}
+
+void Device::writeIndex(int64_t offset, std::string const& index,
+                        std::vector<uint64_t> const& offsets) {
+  int fd = index_fd_.load();
+  if (offset < 0 || fd < 0) return;
+
+  // prefix each line with the offset of its record in the file
+  std::string lines;
+  lines.reserve(index.size() + offsets.size() * 12);
+
+  size_t pos = 0;
+  for (auto rel : offsets) {
+    appendNumber(&lines, offset + rel);
+
+    size_t next = index.find('\n', pos) + 1;
+    lines.append(index, pos, next - pos);
+    pos = next;
+  }
+
+  // O_APPEND keeps the lines of concurrent commits whole
+  char const* data = lines.data();
+  size_t size = lines.size();
+  while (size > 0) {
+    ssize_t n = write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    data += n;
+    size -= n;
+  }
+}
+
+FileDevice::FileDevice(std::string const& fname) : fname_(fname), offset_(0) {
+  fd_ = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+  if (fd_ < 0) {
+    throw RuntimeError("FileDevice", "Cannot open file " + fname);
+  }
+}
+
+FileDevice::~FileDevice() {
+  Flush();
+  close(fd_);
+}
+
+bool FileDevice::EnableIndex() {
+  if (index_fd_.load() >= 0) return true;
+
+  Flush();
+
+  // no commit is in flight while the file changes to positioned writes
+  std::unique_lock<std::shared_mutex> lock(commit_mutex_);
+  if (index_fd_.load() >= 0) return true;
+
+  std::string iname = fname_ + ".idx";
+  int index_fd =
+      open(iname.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+  if (index_fd < 0) {
+    throw RuntimeError("FileDevice::EnableIndex", "Cannot open file " + iname);
+  }
+
+  // the offset of an O_APPEND write is not known, reserve space instead
+  int flags = fcntl(fd_, F_GETFL);
+  if (flags < 0 || fcntl(fd_, F_SETFL, flags & ~O_APPEND) < 0) {
+    close(index_fd);
+    return false;
+  }
+  offset_.store(lseek(fd_, 0, SEEK_END));
+
+  index_fd_.store(index_fd);
+  return true;
+}
+
+int64_t FileDevice::commit(struct iovec const* iov, int iovcnt) {
+  std::vector<struct iovec> rest(iov, iov + iovcnt);
+  struct iovec* pos = rest.data();
+
+  if (index_fd_.load() >= 0) {
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) total += iov[i].iov_len;
+
+    uint64_t offset = offset_.fetch_add(total);
+    size_t done = 0;
+
+    while (done < total) {
+      ssize_t n = pwritev(fd_, pos, iovcnt, offset + done);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+
+        // the index must not point into the hole left behind
+        pushError("Cannot write " + std::to_string(total - done) +
+                  " bytes at offset " + std::to_string(offset + done) +
+                  " of " + fname_ + ": " + strerror(errno));
+        return -1;
+      }
+
+      done += n;
+      while (iovcnt > 0 && static_cast<size_t>(n) >= pos->iov_len) {
+        n -= pos->iov_len;
+        pos++;
+        iovcnt--;
+      }
+
+      if (iovcnt > 0) {
+        pos->iov_base = static_cast<char*>(pos->iov_base) + n;
+        pos->iov_len -= n;
+      }
+    }
+
+    return offset;
+  }
+
+  // O_APPEND writes whole records at the end of the file in one call; only
+  // an interrupted or partial write has to continue with the remainder
+  while (iovcnt > 0) {
+    ssize_t n = writev(fd_, pos, iovcnt);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+
+      size_t rest = 0;
+      for (int i = 0; i < iovcnt; ++i) rest += pos[i].iov_len;
+      pushError("Cannot write " + std::to_string(rest) + " bytes to " +
+                fname_ + ": " + strerror(errno));
+      return -1;
+    }
+
+    while (iovcnt > 0 && static_cast<size_t>(n) >= pos->iov_len) {
+      n -= pos->iov_len;
+      pos++;
+      iovcnt--;
+    }
+
+    if (iovcnt > 0) {
+      pos->iov_base = static_cast<char*>(pos->iov_base) + n;
+      pos->iov_len -= n;
+    }
+  }
+
+  return -1;
+}
+
+StreamDevice::~StreamDevice() { Flush(); }
+
+int64_t StreamDevice::commit(struct iovec const* iov, int iovcnt) {
+  std::unique_lock<std::mutex> lock(stream_mutex_);
+
+  for (int i = 0; i < iovcnt; ++i) {
+    os_->write(static_cast<char const*>(iov[i].iov_base), iov[i].iov_len);
+  }
+
+  return -1;
+}
+
+Sidecar::Sidecar(std::string const& fname) : fname_(fname), offset_(0) {
+  fd_ = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd_ < 0) {
+    throw RuntimeError("Sidecar", "Cannot open file " + fname);
+  }
+}
+
+Sidecar::~Sidecar() { close(fd_); }
+
+uint64_t Sidecar::Write(char const* dtype, void const* data, size_t elsize,
+                        std::vector<size_t> const& shape) {
+  if (shape.size() > static_cast<size_t>(kMaxDims)) {
+    throw RuntimeError("Sidecar::Write",
+                       "Arrays have at most " + std::to_string(kMaxDims) +
+                           " dimensions");
+  }
+
+  size_t dtype_len = std::strlen(dtype);
+  if (dtype_len > 8) {
+    throw RuntimeError("Sidecar::Write", "Type name " + std::string(dtype) +
+                                             " is longer than 8 characters");
+  }
+
+  struct {
+    char magic[8];
+    char dtype[8];
+    uint32_t ndim;
+    uint32_t reserved;
+    uint64_t shape[kMaxDims];
+    uint64_t nbytes;
+  } header;
+  static_assert(sizeof(header) == kAlignment, "Sidecar header size");
+
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, "APPARRAY", 8);
+  std::memcpy(header.dtype, dtype, dtype_len);
+  header.ndim = shape.size();
+
+  size_t count = 1;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    header.shape[i] = shape[i];
+    count *= shape[i];
+  }
+  header.nbytes = count * elsize;
+
+  uint64_t size = (sizeof(header) + header.nbytes + kAlignment - 1) /
+                  kAlignment * kAlignment;
+  uint64_t offset = offset_.fetch_add(size);
+
+  struct iovec iov[2] = {{&header, sizeof(header)},
+                         {const_cast<void*>(data), header.nbytes}};
+  size_t total = sizeof(header) + header.nbytes;
+  size_t done = 0;
+
+  while (done < total) {
+    ssize_t n = pwritev(fd_, iov, 2, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw RuntimeError("Sidecar::Write", "Cannot write to " + fname_);
+    }
+
+    done += n;
+    for (auto& piece : iov) {
+      size_t skip = std::min(piece.iov_len, static_cast<size_t>(n));
+      piece.iov_base = static_cast<char*>(piece.iov_base) + skip;
+      piece.iov_len -= skip;
+      n -= skip;
+    }
+  }
+
+  return offset;
+}
@@ -0,0 +1,336 @@
+#ifndef SRC_DEVICE_HPP_
+#define SRC_DEVICE_HPP_
+
+// C/C++
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX C extensions
+#include <sys/uio.h>  // iovec
+
+// application
+#include "metrics.hpp"
+
+//! When buffered records of a device are committed
+struct FlushPolicy {
+  enum Mode {
+    kRecord = 0,    //!< commit every record immediately
+    kBytes = 1,     //!< commit when a thread has buffered this many bytes
+    kInterval = 2,  //!< commit when the last commit is older than interval
+  };
+
+  Mode mode = kRecord;
+  size_t bytes = 0;
+  double interval = 0.;
+
+  static FlushPolicy PerRecord() { return {kRecord, 0, 0.}; }
+
+  static FlushPolicy PerBytes(size_t n) { return {kBytes, n, 0.}; }
+
+  static FlushPolicy PerInterval(double seconds) {
+    return {kInterval, 0, seconds};
+  }
+};
+
+//! Description of a record for the index of a device
+struct RecordInfo {
+  uint64_t seq;         //!< sequence number within the process
+  uint64_t time;        //!< nanoseconds since the epoch
+  char const* monitor;  //!< monitor name
+  char const* section;  //!< section ID, e.g. "4.2.1."
+};
+
+//! Output device shared by monitors
+/*!
+ * A device accepts whole records, e.g. one log line, from any number of
+ * threads. Each thread appends to its own buffer, so writers do not contend
+ * with each other. Buffered records are committed to the underlying file
+ * with one write, so that records of different threads never interleave
+ * within a line. When a thread's buffer is committed is decided by the
+ * flush policy of the device.
+ *
+ * A device counts the records and bytes written to it and the time of
+ * each commit, see GetCommitLatency().
+ *
+ * The policy is checked when a thread writes. Buffers that wait longer,
+ * e.g. of threads that stopped writing or have exited, are committed by a
+ * background flusher, see StartFlusher().
+ */
+class Device {
+ public:
+  Device();
+
+  //! Derived destructors commit what is left in the buffers
+  virtual ~Device();
+
+  //! Write one record given in pieces
+  /*!
+   * @param info description of the record for the index, if any
+   */
+  void Write(struct iovec const* iov, int iovcnt,
+             RecordInfo const* info = nullptr);
+
+  //! Write one record
+  void Write(char const* data, size_t size, RecordInfo const* info = nullptr) {
+    struct iovec iov = {const_cast<char*>(data), size};
+    Write(&iov, 1, info);
+  }
+
+  void Write(std::string const& record) {
+    Write(record.data(), record.size());
+  }
+
+  //! Commit the buffered records of all threads
+  /*!
+   * Returns when the records are written, also on devices that write in
+   * the background.
+   */
+  void Flush();
+
+  //! Commit buffered records and change the flush policy
+  /*!
+   * Threads writing meanwhile see the old or the new policy.
+   */
+  void SetFlushPolicy(FlushPolicy const& policy);
+
+  FlushPolicy GetFlushPolicy() const;
+
+  //! Commit the buffers that waited longer than the policy allows
+  /*!
+   * Buffers of kInterval devices are committed once older than the
+   * interval, those of kBytes devices once older than max_age seconds.
+   * Unlike Flush(), this does not wait for background writes.
+   */
+  void FlushStale(double max_age);
+
+  //! Commit stale buffers of the watched devices every period seconds
+  /*!
+   * A background thread calls FlushStale(period) on each watched device. A
+   * running flusher is stopped first. Application::Start starts the
+   * flusher, and devices installed in an application are watched.
+   */
+  static void StartFlusher(double period);
+
+  //! Stop the flusher thread
+  static void StopFlusher();
+
+  //! Let the flusher commit stale buffers of device while it exists
+  static void Watch(std::shared_ptr<Device> const& device);
+
+  //! Write an index of the records that come with a RecordInfo
+  /*!
+   * Each indexed record adds a line to the index file
+   *
+   *   offset <tab> length <tab> seq <tab> time <tab> monitor <tab> section
+   *
+   * with the byte offset and length of the record in the device file, see
+   * log_index.hpp. Records written before are not indexed. Other threads
+   * may write meanwhile, their commits wait while the index is enabled.
+   *
+   * @return false if the device cannot be indexed
+   */
+  virtual bool EnableIndex() { return false; }
+
+  bool IsIndexed() const { return index_fd_.load() >= 0; }
+
+  //! Number of records written
+  uint64_t GetRecords() const { return records_.Value(); }
+
+  //! Number of bytes written
+  uint64_t GetBytes() const { return bytes_.Value(); }
+
+  //! Seconds spent in each commit to the underlying file
+  /*!
+   * The number of observations is the number of commits.
+   */
+  Histogram const& GetCommitLatency() const { return commit_latency_; }
+
+  //! Whether commits to the underlying file have failed
+  bool HasErrors() const {
+    return nerrors_.load(std::memory_order_relaxed) > 0;
+  }
+
+  //! Take the messages of failed commits
+  /*!
+   * At most kMaxErrors messages are kept until they are taken. A last
+   * message counts the failures beyond them.
+   */
+  std::vector<std::string> TakeErrors();
+
+  //! Largest number of error messages kept
+  static const size_t kMaxErrors = 16;
+
+  //! Buckets of write and commit latencies, 250 ns to about 1 s
+  static std::vector<double> LatencyBuckets() {
+    return Histogram::ExponentialBuckets(250.e-9, 4., 12);
+  }
+
+ protected:
+  //! Per-thread append buffer
+  struct Buffer {
+    std::mutex mutex;
+    std::string data;
+    std::chrono::steady_clock::time_point last_commit;
+
+    //! Index lines without the offset, one per indexed record
+    std::string index;
+
+    //! Offsets of the indexed records within data
+    std::vector<uint64_t> index_offsets;
+  };
+
+  //! Write whole records to the underlying file
+  /*!
+   * Implementations write all pieces with a single call if possible.
+   *
+   * @return offset of the first byte in the file, or -1 if unknown
+   */
+  virtual int64_t commit(struct iovec const* iov, int iovcnt) = 0;
+
+  //! Commit under a shared commit lock and observe the time it took
+  int64_t timedCommit(struct iovec const* iov, int iovcnt);
+
+  //! Wait for the commits that are still being written, called by Flush
+  virtual void drain() {}
+
+  //! Queue the error of a failed commit, see TakeErrors
+  void pushError(std::string const& msg);
+
+  //! Append the index lines of records committed at offset
+  void writeIndex(int64_t offset, std::string const& index,
+                  std::vector<uint64_t> const& offsets);
+
+  Buffer* getBuffer();
+
+  void commitBuffer(Buffer* buf);
+
+  //! Flush policy, the mode is stored last so it selects a current limit
+  std::atomic<FlushPolicy::Mode> policy_mode_{FlushPolicy::kRecord};
+  std::atomic<size_t> policy_bytes_{0};
+  std::atomic<double> policy_interval_{0.};
+
+  //! Unique number of this device, never reused within the process
+  uint64_t serial_;
+
+  std::map<std::thread::id, std::unique_ptr<Buffer>> buffers_;
+  std::mutex buffer_mutex_;
+
+  //! Index file, -1 if the device is not indexed
+  std::atomic<int> index_fd_{-1};
+
+  //! Held shared by commits and exclusively by EnableIndex
+  std::shared_mutex commit_mutex_;
+
+  Counter records_;
+  Counter bytes_;
+  Histogram commit_latency_{LatencyBuckets()};
+
+  //! Failed commits not yet taken
+  std::vector<std::string> errors_;
+  uint64_t dropped_errors_ = 0;
+  std::atomic<uint64_t> nerrors_{0};
+  std::mutex error_mutex_;
+};
+
+//! Device writing to a file opened for appending
+class FileDevice : public Device {
+ public:
+  //! Open (and truncate) fname
+  explicit FileDevice(std::string const& fname);
+
+  ~FileDevice();
+
+  std::string const& GetFileName() const { return fname_; }
+
+  //! Index the file into fname.idx
+  /*!
+   * Records are no longer appended with O_APPEND. Space for each commit is
+   * reserved atomically instead, so that its offset is known.
+   */
+  bool EnableIndex() override;
+
+ protected:
+  int64_t commit(struct iovec const* iov, int iovcnt) override;
+
+  std::string fname_;
+  int fd_;
+
+  //! End of the reserved part of the file when indexed
+  std::atomic<uint64_t> offset_;
+};
+
+//! Device writing to a C++ output stream such as std::cout
+/*!
+ * The stream is not owned by the device.
+ */
+class StreamDevice : public Device {
+ public:
+  explicit StreamDevice(std::ostream* os) : os_(os) {}
+
+  ~StreamDevice();
+
+ protected:
+  int64_t commit(struct iovec const* iov, int iovcnt) override;
+
+  std::ostream* os_;
+  std::mutex stream_mutex_;
+};
+
+//! Binary file holding bulk numeric arrays referenced from text logs
+/*!
+ * Each array is stored as a 64-byte header followed by the raw data in
+ * native byte order. Headers start at multiples of 64 bytes:
+ *
+ *   char     magic[8]   "APPARRAY"
+ *   char     dtype[8]   e.g. "float64", "int32"
+ *   uint32_t ndim       number of dimensions, at most 4
+ *   uint32_t reserved
+ *   uint64_t shape[4]   extent of each dimension, row-major
+ *   uint64_t nbytes     size of the data following the header
+ *
+ * Space for an array is reserved atomically, so threads write their arrays
+ * concurrently without locking.
+ */
+class Sidecar {
+ public:
+  static const size_t kAlignment = 64;
+  static const int kMaxDims = 4;
+
+  //! Open (and truncate) fname
+  explicit Sidecar(std::string const& fname);
+
+  ~Sidecar();
+
+  //! Append an array
+  /*!
+   * @param dtype  name of the element type
+   * @param data   pointer to the elements
+   * @param elsize size of one element in bytes
+   * @param shape  extents of the array, at most kMaxDims
+   * @return offset of the array header in the file
+   */
+  uint64_t Write(char const* dtype, void const* data, size_t elsize,
+                 std::vector<size_t> const& shape);
+
+  std::string const& GetFileName() const { return fname_; }
+
+ protected:
+  std::string fname_;
+  int fd_;
+  std::atomic<uint64_t> offset_;
+};
+
+using DevicePtr = std::shared_ptr<Device>;
+
+using DeviceMap = std::map<std::string, DevicePtr>;
+
+#endif  // SRC_DEVICE_HPP_
@@ -1,6 +1,14 @@
 // C/C++
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <string>
 
+// POSIX C extensions
+#include <cxxabi.h>    // abi::__cxa_demangle()
+#include <dlfcn.h>     // dladdr()
+#include <execinfo.h>  // backtrace()
+
 // application
 #include "exceptions.hpp"
 
@@ -8,22 +16,102 @@ static const char* stars =
     ("*****************************************"
      "**************************************\n");
 
+std::atomic<int> ExceptionBase::backtrace_depth_(16);
+
 ExceptionBase::ExceptionBase(const std::string& procedure)
-    : procedure_(procedure) {}
+    : procedure_(procedure) {
+  captureFrames();
+}
+
+// not inlined, so that exactly one frame of its own is skipped
+__attribute__((noinline)) void ExceptionBase::captureFrames() {
+  int depth = backtrace_depth_.load(std::memory_order_relaxed);
+  if (depth <= 0) return;
+
+  void* frames[kMaxFrames + 1];
+  int n = backtrace(frames, depth + 1);
+  nframes_ = n > 1 ? n - 1 : 0;
+  for (int i = 0; i < nframes_; ++i) frames_[i] = frames[i + 1];
+}
+
+void ExceptionBase::SetBacktraceDepth(int depth) {
+  if (depth < 0) depth = 0;
+  if (depth > kMaxFrames) depth = kMaxFrames;
+  backtrace_depth_.store(depth);
+}
+
+std::string ExceptionBase::GetBacktrace() const {
+  std::string result;
+
+  for (int i = 0; i < nframes_; ++i) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "  #%-2d %p ", i, frames_[i]);
+    result += buf;
+
+    // return addresses point behind the call, look up the call itself
+    Dl_info info;
+    void* pc = static_cast<char*>(frames_[i]) - 1;
+    if (dladdr(pc, &info) == 0) {
+      result += "??\n";
+      continue;
+    }
+
+    if (info.dli_sname != nullptr) {
+      int status;
+      char* name = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr,
+                                       &status);
+      result += status == 0 ? name : info.dli_sname;
+      free(name);
+
+      snprintf(buf, sizeof(buf), "+0x%lx",
+               static_cast<unsigned long>(
+                   reinterpret_cast<uintptr_t>(frames_[i]) -
+                   reinterpret_cast<uintptr_t>(info.dli_saddr)));
+      result += buf;
+    } else {
+      // static functions have no dynamic symbol, give the module offset
+      snprintf(buf, sizeof(buf), "+0x%lx",
+               static_cast<unsigned long>(
+                   reinterpret_cast<uintptr_t>(frames_[i]) -
+                   reinterpret_cast<uintptr_t>(info.dli_fbase)));
+      result += "??";
+      result += buf;
+    }
+
+    if (info.dli_fname != nullptr) {
+      result += " in ";
+      result += info.dli_fname;
+    }
+    result += "\n";
+  }
+
+  return result;
+}
 
 const char* ExceptionBase::what() const throw() {
+  if (!formatted_message_.empty()) return formatted_message_.c_str();
+
   try {
-    formatted_message_ = "\n";
-    formatted_message_ += stars;
-    formatted_message_ += GetClass();
+    std::string msg = GetMessage();
+    std::string trace = GetBacktrace();
+
+    std::string& out = formatted_message_;
+    out.reserve(2 * 80 + 32 + procedure_.size() + msg.size() + trace.size());
+    out += "\n";
+    out += stars;
+    out += GetClass();
     if (procedure_.size()) {
-      formatted_message_ += " thrown by " + procedure_;
+      out += " thrown by ";
+      out += procedure_;
     }
-    formatted_message_ += ":\n" + GetMessage();
-    if (formatted_message_.compare(formatted_message_.size() - 1, 1, "\n")) {
-      formatted_message_.append("\n");
+    out += ":\n";
+    out += msg;
+    if (out.back() != '\n') out += '\n';
+    if (!trace.empty()) {
+      out += "Backtrace:\n";
+      out += trace;
     }
-    formatted_message_ += stars;
+    out += stars;
   } catch (...) {
     // Not able to format the message
   }
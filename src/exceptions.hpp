@@ -2,8 +2,11 @@
 #define SRC_EXCEPTIONS_HPP_
 
 // C/C++
+#include <atomic>
 #include <exception>
+#include <optional>
 #include <string>
+#include <utility>
 
 //! Base class for exceptions
 /*!
@@ -11,20 +14,49 @@
  * from std::exception so that normal error handling operations from
  * applications may automatically handle the errors in their own way.
  *
+ * The constructor records the raw return addresses of the throwing call
+ * stack, see SetBacktraceDepth(). They are only resolved to function
+ * names when the backtrace is asked for, by what() or GetBacktrace().
+ *
  * @ingroup errorhandling
  */
 class ExceptionBase : public std::exception {
  public:
+  //! Largest number of frames recorded by the constructor
+  static const int kMaxFrames = 32;
+
   //! Normal Constructor for the ExceptionBase class
   ExceptionBase(const std::string& procedure, const std::string& msg)
-      : procedure_(procedure), msg_(msg) {}
+      : procedure_(procedure), msg_(msg) {
+    captureFrames();
+  }
 
   //! Destructor for base class does nothing
   virtual ~ExceptionBase() throw() {}
 
   //! Get a description of the error
+  /*!
+   * The description, including the backtrace, is formatted on the first
+   * call and kept for later calls.
+   */
   const char* what() const throw();
 
+  //! Symbolized backtrace of the constructor's caller, one frame per line
+  std::string GetBacktrace() const;
+
+  //! Number of frames recorded
+  int GetNumFrames() const { return nframes_; }
+
+  //! Set the number of frames recorded by later exceptions
+  /*!
+   * The default is 16. 0 turns recording off.
+   */
+  static void SetBacktraceDepth(int depth);
+
+  static int GetBacktraceDepth() {
+    return backtrace_depth_.load(std::memory_order_relaxed);
+  }
+
   //! Method overridden by derived classes to format the error message
   virtual std::string GetMessage() const;
 
@@ -37,16 +69,24 @@ class ExceptionBase : public std::exception {
  protected:
   //! Protected default constructor discourages throwing errors containing no
   //! information.
-  ExceptionBase() {}
+  ExceptionBase() { captureFrames(); }
 
   //! Constructor used by derived classes that override GetMessage()
   explicit ExceptionBase(const std::string& procedure);
 
+  //! Record the return addresses of the current call stack
+  void captureFrames();
+
   //! The name of the procedure where the exception occurred
   std::string procedure_;
   mutable std::string
       formatted_message_;  //!< Formatted message returned by what()
 
+  void* frames_[kMaxFrames];  //!< Return addresses, innermost first
+  int nframes_ = 0;
+
+  static std::atomic<int> backtrace_depth_;
+
  private:
   std::string msg_;  //!< Message associated with the exception
 };
@@ -129,10 +169,19 @@ class NotFoundError : public ExceptionBase {
   explicit NotFoundError(const std::string& some)
       : ExceptionBase(some, "Not Found.") {}
 
+  //! @param some What was not found, may be followed by lines of advice
   NotFoundError(const std::string& func, std::string const& some)
-      : ExceptionBase(func, some + " not found.") {}
+      : ExceptionBase(func, notFound(some)) {}
 
   virtual std::string GetClass() const { return "NotFoundError"; }
+
+ protected:
+  //! End the first line of some with " not found."
+  static std::string notFound(std::string const& some) {
+    auto eol = some.find('\n');
+    if (eol == std::string::npos) return some + " not found.";
+    return some.substr(0, eol) + " not found." + some.substr(eol);
+  }
 };
 
 //! An error indicating that a value was wrong
@@ -159,4 +208,72 @@ class RuntimeError : public ExceptionBase {
   virtual std::string GetClass() const { return "RuntimeError"; }
 };
 
+//! Result of an operation that may fail without throwing
+/*!
+ * Lookups whose callers expect misses return an Expected instead of
+ * throwing, so that a miss costs neither an exception object nor stack
+ * unwinding:
+ *
+ *   auto path = app->TryFindResource("extra.yaml");
+ *   if (path) load(path.Value());
+ *
+ * A failed result keeps the procedure and message of the error. Value()
+ * of a failed result throws them as an exception of type E, so the
+ * throwing variant of a lookup is TryLookup(...).Value().
+ *
+ * @ingroup errorhandling
+ */
+template <typename T, typename E = RuntimeError>
+class Expected {
+ public:
+  Expected(T const& value) : value_(value) {}
+
+  Expected(T&& value) : value_(std::move(value)) {}
+
+  //! Failed result
+  static Expected Error(std::string const& procedure,
+                        std::string const& msg) {
+    Expected result;
+    result.procedure_ = procedure;
+    result.msg_ = msg;
+    return result;
+  }
+
+  bool HasValue() const { return value_.has_value(); }
+
+  explicit operator bool() const { return value_.has_value(); }
+
+  //! The value, or throw E(procedure, message) if there is none
+  T& Value() & {
+    if (!value_) throw E(procedure_, msg_);
+    return *value_;
+  }
+
+  T const& Value() const& {
+    if (!value_) throw E(procedure_, msg_);
+    return *value_;
+  }
+
+  T&& Value() && {
+    if (!value_) throw E(procedure_, msg_);
+    return std::move(*value_);
+  }
+
+  //! The value, or fallback if there is none
+  T ValueOr(T fallback) const { return value_ ? *value_ : fallback; }
+
+  //! Procedure that failed, empty if there is a value
+  std::string const& GetMethod() const { return procedure_; }
+
+  //! Message of the error, empty if there is a value
+  std::string const& GetMessage() const { return msg_; }
+
+ protected:
+  Expected() = default;
+
+  std::optional<T> value_;
+  std::string procedure_;
+  std::string msg_;
+};
+
 #endif  // SRC_EXCEPTIONS_HPP_
@@ -0,0 +1,270 @@
+// C/C++
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+// POSIX C extensions
+#include <fcntl.h>   // open()
+#include <time.h>    // clock_gettime()
+#include <unistd.h>  // write(), unlink()
+
+// application
+#include "application.hpp"
+#include "flight_recorder.hpp"
+#include "globals.hpp"
+#include "signal.hpp"
+
+static std::mutex ring_mutex;
+
+//! Held while a dump is written
+static std::atomic_flag dumping = ATOMIC_FLAG_INIT;
+
+static uint64_t nowNanoseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+//! Output buffer for the signal handler, written with write(2) only
+class DumpWriter {
+ public:
+  explicit DumpWriter(int fd) : fd_(fd), len_(0) {}
+
+  ~DumpWriter() { flush(); }
+
+  void Append(char const* data, size_t size) {
+    while (size > 0) {
+      if (len_ == sizeof(buf_)) flush();
+      size_t n = std::min(size, sizeof(buf_) - len_);
+      memcpy(buf_ + len_, data, n);
+      len_ += n;
+      data += n;
+      size -= n;
+    }
+  }
+
+  void Append(char const* str) { Append(str, strlen(str)); }
+
+  void Append(uint64_t value) {
+    char digits[24];
+    int n = 0;
+    do {
+      digits[n++] = '0' + value % 10;
+      value /= 10;
+    } while (value > 0);
+
+    char str[24];
+    for (int i = 0; i < n; ++i) str[i] = digits[n - 1 - i];
+    Append(str, n);
+  }
+
+ protected:
+  void flush() {
+    char const* pos = buf_;
+    while (len_ > 0) {
+      ssize_t n = write(fd_, pos, len_);
+      if (n <= 0) break;
+      pos += n;
+      len_ -= n;
+    }
+    len_ = 0;
+  }
+
+  int fd_;
+  size_t len_;
+  char buf_[4096];
+};
+
+void FlightRecorder::Enable(size_t nrecords, std::string const& fname) {
+  std::unique_lock<std::mutex> lock(ring_mutex);
+
+  std::string rank_fname = Application::GetRankFileName(fname);
+  snprintf(fname_, sizeof(fname_), "%s", rank_fname.c_str());
+  unlink(fname_);
+
+  // threads take fresh rings with their next record
+  nrecords_ = std::max(nrecords, size_t(1));
+  generation_++;
+  enabled_.store(true);
+
+  Signal::CatchFatalSignals(onFatalSignal);
+}
+
+void FlightRecorder::Disable() {
+  std::unique_lock<std::mutex> lock(ring_mutex);
+
+  if (!enabled_.load()) return;
+
+  Signal::CatchFatalSignals(nullptr);
+
+  // the rings stay allocated, writers may still hold them
+  enabled_.store(false);
+  generation_++;
+}
+
+void FlightRecorder::Record(struct iovec const* iov, int iovcnt) {
+  Ring* ring = getRing();
+  if (ring == nullptr) return;
+
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  Slot& slot = ring->slots[head % ring->nrecords];
+
+  size_t size = 0;
+  for (int i = 0; i < iovcnt && size < kRecordSize; ++i) {
+    size_t n = std::min(iov[i].iov_len, kRecordSize - size);
+    memcpy(slot.data + size, iov[i].iov_base, n);
+    size += n;
+  }
+
+  slot.size = size;
+  slot.time = nowNanoseconds();
+
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+void FlightRecorder::Dump(char const* reason) {
+  // do not wait for ever on a dump that a crash interrupted
+  bool locked = false;
+  for (int i = 0; i < 10000000 && !locked; ++i) {
+    locked = !dumping.test_and_set(std::memory_order_acquire);
+  }
+
+  int fd = open(fname_, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd >= 0) {
+    uint64_t now = nowNanoseconds();
+
+    DumpWriter out(fd);
+    out.Append("# Flight recorder dump on ");
+    out.Append(reason);
+    out.Append(", rank ");
+    out.Append(static_cast<uint64_t>(Globals::my_rank));
+    out.Append("\n");
+
+    uint64_t generation = generation_.load(std::memory_order_acquire);
+    int nrings = std::min(nrings_.load(std::memory_order_acquire),
+                          kMaxThreads);
+    for (int i = 0; i < nrings; ++i) {
+      Ring* ring = rings_[i].load(std::memory_order_acquire);
+      if (ring == nullptr) continue;
+
+      // rings of a previous Enable hold discarded records
+      if (ring->generation.load(std::memory_order_acquire) != generation) {
+        continue;
+      }
+
+      uint64_t head = ring->head.load(std::memory_order_acquire);
+      uint64_t first = head > ring->nrecords ? head - ring->nrecords : 0;
+
+      out.Append("# thread ");
+      out.Append(static_cast<uint64_t>(ring->thread.load()));
+      out.Append(", last ");
+      out.Append(head - first);
+      out.Append(" of ");
+      out.Append(head);
+      out.Append(" records\n");
+
+      for (uint64_t r = first; r < head; ++r) {
+        Slot const& slot = ring->slots[r % ring->nrecords];
+        uint64_t age = now > slot.time ? (now - slot.time) / 1000 : 0;
+
+        out.Append(age);
+        out.Append(" us ago, ");
+        out.Append(slot.data, slot.size);
+        if (slot.size == 0 || slot.data[slot.size - 1] != '\n') {
+          out.Append("\n");
+        }
+      }
+    }
+  }
+
+  // the writer flushes before the file is closed
+  if (fd >= 0) close(fd);
+
+  if (locked) dumping.clear(std::memory_order_release);
+}
+
+FlightRecorder::Ring* FlightRecorder::getRing() {
+  static thread_local Holder holder;
+
+  uint64_t generation = generation_.load(std::memory_order_acquire);
+  if (holder.generation == generation) return holder.ring;
+
+  std::unique_lock<std::mutex> lock(ring_mutex);
+
+  generation = generation_.load();
+  if (!enabled_.load()) {
+    holder.release();
+  } else if (holder.ring == nullptr || holder.ring->nrecords != nrecords_) {
+    holder.release();
+    holder.ring = claimRing();
+  }
+
+  // records of a previous Enable are discarded
+  if (holder.ring != nullptr) {
+    holder.ring->head.store(0, std::memory_order_relaxed);
+    holder.ring->generation.store(generation, std::memory_order_release);
+  }
+
+  holder.generation = generation;
+  return holder.ring;
+}
+
+FlightRecorder::Ring* FlightRecorder::claimRing() {
+  // keep the records of exited threads until all rings are taken
+  int nrings = nrings_.load();
+  if (nrings == kMaxThreads) {
+    for (int i = 0; i < nrings; ++i) {
+      Ring* ring = rings_[i].load();
+      if (ring->nrecords == nrecords_ && !ring->owned.exchange(true)) {
+        ring->thread.store(nclaimed_++);
+        return ring;
+      }
+    }
+    return nullptr;
+  }
+
+  Ring* ring = new Ring;
+  ring->thread.store(nclaimed_++);
+  ring->nrecords = nrecords_;
+  ring->head.store(0);
+  ring->slots = new Slot[nrecords_];
+  ring->owned.store(true);
+  ring->generation.store(0);
+
+  rings_[nrings].store(ring, std::memory_order_release);
+  nrings_.store(nrings + 1, std::memory_order_release);
+  return ring;
+}
+
+void FlightRecorder::onFatalSignal(int s) {
+  switch (s) {
+    case SIGSEGV:
+      Dump("SIGSEGV");
+      break;
+    case SIGBUS:
+      Dump("SIGBUS");
+      break;
+    case SIGFPE:
+      Dump("SIGFPE");
+      break;
+    case SIGABRT:
+      Dump("SIGABRT");
+      break;
+    default:
+      Dump("signal");
+      break;
+  }
+}
+
+const int FlightRecorder::kMaxThreads;
+std::atomic<bool> FlightRecorder::enabled_(false);
+std::atomic<uint64_t> FlightRecorder::generation_(1);
+size_t FlightRecorder::nrecords_ = 0;
+std::atomic<FlightRecorder::Ring*> FlightRecorder::rings_[kMaxThreads] = {};
+std::atomic<int> FlightRecorder::nrings_(0);
+int FlightRecorder::nclaimed_ = 0;
+char FlightRecorder::fname_[256] = "flight.log";
@@ -0,0 +1,130 @@
+#ifndef SRC_FLIGHT_RECORDER_HPP_
+#define SRC_FLIGHT_RECORDER_HPP_
+
+// C/C++
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// POSIX C extensions
+#include <sys/uio.h>  // iovec
+
+//! In-memory ring of the most recent records of each thread
+/*!
+ * When enabled, monitors copy every record into a ring of the calling
+ * thread, including records whose level is filtered out of the log
+ * device, together with section transitions. The rings cost no I/O.
+ * They are dumped to a per-rank file when a fatal signal (SIGSEGV,
+ * SIGBUS, SIGFPE, SIGABRT) arrives and on every Monitor::Error, so that
+ * a crashed rank leaves the context of the crash behind even if file
+ * logging was buffered or disabled.
+ *
+ * Records longer than kRecordSize are truncated. Dump() only uses
+ * async-signal-safe system calls.
+ *
+ * Rings are never freed while the process runs, since other threads and
+ * the signal handler may still hold them. A thread gives its ring back
+ * when it exits. Once kMaxThreads rings exist, threads that start
+ * recording reuse the rings of exited threads.
+ */
+class FlightRecorder {
+ public:
+  //! Size of one record slot in bytes
+  static const size_t kRecordSize = 256;
+
+  //! Largest number of threads with a ring
+  static const int kMaxThreads = 256;
+
+  //! Start recording the last nrecords records of each thread
+  /*!
+   * Records of a previous Enable are discarded and a previous dump file
+   * is removed. The file name of rank r gets the suffix ".r<r>" if there
+   * is more than one rank. Rings of a previous Enable with another
+   * nrecords are not reused.
+   */
+  static void Enable(size_t nrecords, std::string const& fname = "flight.log");
+
+  //! Stop recording
+  /*!
+   * Threads give their rings back with their next record or when they
+   * exit.
+   */
+  static void Disable();
+
+  static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  //! Copy one record given in pieces into the ring of the calling thread
+  static void Record(struct iovec const* iov, int iovcnt);
+
+  static void Record(char const* data, size_t size) {
+    struct iovec iov = {const_cast<char*>(data), size};
+    Record(&iov, 1);
+  }
+
+  //! Append the rings of all threads to the dump file
+  /*!
+   * @param reason e.g. "SIGSEGV" or "Error"
+   */
+  static void Dump(char const* reason);
+
+ protected:
+  struct Slot {
+    uint64_t time;  //!< steady clock in nanoseconds
+    uint32_t size;
+    char data[kRecordSize];
+  };
+
+  struct Ring {
+    //! Number of the owning thread in the order rings were claimed
+    std::atomic<int> thread;
+
+    size_t nrecords;
+    std::atomic<uint64_t> head;  //!< number of records written so far
+    Slot* slots;
+
+    //! Held by a live thread
+    std::atomic<bool> owned;
+
+    //! Generation in which the ring was last taken, see Dump
+    std::atomic<uint64_t> generation;
+  };
+
+  //! Ring of the calling thread, given back when the thread exits
+  struct Holder {
+    uint64_t generation = 0;
+    Ring* ring = nullptr;
+
+    ~Holder() { release(); }
+
+    void release() {
+      if (ring != nullptr) ring->owned.store(false, std::memory_order_release);
+      ring = nullptr;
+    }
+  };
+
+  static Ring* getRing();
+
+  //! Take an unowned ring of nrecords_ or a new one, with the lock held
+  static Ring* claimRing();
+
+  //! Handler of fatal signals, see Signal::CatchFatalSignals
+  static void onFatalSignal(int s);
+
+  static std::atomic<bool> enabled_;
+
+  //! Incremented by Enable and Disable to invalidate cached rings
+  static std::atomic<uint64_t> generation_;
+
+  static size_t nrecords_;
+
+  static std::atomic<Ring*> rings_[kMaxThreads];
+  static std::atomic<int> nrings_;
+
+  //! Number of rings claimed so far, with the lock held
+  static int nclaimed_;
+
+  //! Dump file name, kept as a C string for the signal handler
+  static char fname_[256];
+};
+
+#endif  // SRC_FLIGHT_RECORDER_HPP_
@@ -0,0 +1,144 @@
+// C/C++
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+// POSIX C extensions
+#include <unistd.h>  // sysconf()
+
+// application
+#include "heartbeat.hpp"
+#include "monitor.hpp"
+
+static std::mutex beat_mutex;
+
+//! Weight of the newest rate sample in the smoothed rate
+static const double kRateWeight = 0.3;
+
+Heartbeat* Heartbeat::GetInstance() {
+  // RAII
+  std::unique_lock<std::mutex> lock(beat_mutex);
+
+  if (Heartbeat::mybeat_ == nullptr) {
+    Heartbeat::mybeat_ = new Heartbeat();
+  }
+
+  return mybeat_;
+}
+
+void Heartbeat::Destroy() {
+  std::unique_lock<std::mutex> lock(beat_mutex);
+
+  if (Heartbeat::mybeat_ != nullptr) {
+    delete Heartbeat::mybeat_;
+    Heartbeat::mybeat_ = nullptr;
+  }
+}
+
+Heartbeat::Heartbeat()
+    : start_(std::chrono::steady_clock::now()), last_time_(start_) {}
+
+void Heartbeat::Start(double interval, Monitor* monitor, int wtlim) {
+  Stop();
+
+  monitor_ = monitor;
+  wtlim_ = wtlim;
+  stop_ = false;
+
+  thread_ = std::thread([this, interval]() {
+    auto period = std::chrono::duration<double>(interval);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!cv_.wait_for(lock, period, [this]() { return stop_; })) {
+      // operators read the heartbeat as it happens
+      monitor_->Log("Heartbeat", GetStatus());
+      monitor_->Flush();
+    }
+  });
+}
+
+void Heartbeat::Stop() {
+  if (!thread_.joinable()) return;
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+
+  thread_.join();
+}
+
+std::string Heartbeat::GetStatus() {
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - start_).count();
+
+  int64_t step = step_.load(std::memory_order_relaxed);
+  int64_t total = total_.load(std::memory_order_relaxed);
+
+  // exponentially smoothed rate over the heartbeats
+  double dt = std::chrono::duration<double>(now - last_time_).count();
+  if (dt > 0. && step >= last_step_) {
+    double rate = (step - last_step_) / dt;
+    rate_ = rate_ < 0. ? rate : kRateWeight * rate + (1. - kRateWeight) * rate_;
+  }
+  last_time_ = now;
+  last_step_ = step;
+
+  char buf[80];
+  std::string str = "step " + std::to_string(step);
+
+  if (total > 0) {
+    snprintf(buf, sizeof(buf), "/%lld (%.1f%%)", static_cast<long long>(total),
+             100. * step / total);
+    str += buf;
+  }
+
+  str += ", elapsed " + FormatDuration(elapsed);
+
+  if (rate_ >= 0.) {
+    snprintf(buf, sizeof(buf), ", %.3g steps/s", rate_);
+    str += buf;
+  }
+
+  if (total > 0 && rate_ > 0. && step <= total) {
+    str += ", ETA " + FormatDuration((total - step) / rate_);
+  }
+
+  double rss = GetRSS() / (1024. * 1024.);
+  if (rss < 1024.) {
+    snprintf(buf, sizeof(buf), ", RSS %.1f MiB", rss);
+  } else {
+    snprintf(buf, sizeof(buf), ", RSS %.2f GiB", rss / 1024.);
+  }
+  str += buf;
+
+  if (wtlim_ > 0) {
+    str += ", wall left " + FormatDuration(std::max(wtlim_ - elapsed, 0.));
+  }
+
+  return str;
+}
+
+size_t Heartbeat::GetRSS() {
+  std::ifstream fin("/proc/self/statm");
+  size_t size, resident;
+  if (fin >> size >> resident) return resident * sysconf(_SC_PAGESIZE);
+  return 0;
+}
+
+std::string Heartbeat::FormatDuration(double seconds) {
+  long s = static_cast<long>(seconds + 0.5);
+
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%02ld:%02ld:%02ld", s / 3600, s / 60 % 60,
+           s % 60);
+  return buf;
+}
+
+std::atomic<int64_t> Heartbeat::step_(0);
+std::atomic<int64_t> Heartbeat::total_(0);
+Heartbeat* Heartbeat::mybeat_ = nullptr;
@@ -0,0 +1,101 @@
+#ifndef SRC_HEARTBEAT_HPP_
+#define SRC_HEARTBEAT_HPP_
+
+// C/C++
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class Monitor;
+
+//! Periodic status line of a long run
+/*!
+ * A background thread writes a line through a monitor every interval
+ * seconds, for example
+ *
+ *   "Heartbeat = step 1200/10000 (12.0%), elapsed 00:12:03,
+ *    13.4 steps/s, ETA 00:10:57, RSS 1.21 GiB, wall left 00:47:57"
+ *
+ * The rate is smoothed over heartbeats. Compute threads only report their
+ * progress with SetProgress(), a single relaxed atomic store; all
+ * formatting and output happens on the heartbeat thread.
+ *
+ * The monitor is flushed after each line. Application::Start starts the
+ * heartbeat on monitor "main" if the command line option -b <seconds> is
+ * given.
+ */
+class Heartbeat {
+ protected:
+  Heartbeat();
+
+ public:
+  static Heartbeat* GetInstance();
+  static void Destroy();
+
+  ~Heartbeat() { Stop(); }
+
+  //! Report the current step
+  static void SetProgress(int64_t step) {
+    step_.store(step, std::memory_order_relaxed);
+  }
+
+  //! Report the total number of steps, 0 if unknown
+  static void SetTotal(int64_t total) {
+    total_.store(total, std::memory_order_relaxed);
+  }
+
+  //! Start writing status lines through monitor every interval seconds
+  /*!
+   * A running heartbeat is stopped first.
+   *
+   * @param wtlim wall time limit in seconds since the start, 0 if none
+   */
+  void Start(double interval, Monitor* monitor, int wtlim = 0);
+
+  //! Stop the heartbeat thread
+  void Stop();
+
+  //! Format the status line as of now
+  /*!
+   * This also updates the smoothed rate, so it is only called by the
+   * heartbeat thread while the heartbeat runs.
+   */
+  std::string GetStatus();
+
+  //! Resident set size of this process in bytes
+  static size_t GetRSS();
+
+  //! Format seconds as hh:mm:ss
+  static std::string FormatDuration(double seconds);
+
+ protected:
+  static std::atomic<int64_t> step_;
+  static std::atomic<int64_t> total_;
+
+  std::chrono::steady_clock::time_point start_;
+  int wtlim_ = 0;
+
+  //! Last sample of the progress, for the rate
+  std::chrono::steady_clock::time_point last_time_;
+  int64_t last_step_ = 0;
+
+  //! Smoothed steps per second, negative until measured
+  double rate_ = -1.;
+
+  Monitor* monitor_ = nullptr;
+
+  std::thread thread_;
+  bool stop_ = false;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+ private:
+  //! Pointer to the single Heartbeat instance
+  static Heartbeat* mybeat_;
+};
+
+#endif  // SRC_HEARTBEAT_HPP_
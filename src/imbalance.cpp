@@ -0,0 +1,200 @@
+// C/C++
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// application
+#include "application.hpp"
+#include "globals.hpp"
+#include "imbalance.hpp"
+
+//! Seconds and calls of one monitor on each rank
+struct Samples {
+  std::vector<double> seconds;
+  uint64_t calls = 0;
+  double mpi = 0.;
+};
+
+//! Profile of app as "name\tcalls\tseconds\tmpi seconds\n" lines
+static std::string packProfile(Application* app) {
+  std::string packed;
+  char buf[64];
+
+  for (auto const& name : app->GetMonitorNames()) {
+    uint64_t calls;
+    double seconds;
+    app->GetMonitor(name)->GetProfile(&calls, &seconds);
+    if (calls == 0) continue;
+
+    uint64_t comm_calls, comm_bytes;
+    double comm_seconds;
+    app->GetMonitor(name)->GetCommunication(&comm_calls, &comm_seconds,
+                                            &comm_bytes);
+
+    snprintf(buf, sizeof(buf), "\t%lu\t%.9g\t%.9g\n",
+             static_cast<unsigned long>(calls), seconds, comm_seconds);
+    packed += name + buf;
+  }
+
+  return packed;
+}
+
+//! Add the packed profile of rank to samples
+static void unpackProfile(std::string const& packed, int rank, int nranks,
+                          std::map<std::string, Samples>* samples) {
+  std::istringstream in(packed);
+  std::string line;
+  while (std::getline(in, line)) {
+    auto tab1 = line.find('\t');
+    auto tab2 = line.find('\t', tab1 + 1);
+    auto tab3 = line.find('\t', tab2 + 1);
+    if (tab1 == std::string::npos || tab2 == std::string::npos ||
+        tab3 == std::string::npos) {
+      continue;
+    }
+
+    auto& sample = (*samples)[line.substr(0, tab1)];
+    if (sample.seconds.empty()) sample.seconds.resize(nranks, 0.);
+    sample.calls += std::stoull(line.substr(tab1 + 1, tab2 - tab1 - 1));
+    sample.seconds[rank] = std::stod(line.substr(tab2 + 1, tab3 - tab2 - 1));
+    sample.mpi += std::stod(line.substr(tab3 + 1));
+  }
+}
+
+std::vector<Imbalance::Row> Imbalance::Reduce(Application* app) {
+  std::string packed = packProfile(app);
+  std::vector<std::string> profiles;
+
+#ifdef MPI_PARALLEL
+  int size = packed.size();
+  std::vector<int> sizes(Globals::member_size);
+  MPI_Gather(&size, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0,
+             Globals::member_comm);
+
+  std::vector<int> displs(Globals::member_size, 0);
+  std::vector<char> all;
+  if (Globals::member_rank == 0) {
+    std::partial_sum(sizes.begin(), sizes.end() - 1, displs.begin() + 1);
+    all.resize(displs.back() + sizes.back());
+  }
+
+  MPI_Gatherv(packed.data(), size, MPI_CHAR, all.data(), sizes.data(),
+              displs.data(), MPI_CHAR, 0, Globals::member_comm);
+
+  if (Globals::member_rank != 0) return {};
+
+  for (int r = 0; r < Globals::member_size; ++r) {
+    profiles.emplace_back(all.data() + displs[r], sizes[r]);
+  }
+#else
+  profiles.push_back(packed);
+#endif
+
+  int nranks = profiles.size();
+  std::map<std::string, Samples> samples;
+  for (int r = 0; r < nranks; ++r) {
+    unpackProfile(profiles[r], r, nranks, &samples);
+  }
+
+  std::vector<Row> rows;
+  for (auto const& it : samples) {
+    auto const& seconds = it.second.seconds;
+
+    Row row;
+    row.section = it.first;
+    row.calls = it.second.calls;
+    row.min = *std::min_element(seconds.begin(), seconds.end());
+    row.max = *std::max_element(seconds.begin(), seconds.end());
+    row.mean = std::accumulate(seconds.begin(), seconds.end(), 0.) / nranks;
+    row.factor = row.mean > 0. ? row.max / row.mean : 1.;
+    row.mpi = it.second.mpi / nranks;
+
+    std::vector<int> ranks(nranks);
+    std::iota(ranks.begin(), ranks.end(), 0);
+    int nslowest = std::min(nranks, kSlowest);
+    std::partial_sort(ranks.begin(), ranks.begin() + nslowest, ranks.end(),
+                      [&seconds](int a, int b) {
+                        return seconds[a] > seconds[b];
+                      });
+    row.slowest.assign(ranks.begin(), ranks.begin() + nslowest);
+
+    rows.push_back(row);
+  }
+
+  std::sort(rows.begin(), rows.end(),
+            [](Row const& a, Row const& b) { return a.max > b.max; });
+
+  return rows;
+}
+
+std::string Imbalance::FormatTable(std::vector<Row> const& rows) {
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-24s %12s %12s %12s %12s %8s %6s  %s\n",
+           "section", "calls", "min s", "mean s", "max s", "max/mean", "mpi %",
+           "slowest ranks");
+  std::string table = buf;
+
+  for (auto const& row : rows) {
+    std::string slowest;
+    for (auto rank : row.slowest) {
+      if (!slowest.empty()) slowest += ",";
+      slowest += std::to_string(rank);
+    }
+
+    double mpi = row.mean > 0. ? 100. * row.mpi / row.mean : 0.;
+    snprintf(buf, sizeof(buf),
+             "%-24s %12lu %12.6f %12.6f %12.6f %8.3f %6.1f  %s\n",
+             row.section.c_str(), static_cast<unsigned long>(row.calls),
+             row.min, row.mean, row.max, row.factor, mpi, slowest.c_str());
+    table += buf;
+  }
+
+  return table;
+}
+
+void Imbalance::WriteCsv(std::vector<Row> const& rows,
+                         std::string const& fname, int report) {
+  bool exists = static_cast<bool>(std::ifstream(fname));
+
+  std::ofstream out(fname, std::ios::app);
+  if (!exists) {
+    out << "report,section,calls,min,mean,max,imbalance,mpi,slowest\n";
+  }
+
+  char buf[160];
+  for (auto const& row : rows) {
+    std::string slowest;
+    for (auto rank : row.slowest) {
+      if (!slowest.empty()) slowest += " ";
+      slowest += std::to_string(rank);
+    }
+
+    snprintf(buf, sizeof(buf), ",%lu,%.9g,%.9g,%.9g,%.6g,%.9g,",
+             static_cast<unsigned long>(row.calls), row.min, row.mean,
+             row.max, row.factor, row.mpi);
+    out << report << "," << row.section << buf << slowest << "\n";
+  }
+}
+
+void Imbalance::Report(Application* app, std::string const& fname) {
+  auto rows = Reduce(app);
+  if (Globals::member_rank != 0) return;
+
+  int report = ++nreports_;
+  WriteCsv(rows, Application::GetMemberFileName(fname), report);
+
+  auto log = app->GetMonitor(APP_MONITOR("main"));
+  log->Log("Load imbalance report " + std::to_string(report) + " over " +
+           std::to_string(Globals::member_size) + " ranks");
+
+  std::istringstream table(FormatTable(rows));
+  std::string line;
+  while (std::getline(table, line)) log->Log(line);
+}
+
+const int Imbalance::kSlowest;
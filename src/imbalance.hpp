@@ -0,0 +1,69 @@
+#ifndef SRC_IMBALANCE_HPP_
+#define SRC_IMBALANCE_HPP_
+
+// C/C++
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Application;
+
+//! Load imbalance of the profiled sections across the ranks of a member
+/*!
+ * Reduces the seconds that each monitor spent in its sections, as
+ * accumulated by the Profiler, over the ranks of the ensemble member. A
+ * monitor that a rank never used counts as zero seconds there. The
+ * imbalance factor is max / mean: 1 is perfectly balanced, and the
+ * run time lost to waiting is about (max - mean) per section. In a build
+ * with PMPI_PROFILING, the mean seconds spent in MPI calls within each
+ * section are reported as well, which separates communication from
+ * computation.
+ *
+ * With -p <checks>, Application::Start enables the profiler and the
+ * default context is reported every <checks> Signal::CheckSignalFlags and
+ * at Application::Destroy.
+ */
+class Imbalance {
+ public:
+  //! Number of slowest ranks listed per section
+  static const int kSlowest = 3;
+
+  struct Row {
+    std::string section;  //!< monitor name
+    uint64_t calls;       //!< sections left, summed over the ranks
+    double min, max, mean;
+    double factor;              //!< max / mean
+    double mpi;                 //!< mean seconds in MPI, see PMPI_OPTION
+    std::vector<int> slowest;   //!< member ranks, slowest first
+  };
+
+  //! Collectively reduce the profile of app over the member ranks
+  /*!
+   * @return rows sorted by max seconds on member rank 0, empty elsewhere
+   */
+  static std::vector<Row> Reduce(Application* app);
+
+  //! Compact table of rows, one line per section
+  static std::string FormatTable(std::vector<Row> const& rows);
+
+  //! Append rows to a CSV file, writing the header to a new file
+  /*!
+   * @param report number of the report, first column of each row
+   */
+  static void WriteCsv(std::vector<Row> const& rows, std::string const& fname,
+                       int report);
+
+  //! Collectively reduce and report the profile of app
+  /*!
+   * Member rank 0 writes the table to monitor "main" of app and appends
+   * the rows to fname, renamed with Application::GetMemberFileName.
+   */
+  static void Report(Application* app,
+                     std::string const& fname = "imbalance.csv");
+
+ protected:
+  //! Number of reports written so far
+  inline static int nreports_ = 0;
+};
+
+#endif  // SRC_IMBALANCE_HPP_
@@ -0,0 +1,105 @@
+// C/C++
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+// application
+#include "json.hpp"
+
+void JsonEncoder::String(std::string_view str) {
+  static const char hex[] = "0123456789abcdef";
+
+  out_->push_back('"');
+
+  // copy runs of characters that need no escaping at once
+  size_t run = 0;
+  for (size_t i = 0; i < str.size(); ++i) {
+    unsigned char c = str[i];
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+    out_->append(str.data() + run, i - run);
+    run = i + 1;
+
+    switch (c) {
+      case '"':
+        out_->append("\\\"", 2);
+        break;
+      case '\\':
+        out_->append("\\\\", 2);
+        break;
+      case '\n':
+        out_->append("\\n", 2);
+        break;
+      case '\r':
+        out_->append("\\r", 2);
+        break;
+      case '\t':
+        out_->append("\\t", 2);
+        break;
+      case '\b':
+        out_->append("\\b", 2);
+        break;
+      case '\f':
+        out_->append("\\f", 2);
+        break;
+      default:
+        char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+        out_->append(esc, 6);
+        break;
+    }
+  }
+  out_->append(str.data() + run, str.size() - run);
+
+  out_->push_back('"');
+}
+
+void JsonEncoder::Int(int64_t value) {
+  char buf[24];
+  auto end = std::to_chars(buf, buf + sizeof(buf), value).ptr;
+  out_->append(buf, end - buf);
+}
+
+void JsonEncoder::UInt(uint64_t value) {
+  char buf[24];
+  auto end = std::to_chars(buf, buf + sizeof(buf), value).ptr;
+  out_->append(buf, end - buf);
+}
+
+void JsonEncoder::Double(double value) {
+  if (!std::isfinite(value)) {
+    Null();
+    return;
+  }
+
+  char buf[32];
+  auto end = std::to_chars(buf, buf + sizeof(buf), value).ptr;
+  out_->append(buf, end - buf);
+}
+
+void JsonEncoder::Write(Field const& field) {
+  if (field.GetType() == Field::kNone) return;
+
+  Key(field.GetKey());
+
+  switch (field.GetType()) {
+    case Field::kBool:
+      Bool(field.GetBool());
+      break;
+    case Field::kInt:
+      Int(field.GetInt());
+      break;
+    case Field::kUInt:
+      UInt(field.GetUInt());
+      break;
+    case Field::kDouble:
+      Double(field.GetDouble());
+      break;
+    case Field::kString:
+      String(field.GetString());
+      break;
+    default:
+      Null();
+      break;
+  }
+}
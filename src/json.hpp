@@ -0,0 +1,151 @@
+#ifndef SRC_JSON_HPP_
+#define SRC_JSON_HPP_
+
+// C/C++
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+//! Typed key/value pair of a structured record
+/*!
+ * A field refers to its key and string value without copying them, so it
+ * must not outlive the call it is passed to:
+ *
+ *   monitor->Log("step done", {"dt", dt}, {"iter", n});
+ */
+class Field {
+ public:
+  enum Type {
+    kNone = 0,
+    kBool = 1,
+    kInt = 2,
+    kUInt = 3,
+    kDouble = 4,
+    kString = 5,
+  };
+
+  //! Empty field, skipped when a record is written
+  Field() : key_(nullptr), type_(kNone) {}
+
+  Field(char const* key, bool value) : key_(key), type_(kBool) {
+    value_.b = value;
+  }
+
+  template <typename T,
+            typename std::enable_if<std::is_integral<T>::value &&
+                                        std::is_signed<T>::value,
+                                    int>::type = 0>
+  Field(char const* key, T value) : key_(key), type_(kInt) {
+    value_.i = value;
+  }
+
+  template <typename T,
+            typename std::enable_if<std::is_integral<T>::value &&
+                                        std::is_unsigned<T>::value &&
+                                        !std::is_same<T, bool>::value,
+                                    int>::type = 0>
+  Field(char const* key, T value) : key_(key), type_(kUInt) {
+    value_.u = value;
+  }
+
+  Field(char const* key, double value) : key_(key), type_(kDouble) {
+    value_.d = value;
+  }
+
+  Field(char const* key, float value)
+      : Field(key, static_cast<double>(value)) {}
+
+  Field(char const* key, std::string_view value) : key_(key), type_(kString) {
+    value_.s.data = value.data();
+    value_.s.size = value.size();
+  }
+
+  Field(char const* key, char const* value)
+      : Field(key, std::string_view(value)) {}
+
+  Field(char const* key, std::string const& value)
+      : Field(key, std::string_view(value)) {}
+
+  char const* GetKey() const { return key_; }
+
+  Type GetType() const { return type_; }
+
+  bool GetBool() const { return value_.b; }
+
+  int64_t GetInt() const { return value_.i; }
+
+  uint64_t GetUInt() const { return value_.u; }
+
+  double GetDouble() const { return value_.d; }
+
+  std::string_view GetString() const { return {value_.s.data, value_.s.size}; }
+
+ protected:
+  char const* key_;
+  Type type_;
+
+  union {
+    bool b;
+    int64_t i;
+    uint64_t u;
+    double d;
+    struct {
+      char const* data;
+      size_t size;
+    } s;
+  } value_;
+};
+
+//! Encoder of one JSON object per line
+/*!
+ * The encoder appends to a caller-owned string. Reusing the same string
+ * for every record, e.g. one per thread, keeps its capacity, so that
+ * encoding does not allocate once the string has grown to the longest
+ * record. Numbers are written with std::to_chars in the shortest form that
+ * reads back exactly; NaN and Inf, which JSON cannot represent, are
+ * written as null.
+ */
+class JsonEncoder {
+ public:
+  explicit JsonEncoder(std::string* out) : out_(out), first_(true) {}
+
+  void BeginObject() {
+    out_->push_back('{');
+    first_ = true;
+  }
+
+  //! Close the object and end the line
+  void EndObject() { out_->append("}\n", 2); }
+
+  void Key(char const* key) {
+    if (!first_) out_->push_back(',');
+    first_ = false;
+    String(key);
+    out_->push_back(':');
+  }
+
+  void String(std::string_view str);
+
+  void Int(int64_t value);
+
+  void UInt(uint64_t value);
+
+  void Double(double value);
+
+  void Bool(bool value) { out_->append(value ? "true" : "false"); }
+
+  void Null() { out_->append("null", 4); }
+
+  //! Append already encoded JSON
+  void Raw(std::string_view json) { out_->append(json.data(), json.size()); }
+
+  void Write(Field const& field);
+
+ protected:
+  std::string* out_;
+  bool first_;
+};
+
+#endif  // SRC_JSON_HPP_
@@ -0,0 +1,139 @@
+// C/C++
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// POSIX C extensions
+#include <fcntl.h>   // open()
+#include <unistd.h>  // pread(), close()
+
+// application
+#include "exceptions.hpp"
+#include "log_index.hpp"
+
+bool IndexQuery::Matches(IndexEntry const& entry) const {
+  if (entry.time < tmin || entry.time > tmax) return false;
+  if (!monitor.empty() && entry.monitor != monitor) return false;
+
+  if (!section.empty()) {
+    // match whole levels only
+    std::string prefix = section;
+    if (prefix.back() != '.') prefix += '.';
+    if (entry.section.compare(0, prefix.size(), prefix) != 0) return false;
+  }
+
+  return true;
+}
+
+LogIndex::LogIndex(std::string const& fname) : fname_(fname) {
+  std::ifstream index(fname + ".idx");
+  if (!index) {
+    throw RuntimeError("LogIndex", "Cannot open file " + fname + ".idx");
+  }
+
+  // offset length seq time monitor section, separated by tabs
+  std::string line;
+  while (std::getline(index, line)) {
+    if (line.empty() || line[0] == '#') continue;
+
+    std::istringstream ss(line);
+    IndexEntry entry;
+    ss >> entry.offset >> entry.length >> entry.seq >> entry.time;
+    ss.ignore(1);
+    std::getline(ss, entry.monitor, '\t');
+    std::getline(ss, entry.section);
+
+    // a line cut short by a crash of the writer
+    if (ss.fail()) continue;
+
+    entries_.push_back(entry);
+  }
+
+  fd_ = open(fname.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    throw RuntimeError("LogIndex", "Cannot open file " + fname);
+  }
+}
+
+LogIndex::~LogIndex() { close(fd_); }
+
+std::vector<IndexEntry> LogIndex::Find(IndexQuery const& query) const {
+  std::vector<IndexEntry> found;
+  for (auto const& entry : entries_) {
+    if (query.Matches(entry)) found.push_back(entry);
+  }
+
+  std::sort(found.begin(), found.end(),
+            [](IndexEntry const& a, IndexEntry const& b) {
+              return a.offset < b.offset;
+            });
+
+  return found;
+}
+
+std::string LogIndex::Read(IndexEntry const& entry) const {
+  std::string record(entry.length, '\0');
+
+  size_t done = 0;
+  while (done < entry.length) {
+    ssize_t n = pread(fd_, &record[done], entry.length - done,
+                      entry.offset + done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;  // the record was never completely written
+    done += n;
+  }
+
+  record.resize(done);
+  return record;
+}
+
+size_t LogIndex::Query(IndexQuery const& query, std::ostream& out) const {
+  auto found = Find(query);
+  for (auto const& entry : found) out << Read(entry);
+  return found.size();
+}
+
+size_t LogIndex::Merge(std::vector<std::string> const& fnames,
+                       IndexQuery const& query, std::ostream& out) {
+  std::vector<std::unique_ptr<LogIndex>> logs;
+  std::vector<std::vector<IndexEntry>> found;
+
+  for (auto const& fname : fnames) {
+    logs.push_back(std::make_unique<LogIndex>(fname));
+    found.push_back(logs.back()->Find(query));
+
+    std::sort(found.back().begin(), found.back().end(),
+              [](IndexEntry const& a, IndexEntry const& b) {
+                return std::tie(a.time, a.seq) < std::tie(b.time, b.seq);
+              });
+  }
+
+  // (time, log, position) of the next record of each log
+  using Cursor = std::tuple<uint64_t, size_t, size_t>;
+  std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heap;
+
+  for (size_t i = 0; i < found.size(); ++i) {
+    if (!found[i].empty()) heap.push({found[i][0].time, i, 0});
+  }
+
+  size_t count = 0;
+  while (!heap.empty()) {
+    auto [time, i, pos] = heap.top();
+    heap.pop();
+
+    out << logs[i]->Read(found[i][pos]);
+    count++;
+
+    if (++pos < found[i].size()) heap.push({found[i][pos].time, i, pos});
+  }
+
+  return count;
+}
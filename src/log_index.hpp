@@ -0,0 +1,90 @@
+#ifndef SRC_LOG_INDEX_HPP_
+#define SRC_LOG_INDEX_HPP_
+
+// C/C++
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+//! One line of the index of a log file, see Device::EnableIndex
+struct IndexEntry {
+  uint64_t offset;  //!< byte offset of the record in the log file
+  uint64_t length;  //!< length of the record in bytes
+  uint64_t seq;     //!< sequence number within the writing process
+  uint64_t time;    //!< nanoseconds since the epoch
+  std::string monitor;
+  std::string section;
+};
+
+//! Selection of indexed records
+struct IndexQuery {
+  //! Monitor name, empty for all monitors
+  std::string monitor;
+
+  //! Section prefix, e.g. "4.2" selects 4.2. and 4.2.1. but not 4.21.
+  std::string section;
+
+  //! Time range [tmin, tmax] in nanoseconds since the epoch
+  uint64_t tmin = 0;
+  uint64_t tmax = std::numeric_limits<uint64_t>::max();
+
+  bool Matches(IndexEntry const& entry) const;
+};
+
+//! Log file together with its index
+/*!
+ * Queries filter the index and seek to the selected records, so only the
+ * selected records are read from the log file:
+ *
+ *   LogIndex log("main.out");
+ *   IndexQuery query;
+ *   query.monitor = "hydro";
+ *   log.Query(query, std::cout);
+ */
+class LogIndex {
+ public:
+  //! Open fname and read its index fname.idx
+  explicit LogIndex(std::string const& fname);
+
+  ~LogIndex();
+
+  LogIndex(LogIndex const&) = delete;
+  LogIndex& operator=(LogIndex const&) = delete;
+
+  std::string const& GetFileName() const { return fname_; }
+
+  //! All entries in the order they were written to the index
+  std::vector<IndexEntry> const& GetEntries() const { return entries_; }
+
+  //! Entries selected by query, ordered by offset
+  std::vector<IndexEntry> Find(IndexQuery const& query) const;
+
+  //! Read the record of an entry
+  std::string Read(IndexEntry const& entry) const;
+
+  //! Write the records selected by query in file order
+  /*!
+   * @return number of records written
+   */
+  size_t Query(IndexQuery const& query, std::ostream& out) const;
+
+  //! Write the records of several logs selected by query in time order
+  /*!
+   * Records of each log are sorted by time and sequence number, then the
+   * logs are merged with a k-way merge. Records with the same time are
+   * written in the order of fnames.
+   *
+   * @return number of records written
+   */
+  static size_t Merge(std::vector<std::string> const& fnames,
+                      IndexQuery const& query, std::ostream& out);
+
+ protected:
+  std::string fname_;
+  int fd_;
+  std::vector<IndexEntry> entries_;
+};
+
+#endif  // SRC_LOG_INDEX_HPP_
@@ -0,0 +1,351 @@
+// C/C++
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// application
+#include "application.hpp"
+#include "exceptions.hpp"
+#include "globals.hpp"
+#include "metrics.hpp"
+
+//! Shard of the next thread recording a metric
+static std::atomic<int> next_shard(0);
+
+int GetMetricShard() {
+  static thread_local int shard = next_shard++ % kMetricShards;
+  return shard;
+}
+
+//! Add to an atomic double; uncontended unless threads share a shard
+static void atomicAdd(std::atomic<double>* value, double delta) {
+  double old = value->load(std::memory_order_relaxed);
+  while (!value->compare_exchange_weak(old, old + delta,
+                                       std::memory_order_relaxed)) {
+  }
+}
+
+//! Format a sample value, "+Inf", "-Inf" or "NaN" if not finite
+/*!
+ * Bucket bounds are formatted with 15 digits, so that 1e-05 does not come
+ * out as 1.0000000000000001e-05.
+ */
+static std::string formatValue(double value, int digits = 17) {
+  if (std::isnan(value)) return "NaN";
+  if (std::isinf(value)) return value > 0 ? "+Inf" : "-Inf";
+
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*g", digits, value);
+  return buf;
+}
+
+//! Format a JSON number, null if not finite
+static std::string formatJSON(double value, int digits = 17) {
+  if (!std::isfinite(value)) return "null";
+  return formatValue(value, digits);
+}
+
+static std::string escapeHelp(std::string const& help) {
+  std::string str;
+  for (auto c : help) {
+    if (c == '\\') {
+      str += "\\\\";
+    } else if (c == '\n') {
+      str += "\\n";
+    } else {
+      str += c;
+    }
+  }
+  return str;
+}
+
+//! Check that name is a valid metric name [a-zA-Z_:][a-zA-Z0-9_:]*
+static void checkName(std::string const& name) {
+  bool valid = !name.empty() && !std::isdigit(name[0]);
+  for (auto c : name) {
+    if (!std::isalnum(c) && c != '_' && c != ':') valid = false;
+  }
+
+  if (!valid) {
+    throw RuntimeError("Metrics", "Invalid metric name '" + name + "'");
+  }
+}
+
+uint64_t Counter::Value() const {
+  uint64_t sum = 0;
+  for (auto const& cell : cells_) {
+    sum += cell.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void Gauge::Add(double delta) { atomicAdd(&value_, delta); }
+
+Histogram::Histogram(std::vector<double> const& bounds) : bounds_(bounds) {
+  if (!std::is_sorted(bounds_.begin(), bounds_.end()) ||
+      std::adjacent_find(bounds_.begin(), bounds_.end()) != bounds_.end()) {
+    throw RuntimeError("Histogram", "Bucket bounds must be increasing");
+  }
+
+  // one count per bucket plus the +Inf bucket, in whole cache lines
+  size_t per_line = 64 / sizeof(std::atomic<uint64_t>);
+  stride_ = (bounds_.size() + per_line) / per_line * per_line;
+
+  counts_.reset(new std::atomic<uint64_t>[stride_ * kMetricShards]);
+  for (size_t i = 0; i < stride_ * kMetricShards; ++i) {
+    counts_[i].store(0, std::memory_order_relaxed);
+  }
+
+  for (auto& sum : sums_) sum.value.store(0., std::memory_order_relaxed);
+}
+
+void Histogram::Observe(double value) {
+  size_t bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) -
+                  bounds_.begin();
+  if (std::isnan(value)) bucket = bounds_.size();
+
+  int shard = GetMetricShard();
+  counts_[shard * stride_ + bucket].fetch_add(1, std::memory_order_relaxed);
+  atomicAdd(&sums_[shard].value, value);
+}
+
+std::vector<uint64_t> Histogram::GetCounts() const {
+  std::vector<uint64_t> counts(bounds_.size() + 1, 0);
+  for (int s = 0; s < kMetricShards; ++s) {
+    for (size_t i = 0; i < counts.size(); ++i) {
+      counts[i] += counts_[s * stride_ + i].load(std::memory_order_relaxed);
+    }
+  }
+  return counts;
+}
+
+double Histogram::GetSum() const {
+  double sum = 0.;
+  for (auto const& s : sums_) sum += s.value.load(std::memory_order_relaxed);
+  return sum;
+}
+
+double Histogram::GetQuantile(double q) const {
+  auto counts = GetCounts();
+
+  uint64_t total = 0;
+  for (auto n : counts) total += n;
+  if (total == 0) return 0.;
+
+  // rank of the observation, counted from 1
+  uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(q * total + 0.5), 1);
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < bounds_.size(); ++i) {
+    seen += counts[i];
+    if (seen >= rank) return bounds_[i];
+  }
+  return std::numeric_limits<double>::infinity();
+}
+
+std::vector<double> Histogram::ExponentialBuckets(double start, double factor,
+                                                  int count) {
+  std::vector<double> bounds;
+  for (int i = 0; i < count; ++i) {
+    bounds.push_back(start);
+    start *= factor;
+  }
+  return bounds;
+}
+
+Counter* Metrics::GetCounter(std::string const& name, std::string const& help) {
+  checkName(name);
+  std::unique_lock<std::mutex> lock(metrics_mutex_);
+
+  auto& entry = counters_[name];
+  if (entry.metric == nullptr) {
+    entry = {help, std::make_unique<Counter>()};
+  }
+
+  return entry.metric.get();
+}
+
+Gauge* Metrics::GetGauge(std::string const& name, std::string const& help) {
+  checkName(name);
+  std::unique_lock<std::mutex> lock(metrics_mutex_);
+
+  auto& entry = gauges_[name];
+  if (entry.metric == nullptr) {
+    entry = {help, std::make_unique<Gauge>()};
+  }
+
+  return entry.metric.get();
+}
+
+Histogram* Metrics::GetHistogram(std::string const& name,
+                                 std::vector<double> const& bounds,
+                                 std::string const& help) {
+  checkName(name);
+  std::unique_lock<std::mutex> lock(metrics_mutex_);
+
+  auto& entry = histograms_[name];
+  if (entry.metric == nullptr) {
+    entry = {help, std::make_unique<Histogram>(bounds)};
+  }
+
+  return entry.metric.get();
+}
+
+std::string Metrics::Snapshot(Format format) const {
+  std::unique_lock<std::mutex> lock(metrics_mutex_);
+
+  char labels[64];
+  snprintf(labels, sizeof(labels), "rank=\"%d\",member=\"%d\"",
+           Globals::my_rank, Globals::member_id);
+
+  std::string str;
+
+  if (format == kPrometheus) {
+    auto header = [&](std::string const& name, std::string const& help,
+                      char const* type) {
+      if (!help.empty()) {
+        str += "# HELP " + name + " " + escapeHelp(help) + "\n";
+      }
+      str += "# TYPE " + name + " " + type + "\n";
+    };
+
+    for (auto const& it : counters_) {
+      header(it.first, it.second.help, "counter");
+      str += it.first + "{" + labels + "} " +
+             std::to_string(it.second.metric->Value()) + "\n";
+    }
+
+    for (auto const& it : gauges_) {
+      header(it.first, it.second.help, "gauge");
+      str += it.first + "{" + labels + "} " +
+             formatValue(it.second.metric->Value()) + "\n";
+    }
+
+    for (auto const& it : histograms_) {
+      header(it.first, it.second.help, "histogram");
+
+      auto const& bounds = it.second.metric->GetBounds();
+      auto counts = it.second.metric->GetCounts();
+
+      // buckets are cumulative in the exposition format
+      uint64_t total = 0;
+      for (size_t i = 0; i < counts.size(); ++i) {
+        total += counts[i];
+        std::string le = i < bounds.size() ? formatValue(bounds[i], 15)
+                                           : std::string("+Inf");
+        str += it.first + "_bucket{" + labels + ",le=\"" + le + "\"} " +
+               std::to_string(total) + "\n";
+      }
+
+      str += it.first + "_sum{" + labels + "} " +
+             formatValue(it.second.metric->GetSum()) + "\n";
+      str += it.first + "_count{" + labels + "} " + std::to_string(total) +
+             "\n";
+    }
+  } else {
+    str += "{\"rank\": " + std::to_string(Globals::my_rank) +
+           ", \"member\": " + std::to_string(Globals::member_id) +
+           ", \"time\": " + std::to_string(std::time(nullptr));
+
+    str += ", \"counters\": {";
+    for (auto it = counters_.begin(); it != counters_.end(); ++it) {
+      if (it != counters_.begin()) str += ", ";
+      str += "\"" + it->first +
+             "\": " + std::to_string(it->second.metric->Value());
+    }
+
+    str += "}, \"gauges\": {";
+    for (auto it = gauges_.begin(); it != gauges_.end(); ++it) {
+      if (it != gauges_.begin()) str += ", ";
+      str += "\"" + it->first + "\": " + formatJSON(it->second.metric->Value());
+    }
+
+    str += "}, \"histograms\": {";
+    for (auto it = histograms_.begin(); it != histograms_.end(); ++it) {
+      if (it != histograms_.begin()) str += ", ";
+
+      auto const& bounds = it->second.metric->GetBounds();
+      auto counts = it->second.metric->GetCounts();
+
+      uint64_t total = 0;
+      std::string sbounds, scounts;
+      for (size_t i = 0; i < counts.size(); ++i) {
+        total += counts[i];
+        if (i > 0) scounts += ", ";
+        scounts += std::to_string(counts[i]);
+        if (i < bounds.size()) {
+          if (i > 0) sbounds += ", ";
+          sbounds += formatJSON(bounds[i], 15);
+        }
+      }
+
+      str += "\"" + it->first + "\": {\"bounds\": [" + sbounds +
+             "], \"counts\": [" + scounts +
+             "], \"sum\": " + formatJSON(it->second.metric->GetSum()) +
+             ", \"count\": " + std::to_string(total) + "}";
+    }
+    str += "}}\n";
+  }
+
+  return str;
+}
+
+void Metrics::Export(std::string const& fname, Format format) const {
+  std::string tmp = fname + ".tmp";
+
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    if (!out) {
+      throw RuntimeError("Metrics::Export", "Cannot open file " + tmp);
+    }
+    out << Snapshot(format);
+  }
+
+  if (std::rename(tmp.c_str(), fname.c_str()) != 0) {
+    throw RuntimeError("Metrics::Export", "Cannot rename " + tmp);
+  }
+}
+
+void Metrics::StartExporter(std::string const& fname, double interval,
+                            Format format) {
+  StopExporter();
+
+  std::string rank_fname = Application::GetRankFileName(fname);
+  stop_exporter_ = false;
+
+  exporter_ = std::thread([this, rank_fname, interval, format]() {
+    auto period = std::chrono::duration<double>(interval);
+
+    std::unique_lock<std::mutex> lock(exporter_mutex_);
+    while (!stop_exporter_) {
+      exporter_cv_.wait_for(lock, period);
+
+      // an exporter must not bring the simulation down
+      try {
+        Export(rank_fname, format);
+      } catch (RuntimeError const&) {
+      }
+    }
+  });
+}
+
+void Metrics::StopExporter() {
+  if (!exporter_.joinable()) return;
+
+  {
+    std::unique_lock<std::mutex> lock(exporter_mutex_);
+    stop_exporter_ = true;
+  }
+  exporter_cv_.notify_all();
+
+  exporter_.join();
+}
@@ -0,0 +1,208 @@
+#ifndef SRC_METRICS_HPP_
+#define SRC_METRICS_HPP_
+
+// C/C++
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! Number of shards of a metric; threads are spread over the shards
+constexpr int kMetricShards = 16;
+
+//! Shard of the calling thread
+/*!
+ * Threads are assigned shards round robin when they first record a
+ * metric, so up to kMetricShards threads never touch the same cache line.
+ */
+int GetMetricShard();
+
+//! Monotonically increasing count, e.g. cells updated or bytes written
+class Counter {
+ public:
+  Counter() {
+    for (auto& cell : cells_) cell.value.store(0, std::memory_order_relaxed);
+  }
+
+  void Add(uint64_t n = 1) {
+    cells_[GetMetricShard()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint64_t Value() const;
+
+ protected:
+  struct alignas(64) Cell {
+    std::atomic<uint64_t> value;
+  };
+
+  std::array<Cell, kMetricShards> cells_;
+};
+
+//! Value that goes up and down, e.g. time step or memory in use
+class Gauge {
+ public:
+  void Set(double value) { value_.store(value, std::memory_order_relaxed); }
+
+  void Add(double delta);
+
+  double Value() const { return value_.load(std::memory_order_relaxed); }
+
+ protected:
+  std::atomic<double> value_{0.};
+};
+
+//! Distribution of observations over fixed buckets
+/*!
+ * Bucket i counts observations v with bounds[i-1] < v <= bounds[i]; a last
+ * bucket counts observations above all bounds, NaN included.
+ */
+class Histogram {
+ public:
+  //! Construct with increasing upper bounds of the buckets
+  explicit Histogram(std::vector<double> const& bounds);
+
+  void Observe(double value);
+
+  //! Upper bounds of the buckets, without the last (+Inf) bucket
+  std::vector<double> const& GetBounds() const { return bounds_; }
+
+  //! Number of observations in each bucket, the +Inf bucket last
+  std::vector<uint64_t> GetCounts() const;
+
+  //! Sum of all observations
+  double GetSum() const;
+
+  //! Upper bound of the bucket holding the q-quantile, 0 <= q <= 1
+  /*!
+   * Returns +Inf if the quantile lies above all bounds and 0 if there are
+   * no observations.
+   */
+  double GetQuantile(double q) const;
+
+  //! Bounds start, start*factor, ..., count of them
+  static std::vector<double> ExponentialBuckets(double start, double factor,
+                                                int count);
+
+  //! Default latency buckets from 1 microsecond to 10 seconds
+  static std::vector<double> LatencyBuckets() {
+    return ExponentialBuckets(1.e-6, 10., 8);
+  }
+
+  //! Observe the seconds spent in a scope
+  class Timer {
+   public:
+    explicit Timer(Histogram* hist)
+        : hist_(hist), start_(std::chrono::steady_clock::now()) {}
+
+    ~Timer() {
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start_;
+      hist_->Observe(elapsed.count());
+    }
+
+   protected:
+    Histogram* hist_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+ protected:
+  std::vector<double> bounds_;
+
+  //! Counts of one shard are padded to whole cache lines
+  size_t stride_;
+
+  std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+
+  struct alignas(64) Sum {
+    std::atomic<double> value;
+  };
+
+  std::array<Sum, kMetricShards> sums_;
+};
+
+//! Registry of the metrics of an application context
+/*!
+ * Metrics are registered by name once and recorded through the returned
+ * pointer, which stays valid for the lifetime of the registry:
+ *
+ *   static auto cells = app->GetMetrics()->GetCounter("cells_updated");
+ *   cells->Add(ncells);
+ *
+ * Recording is a relaxed atomic add on the calling thread's shard. Shards
+ * are summed only when a snapshot is taken. A background exporter
+ * periodically writes snapshots to a file per rank, replacing the file
+ * atomically so that a scraper never reads a partial snapshot.
+ */
+class Metrics {
+ public:
+  enum Format {
+    kPrometheus = 0,  //!< Prometheus text exposition format
+    kJSON = 1,        //!< one JSON object
+  };
+
+  Metrics() {}
+
+  ~Metrics() { StopExporter(); }
+
+  //! Get the counter name, registering it if needed
+  Counter* GetCounter(std::string const& name, std::string const& help = "");
+
+  //! Get the gauge name, registering it if needed
+  Gauge* GetGauge(std::string const& name, std::string const& help = "");
+
+  //! Get the histogram name, registering it with bounds if needed
+  Histogram* GetHistogram(
+      std::string const& name,
+      std::vector<double> const& bounds = Histogram::LatencyBuckets(),
+      std::string const& help = "");
+
+  //! Snapshot of all metrics
+  /*!
+   * Samples are labelled with the rank and ensemble member.
+   */
+  std::string Snapshot(Format format = kPrometheus) const;
+
+  //! Write a snapshot to fname, replacing the file atomically
+  void Export(std::string const& fname, Format format = kPrometheus) const;
+
+  //! Export snapshots every interval seconds from a background thread
+  /*!
+   * The file name of rank r gets the suffix ".r<r>" before its extension
+   * if there is more than one rank, see Application::GetRankFileName.
+   * A running exporter is stopped first.
+   */
+  void StartExporter(std::string const& fname, double interval,
+                     Format format = kPrometheus);
+
+  //! Stop the exporter after writing a final snapshot
+  void StopExporter();
+
+ protected:
+  template <typename T>
+  struct Entry {
+    std::string help;
+    std::unique_ptr<T> metric;
+  };
+
+  std::map<std::string, Entry<Counter>> counters_;
+  std::map<std::string, Entry<Gauge>> gauges_;
+  std::map<std::string, Entry<Histogram>> histograms_;
+
+  //! Mutex protecting registration and snapshots
+  mutable std::mutex metrics_mutex_;
+
+  std::thread exporter_;
+  bool stop_exporter_ = false;
+  std::mutex exporter_mutex_;
+  std::condition_variable exporter_cv_;
+};
+
+#endif  // SRC_METRICS_HPP_
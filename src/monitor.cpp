@@ -1,129 +1,575 @@
 // C/C++
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
 #include <ctime>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <mutex>
 
+// POSIX C extensions
+#include <time.h>  // clock_gettime()
+
 // application
 #include "application.hpp"
+#include "async_device.hpp"
 #include "monitor.hpp"
+#include "probes.hpp"
+#include "shm_ring.hpp"
+
+APP_PROBE_SEMAPHORE(monitor__enter);
+APP_PROBE_SEMAPHORE(monitor__leave);
+APP_PROBE_SEMAPHORE(monitor__log);
+APP_PROBE_SEMAPHORE(monitor__warn);
+APP_PROBE_SEMAPHORE(monitor__error);
+
+//! Buffer size of file devices before a thread commits its records
+static const size_t kFileBufferSize = 64 * 1024;
+
+static DevicePtr openDevice(std::string const& fname) {
+  if (fname == "stdout") {
+    return std::make_shared<StreamDevice>(&std::cout);
+  } else if (fname == "stderr") {
+    return std::make_shared<StreamDevice>(&std::cerr);
+  } else if (fname.compare(0, 4, "shm:") == 0) {
+    // records go to the ring one by one, there is no I/O to save
+    return std::make_shared<ShmDevice>(
+        Application::GetRankFileName(fname.substr(4)));
+  }
+
+  DevicePtr device;
+  if (fname.compare(0, 6, "async:") == 0) {
+    device = std::make_shared<AsyncFileDevice>(
+        Application::GetMemberFileName(fname.substr(6)));
+  } else {
+    device =
+        std::make_shared<FileDevice>(Application::GetMemberFileName(fname));
+  }
+  device->SetFlushPolicy(FlushPolicy::PerBytes(kFileBufferSize));
+  return device;
+}
+
+static std::mutex key_mutex;
+
+//! Sequence number of the next indexed record of this process
+static std::atomic<uint64_t> next_seq(0);
+
+//! Time of the last indexed record of this process in nanoseconds
+static std::atomic<uint64_t> last_time(0);
+
+//! Wall clock in nanoseconds since the epoch, strictly increasing
+static uint64_t monotonicTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  uint64_t now = static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+
+  // never step back if the wall clock is adjusted, nor repeat a time
+  uint64_t last = last_time.load(std::memory_order_relaxed);
+  uint64_t time;
+  do {
+    time = std::max(now, last + 1);
+  } while (!last_time.compare_exchange_weak(last, time,
+                                            std::memory_order_relaxed));
+
+  return time;
+}
+
+//! Format a time in nanoseconds as local time with nine decimals
+/*!
+ * @param sep separator of date and time, ' ' or 'T'
+ */
+static size_t formatTime(char* buf, size_t size, uint64_t time, char sep) {
+  std::time_t seconds = time / 1000000000;
+  struct tm local_time;
+  localtime_r(&seconds, &local_time);
+
+  char format[] = "%Y-%m-%d %H:%M:%S";
+  format[8] = sep;
+  size_t len = std::strftime(buf, size, format, &local_time);
+
+  int n = snprintf(buf + len, size - len, ".%09lu",
+                   static_cast<unsigned long>(time % 1000000000));
+  return std::min(len + n, size - 1);
+}
+
+std::string SectionCounter::GetID() const {
+  if (sections_.size() == 0) {
+    return "0.";
+  } else {
+    std::string str;
+    for (auto i : sections_) {
+      str += std::to_string(i) + '.';
+    }
+    return str;
+  }
+}
+
+std::string SectionCounter::GetStack() const {
+  int depth = depth_.load(std::memory_order_acquire);
+
+  std::string stack;
+  for (int i = 0; i < depth; ++i) {
+    if (i > 0) stack += " > ";
+    if (i == kMaxNames) {
+      stack += "...";
+      break;
+    }
+
+    Monitor* monitor = monitors_[i].load(std::memory_order_relaxed);
+    stack += monitor != nullptr ? monitor->GetName() : "?";
+  }
+
+  return stack;
+}
+
+size_t SectionCounter::FormatID(char* buf, size_t size) const {
+  char* pos = buf;
+  char* end = buf + size - 1;
+
+  if (sections_.size() == 0) {
+    if (end - pos >= 2) {
+      *pos++ = '0';
+      *pos++ = '.';
+    }
+  }
+
+  for (auto i : sections_) {
+    char* next = std::to_chars(pos, end, i).ptr;
+    if (next == end || next == pos) break;  // does not fit
+    pos = next;
+    *pos++ = '.';
+  }
+
+  *pos = '\0';
+  return pos - buf;
+}
 
-struct NullDeleter {
-  void operator()(void const*) const {}
-};
+MonitorKey::MonitorKey(std::string const& name) : name_(name) {
+  static std::map<std::string, int> keys;
 
-static std::mutex section_mutex;
+  std::unique_lock<std::mutex> lock(key_mutex);
+
+  auto it = keys.find(name);
+  if (it == keys.end()) {
+    it = keys.insert({name, static_cast<int>(keys.size())}).first;
+  }
+
+  id_ = it->second;
+}
+
+Monitor::Monitor(std::string name, Application* app)
+    : name_(name), app_(app) {
+  if (app_ == nullptr) app_ = Application::GetInstance();
+
+  dedup_seed_ = DedupSet::Hash(
+      name_, DedupSet::Hash(std::to_string(app_->GetSerial()) + ":"));
+}
 
 void Monitor::Log(std::string const& msg) {
+  if (APP_PROBE_ENABLED(monitor__log)) {
+    APP_PROBE3(monitor__log, name_.c_str(), app_->GetSections()->GetDepth(),
+               msg.c_str());
+  }
+
+  if (!isRecorded(kLog)) return;
   advance();
-  char buf[880];
-  snprintf(buf, sizeof(buf), "Log, %s, %12s, %s, \"%s\"\n",
-           getTimeStamp().c_str(), name_.c_str(), getSectionID().c_str(),
-           msg.c_str());
-  (*log_device_) << buf;
+
+  if (format_ == kJSON) {
+    writeJSON(log_device_.load(), kLog, "Log", msg, nullptr, 0);
+  } else {
+    write(log_device_.load(), kLog, "Log", "\"" + msg + "\"\n");
+  }
 }
 
-void Monitor::Error(std::string const& msg, int code) {
+void Monitor::Debug(std::string const& msg) {
+  if (!isRecorded(kDebug)) return;
   advance();
-  char buf[880];
-  snprintf(buf, sizeof(buf), "Error, %s, %12s, %s, \"%s\", %d\n",
-           getTimeStamp().c_str(), name_.c_str(), getSectionID().c_str(),
-           msg.c_str(), code);
-  (*err_device_) << buf;
+
+  if (format_ == kJSON) {
+    writeJSON(log_device_.load(), kDebug, "Debug", msg, nullptr, 0);
+  } else {
+    write(log_device_.load(), kDebug, "Debug", "\"" + msg + "\"\n");
+  }
+}
+
+void Monitor::Log(std::string const& msg, Field const& f0, Field const& f1,
+                  Field const& f2, Field const& f3, Field const& f4,
+                  Field const& f5, Field const& f6, Field const& f7) {
+  if (APP_PROBE_ENABLED(monitor__log)) {
+    APP_PROBE3(monitor__log, name_.c_str(), app_->GetSections()->GetDepth(),
+               msg.c_str());
+  }
+
+  if (!isRecorded(kLog)) return;
+  advance();
+
+  Field const fields[] = {f0, f1, f2, f3, f4, f5, f6, f7};
+
+  if (format_ == kJSON) {
+    writeJSON(log_device_.load(), kLog, "Log", msg, fields, 8);
+    return;
+  }
+
+  std::string body = "\"" + msg;
+  char sep = ':';
+  for (auto const& field : fields) {
+    if (field.GetType() == Field::kNone) continue;
+
+    body += sep;
+    body += std::string(" ") + field.GetKey() + " = ";
+    sep = ',';
+
+    char buf[32];
+    switch (field.GetType()) {
+      case Field::kBool:
+        body += field.GetBool() ? "true" : "false";
+        break;
+      case Field::kInt:
+        body += std::to_string(field.GetInt());
+        break;
+      case Field::kUInt:
+        body += std::to_string(field.GetUInt());
+        break;
+      case Field::kDouble:
+        // like operator<<
+        snprintf(buf, sizeof(buf), "%g", field.GetDouble());
+        body += buf;
+        break;
+      default:
+        body += field.GetString();
+        break;
+    }
+  }
+  body += "\"\n";
+
+  write(log_device_.load(), kLog, "Log", body);
+}
+
+void Monitor::Error(std::string const& msg, int code) {
+  if (APP_PROBE_ENABLED(monitor__error)) {
+    APP_PROBE3(monitor__error, name_.c_str(), app_->GetSections()->GetDepth(),
+               msg.c_str());
+  }
+
+  if (isRecorded(kError)) {
+    advance();
+
+    Device* device = err_device_.load();
+    if (format_ == kJSON) {
+      Field field("code", code);
+      writeJSON(device, kError, "Error", msg, &field, 1);
+    } else {
+      write(device, kError, "Error",
+            "\"" + msg + "\", " + std::to_string(code) + "\n");
+    }
+    device->Flush();
+  }
+
+  if (FlightRecorder::IsEnabled()) FlightRecorder::Dump("Error");
 }
 
 void Monitor::Warn(std::string const& msg, int code) {
+  if (APP_PROBE_ENABLED(monitor__warn)) {
+    APP_PROBE3(monitor__warn, name_.c_str(), app_->GetSections()->GetDepth(),
+               msg.c_str());
+  }
+
+  if (!isRecorded(kWarn)) return;
+  if (dedup_ && !DedupSet::Global().Insert(GetDedupHash(msg), msg)) {
+    suppressed_.Add();
+    return;
+  }
   advance();
-  char buf[880];
-  snprintf(buf, sizeof(buf), "Warn, %s, %12s, %s, \"%s\", %d\n",
-           getTimeStamp().c_str(), name_.c_str(), getSectionID().c_str(),
-           msg.c_str(), code);
-  (*log_device_) << buf;
+
+  if (format_ == kJSON) {
+    Field field("code", code);
+    writeJSON(log_device_.load(), kWarn, "Warn", msg, &field, 1);
+  } else {
+    write(log_device_.load(), kWarn, "Warn",
+          "\"" + msg + "\", " + std::to_string(code) + "\n");
+  }
 }
 
-void Monitor::Enter() {
-  std::unique_lock<std::mutex> lock(section_mutex);
+void Monitor::Flush() {
+  Device* log = log_device_.load();
+  Device* err = err_device_.load();
 
-  sections_.push_back(0);
+  if (log != nullptr) log->Flush();
+  if (err != nullptr) err->Flush();
+
+  if (log != nullptr && log->HasErrors()) reportErrors(log);
+  if (err != nullptr && err->HasErrors()) reportErrors(err);
 }
 
-void Monitor::Leave() {
-  std::unique_lock<std::mutex> lock(section_mutex);
+void Monitor::reportErrors(Device* device) {
+  // the reports are written to devices that may fail again
+  static thread_local bool reporting = false;
+  if (reporting) return;
 
-  sections_.pop_back();
-  if (sections_.size() > 0) sections_.back() += 1;
+  reporting = true;
+  for (auto const& msg : device->TakeErrors()) Error(msg);
+  reporting = false;
 }
 
-bool Monitor::SetLogOutput(std::string const& fname) {
-  auto app = Application::GetInstance();
+void Monitor::write(Device* device, Level level, char const* kind,
+                    std::string const& body) {
+  char buf[880];
+  int len;
+
+  RecordInfo info;
+  char section[128];
+  if (indexed_) {
+    info = stampRecord(section, sizeof(section));
 
-  if (app->HasDevice(fname)) {
-    log_device_ = app->GetDevice(fname);
+    char stamp[64];
+    formatTime(stamp, sizeof(stamp), info.time, ' ');
+    len = snprintf(buf, sizeof(buf), "%s, \"%s\", %12s, %s, %lu, ", kind,
+                   stamp, name_.c_str(), section,
+                   static_cast<unsigned long>(info.seq));
   } else {
-    if (fname == "stdout") {
-      log_device_ = std::shared_ptr<std::ostream>(&std::cout, NullDeleter());
-    } else {
-      log_device_ = std::make_shared<std::ofstream>(fname, std::ios::out);
-    }
-    app->InstallDevice(fname, log_device_);
+    len = snprintf(buf, sizeof(buf), "%s, %s, %12s, %s, ", kind,
+                   getTimeStamp().c_str(), name_.c_str(),
+                   getSectionID().c_str());
   }
+  len = std::min(len, static_cast<int>(sizeof(buf)) - 1);
 
-  return true;
+  struct iovec iov[2] = {{buf, static_cast<size_t>(len)},
+                         {const_cast<char*>(body.data()), body.size()}};
+
+  if (FlightRecorder::IsEnabled()) FlightRecorder::Record(iov, 2);
+  if (level >= GetLevel()) {
+    writeDevice(device, iov, 2, indexed_ ? &info : nullptr);
+  }
 }
 
-bool Monitor::SetErrOutput(std::string const& fname) {
-  auto app = Application::GetInstance();
+void Monitor::writeDevice(Device* device, struct iovec const* iov, int iovcnt,
+                          RecordInfo const* info) {
+  if (IsTimingWrites()) {
+    auto start = std::chrono::steady_clock::now();
+    device->Write(iov, iovcnt, info);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    write_latency_.Observe(elapsed.count());
+  } else {
+    device->Write(iov, iovcnt, info);
+  }
+
+  size_t size = 0;
+  for (int i = 0; i < iovcnt; ++i) size += iov[i].iov_len;
+
+  records_.Add();
+  bytes_.Add(size);
 
-  if (app->HasDevice(fname)) {
-    err_device_ = app->GetDevice(fname);
+  if (device->HasErrors()) reportErrors(device);
+}
+
+void Monitor::writeJSON(Device* device, Level level, char const* kind,
+                        std::string const& msg, Field const* fields,
+                        int nfields, std::string_view value) {
+  // reused by every record of this thread, so it rarely allocates
+  static thread_local std::string line;
+  line.clear();
+
+  JsonEncoder json(&line);
+  json.BeginObject();
+
+  char buf[128];
+  size_t len;
+
+  RecordInfo info;
+  char section[128];
+  if (indexed_) {
+    info = stampRecord(section, sizeof(section));
+    len = formatTime(buf, sizeof(buf), info.time, 'T');
   } else {
-    if (fname == "stderr") {
-      err_device_ = std::shared_ptr<std::ostream>(&std::cerr, NullDeleter());
-    } else {
-      err_device_ = std::make_shared<std::ofstream>(fname, std::ios::out);
+    std::time_t current_time = std::time(nullptr);
+    struct tm local_time;
+    localtime_r(&current_time, &local_time);
+    len = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &local_time);
+  }
+  json.Key("time");
+  json.String({buf, len});
+
+  if (indexed_) {
+    json.Key("seq");
+    json.UInt(info.seq);
+  }
+
+  json.Key("kind");
+  json.String(kind);
+
+  json.Key("monitor");
+  json.String(name_);
+
+  len = app_->GetSections()->FormatID(buf, sizeof(buf));
+  json.Key("section");
+  json.String({buf, len});
+
+  json.Key("msg");
+  json.String(msg);
+
+  for (int i = 0; i < nfields; ++i) json.Write(fields[i]);
+
+  if (!value.empty()) {
+    json.Key("value");
+    json.Raw(value);
+  }
+
+  json.EndObject();
+
+  if (FlightRecorder::IsEnabled()) {
+    FlightRecorder::Record(line.data(), line.size());
+  }
+  if (level >= GetLevel()) {
+    struct iovec iov = {&line[0], line.size()};
+    writeDevice(device, &iov, 1, indexed_ ? &info : nullptr);
+  }
+}
+
+ArrayStats Monitor::Check(std::string const& msg, float const* a, size_t n,
+                          double vmin, double vmax) {
+  auto stats = CheckArray(a, n, vmin, vmax);
+  if (!stats.IsValid()) reportCheck(msg, stats, vmin, vmax);
+  return stats;
+}
+
+ArrayStats Monitor::Check(std::string const& msg, double const* a, size_t n,
+                          double vmin, double vmax) {
+  auto stats = CheckArray(a, n, vmin, vmax);
+  if (!stats.IsValid()) reportCheck(msg, stats, vmin, vmax);
+  return stats;
+}
+
+void Monitor::reportCheck(std::string const& msg, ArrayStats const& stats,
+                          double vmin, double vmax) {
+  char buf[160];
+  snprintf(buf, sizeof(buf), ": %lu NaN, %lu Inf, %lu outside [%g, %g] of %lu",
+           stats.nnan, stats.ninf, stats.nout, vmin, vmax, stats.count);
+
+  std::string str = msg + buf + ", first at";
+  for (int i = 0; i < stats.nfirst; ++i) {
+    str += " " + std::to_string(stats.first[i]);
+  }
+
+  if (stats.nnan > 0 || stats.ninf > 0) {
+    Error(str);
+  } else {
+    Warn(str);
+  }
+}
+
+void Monitor::Enter() {
+  auto sections = app_->GetSections();
+  sections->Enter(this);
+  if (APP_PROBE_ENABLED(monitor__enter)) {
+    APP_PROBE2(monitor__enter, name_.c_str(), sections->GetDepth());
+  }
+  if (Profiler::IsEnabled()) sections->SetEnterTime(Profiler::Now());
+  if (Watchdog::IsRunning()) Watchdog::Tick();
+  if (FlightRecorder::IsEnabled()) recordTransition("Enter");
+}
+
+void Monitor::Leave() {
+  if (FlightRecorder::IsEnabled()) recordTransition("Leave");
+
+  auto sections = app_->GetSections();
+  if (Profiler::IsEnabled()) {
+    // skip sections entered before profiling was last enabled
+    uint64_t enter = sections->GetEnterTime();
+    if (enter != 0 && enter >= Profiler::GetStartTime()) {
+      profile_calls_.Add();
+      profile_ns_.Add(Profiler::Now() - enter);
     }
-    app->InstallDevice(fname, err_device_);
   }
+  if (APP_PROBE_ENABLED(monitor__leave)) {
+    APP_PROBE2(monitor__leave, name_.c_str(), sections->GetDepth());
+  }
+  sections->Leave();
+  if (Watchdog::IsRunning()) Watchdog::Tick();
+}
 
+void Monitor::recordTransition(char const* kind) {
+  char buf[FlightRecorder::kRecordSize];
+  int len = snprintf(buf, sizeof(buf), "%s, %12s, %s\n", kind, name_.c_str(),
+                     getSectionID().c_str());
+  FlightRecorder::Record(buf, std::min(len, static_cast<int>(sizeof(buf)) - 1));
+}
+
+bool Monitor::SetLogOutput(std::string const& fname) {
+  log_device_.store(findDevice(fname).get());
   return true;
 }
 
-std::string Monitor::getTimeStamp() const {
-  std::time_t current_time = std::time(nullptr);
-  char time_stamp[880];
-  std::strftime(time_stamp, sizeof(time_stamp), "\"%Y-%m-%d %H:%M:%S\"",
-                std::localtime(&current_time));
-  return time_stamp;
+bool Monitor::SetErrOutput(std::string const& fname) {
+  err_device_.store(findDevice(fname).get());
+  return true;
 }
 
-std::string Monitor::getSectionID() const {
-  if (sections_.size() == 0) {
-    return "0.";
+DevicePtr Monitor::findDevice(std::string const& fname) {
+  DevicePtr device;
+  if (app_->HasDevice(fname)) {
+    device = app_->GetDevice(fname);
   } else {
-    std::string str;
-    for (auto i : sections_) {
-      str += std::to_string(i) + '.';
-    }
-    return str;
+    device = openDevice(fname);
+    app_->InstallDevice(fname, device);
   }
+
+  // indexed before other threads write to it
+  if (indexed_) device->EnableIndex();
+
+  return device;
 }
 
-void Monitor::Start() {
-  std::unique_lock<std::mutex> lock(section_mutex);
+void Monitor::SetIndexed(bool indexed) {
+  indexed_ = indexed;
+  if (!indexed_) return;
 
-  sections_.clear();
-  sections_.push_back(1);
+  Device* log = log_device_.load();
+  Device* err = err_device_.load();
+  if (log != nullptr) log->EnableIndex();
+  if (err != nullptr) err->EnableIndex();
 }
 
-void Monitor::advance() {
-  std::unique_lock<std::mutex> lock(section_mutex);
+RecordInfo Monitor::stampRecord(char* section, size_t size) const {
+  app_->GetSections()->FormatID(section, size);
+
+  RecordInfo info;
+  info.seq = next_seq.fetch_add(1, std::memory_order_relaxed);
+  info.time = monotonicTime();
+  info.monitor = name_.c_str();
+  info.section = section;
+  return info;
+}
 
-  if (sections_.size() != 0) {
-    sections_.back() += 1;
+void Monitor::SetSidecar(std::string const& fname, size_t min_size) {
+  if (fname.empty()) {
+    sidecar_ = nullptr;
   } else {
-    sections_.push_back(1);
+    sidecar_ = app_->GetSidecar(fname);
   }
+
+  sidecar_min_size_ = min_size;
 }
 
-std::vector<uint32_t> Monitor::sections_ = {};
+std::string Monitor::getTimeStamp() const {
+  std::time_t current_time = std::time(nullptr);
+  struct tm local_time;
+  localtime_r(&current_time, &local_time);
+  char time_stamp[880];
+  std::strftime(time_stamp, sizeof(time_stamp), "\"%Y-%m-%d %H:%M:%S\"",
+                &local_time);
+  return time_stamp;
+}
+
+std::string Monitor::getSectionID() const {
+  return app_->GetSections()->GetID();
+}
+
+bool Monitor::HasProbes() { return APP_PROBES_COMPILED; }
+
+void Monitor::Start() { Application::GetInstance()->GetSections()->Start(); }
+
+void Monitor::advance() { app_->GetSections()->Advance(); }
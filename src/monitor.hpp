@@ -2,20 +2,225 @@
 #define SRC_MONITOR_HPP_
 
 // C/C++
+#include <atomic>
+#include <charconv>
+#include <cmath>
 #include <cstring>
 #include <iostream>
 #include <fstream>
 #include <map>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
-class Monitor {
+// application
+#include "check.hpp"
+#include "device.hpp"
+#include "flight_recorder.hpp"
+#include "json.hpp"
+#include "metrics.hpp"
+#include "profiler.hpp"
+#include "rate_limit.hpp"
+#include "watchdog.hpp"
+
+class Application;
+class Monitor;
+
+//! Numeric types whose arrays are formatted in bulk and stored in sidecars
+/*!
+ * Character types and bool are excluded since operator<< prints them as
+ * characters and words rather than numbers.
+ */
+template <typename T>
+struct IsNumber
+    : std::integral_constant<
+          bool, std::is_floating_point<T>::value ||
+                    (std::is_integral<T>::value &&
+                     !std::is_same<T, bool>::value &&
+                     !std::is_same<T, char>::value &&
+                     !std::is_same<T, signed char>::value &&
+                     !std::is_same<T, unsigned char>::value &&
+                     !std::is_same<T, wchar_t>::value &&
+                     !std::is_same<T, char16_t>::value &&
+                     !std::is_same<T, char32_t>::value)> {};
+
+//! Name of a numeric type in sidecar files, e.g. "float64"
+template <typename T>
+char const* GetTypeName() {
+  if (std::is_floating_point<T>::value) {
+    return sizeof(T) == 4 ? "float32" : sizeof(T) == 8 ? "float64" : "ldouble";
+  } else if (std::is_signed<T>::value) {
+    return sizeof(T) == 2 ? "int16" : sizeof(T) == 4 ? "int32" : "int64";
+  } else {
+    return sizeof(T) == 2 ? "uint16" : sizeof(T) == 4 ? "uint32" : "uint64";
+  }
+}
+
+//! Hierarchical section numbers such as "4.2.1."
+/*!
+ * Each thread has its own counter in each application context, shared by
+ * all monitors of that context. Entering a section opens a new level,
+ * leaving it advances the parent level and every message advances the
+ * current level. A counter is only modified by its own thread and needs
+ * no locking.
+ */
+class SectionCounter {
+ public:
+  //! Depth up to which the monitors of entered sections are kept
+  static const int kMaxNames = 32;
+
+  //! Reset the counter to section "1."
+  void Start() {
+    sections_.clear();
+    sections_.push_back(1);
+    depth_.store(0, std::memory_order_relaxed);
+  }
+
+  //! Open a new level
+  /*!
+   * @param monitor monitor of the section, kept for GetStack()
+   */
+  void Enter(Monitor* monitor = nullptr) {
+    sections_.push_back(0);
+
+    int depth = depth_.load(std::memory_order_relaxed);
+    if (depth < kMaxNames) {
+      monitors_[depth].store(monitor, std::memory_order_relaxed);
+    }
+    depth_.store(depth + 1, std::memory_order_release);
+  }
+
+  void Leave() {
+    sections_.pop_back();
+    if (sections_.size() > 0) sections_.back() += 1;
+
+    int depth = depth_.load(std::memory_order_relaxed);
+    if (depth > 0) depth_.store(depth - 1, std::memory_order_release);
+  }
+
+  //! Names of the entered sections, e.g. "main > hydro > riemann"
+  /*!
+   * Unlike the other methods, this may be called by any thread.
+   */
+  std::string GetStack() const;
+
+  //! Number of entered sections
+  int GetDepth() const { return depth_.load(std::memory_order_acquire); }
+
+  //! Monitor of the entered section at level, nullptr beyond kMaxNames
+  Monitor* GetMonitor(int level) const {
+    return level < kMaxNames ? monitors_[level].load(std::memory_order_relaxed)
+                             : nullptr;
+  }
+
+  void Advance() {
+    if (sections_.size() != 0) {
+      sections_.back() += 1;
+    } else {
+      sections_.push_back(1);
+    }
+  }
+
+  //! Remember the time the current section was entered, for profiling
+  void SetEnterTime(uint64_t time) {
+    if (enter_times_.size() < sections_.size()) {
+      enter_times_.resize(sections_.size(), 0);
+    }
+    enter_times_[sections_.size() - 1] = time;
+  }
+
+  //! Time the current section was entered, 0 if unknown
+  uint64_t GetEnterTime() const {
+    size_t depth = sections_.size();
+    return depth > 0 && depth <= enter_times_.size() ? enter_times_[depth - 1]
+                                                     : 0;
+  }
+
+  std::string GetID() const;
+
+  //! Write the ID into buf without allocating
+  /*!
+   * @return length of the ID, truncated to fit size - 1 characters
+   */
+  size_t FormatID(char* buf, size_t size) const;
+
  protected:
-  //! Protected ctor access thru static member function Instance
+  std::vector<uint32_t> sections_;
+
+  //! Enter time of each level, set while profiling
+  std::vector<uint64_t> enter_times_;
 
+  //! Monitors of the entered sections, readable by other threads
+  std::atomic<Monitor*> monitors_[kMaxNames] = {};
+  std::atomic<int> depth_{0};
+};
+
+//! Interned monitor name
+/*!
+ * Interning maps a monitor name to a small integer once per process.
+ * Contexts look up monitors by this integer with a single load, without
+ * locks or string compares. Use APP_MONITOR("name") to intern a name once
+ * per call site.
+ */
+class MonitorKey {
  public:
-  explicit Monitor(std::string name) : name_(name) {}
+  explicit MonitorKey(std::string const& name);
+
+  int GetID() const { return id_; }
+
+  std::string const& GetName() const { return name_; }
+
+ protected:
+  int id_;
+  std::string name_;
+};
+
+//! Monitor key interned on first use at this call site
+/*!
+ * Example:
+ *   Application::Logger app(APP_MONITOR("hydro"));
+ */
+#define APP_MONITOR(name)                    \
+  ([]() -> MonitorKey const& {               \
+    static const MonitorKey monitor_key(name); \
+    return monitor_key;                      \
+  }())
+
+class Monitor {
+ public:
+  //! Severity of a record
+  /*!
+   * Records below the level of a monitor are not written to its devices.
+   * They still reach the flight recorder if it is enabled.
+   */
+  enum Level {
+    kDebug = 0,
+    kLog = 1,
+    kWarn = 2,
+    kError = 3,
+    kOff = 4,  //!< write nothing to the devices
+  };
+
+  //! Layout of the records of a monitor
+  enum Format {
+    //! Log, "timestamp", name, section, "msg"
+    //! Indexed monitors add the sequence number after the section.
+    kText = 0,
+
+    //! One JSON object per line, e.g.
+    //! {"time":"2026-10-19T10:00:00","kind":"Log","monitor":"main",
+    //!  "section":"2.1.","msg":"step done","dt":0.01,"iter":5}
+    kJSON = 1,
+  };
+
+  //! Create a monitor that belongs to application context app
+  /*!
+   * Devices and section numbers are taken from the owning context. If app
+   * is nullptr, the default context Application::GetInstance() is used.
+   */
+  explicit Monitor(std::string name, Application* app = nullptr);
 
   //! Destructor - empty
   virtual ~Monitor() {}
@@ -28,6 +233,22 @@ class Monitor {
    */
   virtual void Log(std::string const& msg);
 
+  //! Write a debug message, filtered out unless the level is kDebug
+  virtual void Debug(std::string const& msg);
+
+  //! Write a message with typed fields
+  /*!
+   * In JSON format every field becomes a key of the record, in text format
+   * the fields are appended to the message as "key = value".
+   *
+   * Example:
+   *   monitor->Log("step done", {"dt", dt}, {"iter", n});
+   */
+  void Log(std::string const& msg, Field const& f0, Field const& f1 = Field(),
+           Field const& f2 = Field(), Field const& f3 = Field(),
+           Field const& f4 = Field(), Field const& f5 = Field(),
+           Field const& f6 = Field(), Field const& f7 = Field());
+
   template <typename T>
   void Log(std::string const& msg, T const& a);
 
@@ -37,6 +258,11 @@ class Monitor {
   template <typename T>
   void Log(std::string const& msg, std::vector<T> const& a);
 
+  //! Write a multi-dimensional array stored in row-major order
+  template <typename T>
+  void Log(std::string const& msg, T const* a,
+           std::vector<size_t> const& shape);
+
   //! Write an error message to the error device
   /*!
    * End-of-line character is not appended to the message.
@@ -53,17 +279,195 @@ class Monitor {
    */
   virtual void Warn(std::string const& msg, int code = 0);
 
+  //! Check that a value is finite and within [vmin, vmax]
+  /*!
+   * A warning is written if the value is out of range and an error if it
+   * is NaN or Inf.
+   *
+   * @return true if the value is valid
+   */
   template <typename T>
-  void Check(T const& val, double vmin, double max);
+  bool Check(T const& val, double vmin, double vmax) {
+    return Check("value", val, vmin, vmax);
+  }
+
+  template <typename T>
+  bool Check(std::string const& msg, T const& val, double vmin, double vmax);
+
+  //! Check a whole array for NaN, Inf and values outside [vmin, vmax]
+  /*!
+   * The scan is vectorized for the instruction sets of the running cpu and
+   * computes min/max/mean/L2 of the finite values in the same pass.
+   * Offending values are reported with their first indices, as an error if
+   * there are NaN or Inf and as a warning otherwise.
+   *
+   * @return statistics of the array
+   */
+  ArrayStats Check(std::string const& msg, float const* a, size_t n,
+                   double vmin, double vmax);
+
+  ArrayStats Check(std::string const& msg, double const* a, size_t n,
+                   double vmin, double vmax);
+
+  template <typename T>
+  ArrayStats Check(std::string const& msg, std::vector<T> const& a,
+                   double vmin, double vmax) {
+    return Check(msg, a.data(), a.size(), vmin, vmax);
+  }
 
   void Enter();
 
   void Leave();
 
+  //! Whether the library was built with USDT probes
+  /*!
+   * The probes of provider "application" are monitor__enter and
+   * monitor__leave(name, depth) and monitor__log, monitor__warn and
+   * monitor__error(name, depth, message), see probes.hpp. Log fires for
+   * messages and typed fields, not for values and arrays.
+   */
+  static bool HasProbes();
+
+  //! Commit the buffered records of the log and error devices
+  /*!
+   * Failed writes of the devices, also of those that write in the
+   * background, are reported as errors, here and after later records,
+   * see Device::TakeErrors.
+   */
+  void Flush();
+
+  //! Write only records of at least this level to the devices
+  /*!
+   * The level may be changed while other threads write records.
+   */
+  void SetLevel(Level level) {
+    level_.store(level, std::memory_order_relaxed);
+  }
+
+  Level GetLevel() const { return level_.load(std::memory_order_relaxed); }
+
+  std::string const& GetName() const { return name_; }
+
+  //! Number of sections and seconds spent in them while profiling
+  void GetProfile(uint64_t* calls, double* seconds) const {
+    *calls = profile_calls_.Value();
+    *seconds = 1.e-9 * profile_ns_.Value();
+  }
+
+  //! Record the arena bytes in use within one section of this monitor
+  void AddArenaPeak(uint64_t bytes) {
+    uint64_t peak = arena_peak_.load(std::memory_order_relaxed);
+    while (bytes > peak && !arena_peak_.compare_exchange_weak(
+                               peak, bytes, std::memory_order_relaxed)) {
+    }
+  }
+
+  //! Largest arena use of a section of this monitor, see Arena
+  uint64_t GetArenaPeak() const {
+    return arena_peak_.load(std::memory_order_relaxed);
+  }
+
+  //! Count an MPI call made while a section of this monitor was open
+  /*!
+   * Called by the PMPI wrappers of a build with PMPI_PROFILING.
+   */
+  void AddCommunication(uint64_t ns, uint64_t bytes) {
+    comm_calls_.Add();
+    comm_ns_.Add(ns);
+    comm_bytes_.Add(bytes);
+  }
+
+  //! MPI calls, seconds spent in them and bytes moved while profiling
+  void GetCommunication(uint64_t* calls, double* seconds,
+                        uint64_t* bytes) const {
+    *calls = comm_calls_.Value();
+    *seconds = 1.e-9 * comm_ns_.Value();
+    *bytes = comm_bytes_.Value();
+  }
+
+  //! Records and bytes written to the devices, records suppressed
+  /*!
+   * Suppressed records are those below the level of the monitor and
+   * warnings held back as duplicates. Warnings held back by a RateLimit
+   * never reach the monitor and are summarized by RateLimit::GetSummary.
+   */
+  void GetVolume(uint64_t* records, uint64_t* bytes,
+                 uint64_t* suppressed) const {
+    *records = records_.Value();
+    *bytes = bytes_.Value();
+    *suppressed = suppressed_.Value();
+  }
+
+  //! Seconds spent handing each record to a device
+  /*!
+   * Mostly a copy into the buffer of the calling thread, and a commit to
+   * the file whenever the buffer is full. Only writes timed while
+   * IsTimingWrites() are observed.
+   */
+  Histogram const& GetWriteLatency() const { return write_latency_; }
+
+  //! Time each write of all monitors, see GetWriteLatency
+  /*!
+   * Application::Start turns this on with the command line option -s.
+   */
+  static void SetTimingWrites(bool timing) {
+    timing_writes_.store(timing, std::memory_order_relaxed);
+  }
+
+  //! Whether writes are timed, also while the Profiler is enabled
+  static bool IsTimingWrites() {
+    return timing_writes_.load(std::memory_order_relaxed) ||
+           Profiler::IsEnabled();
+  }
+
+  //! Write records as text lines (default) or JSON lines
+  void SetFormat(Format format) { format_ = format; }
+
+  Format GetFormat() const { return format_; }
+
+  //! Write an index of the records next to the log and error files
+  /*!
+   * Indexed records carry a timestamp in nanoseconds, which is monotonic
+   * within the process, and a sequence number shared by all monitors of
+   * the process. The devices of the monitor write the byte offset of each
+   * record to an index file, see Device::EnableIndex and log_index.hpp.
+   */
+  void SetIndexed(bool indexed);
+
+  bool IsIndexed() const { return indexed_; }
+
+  //! Write each distinct warning message once
+  /*!
+   * Repeated warnings are counted in DedupSet::Global() and summarized
+   * when the application is destroyed. Warnings of this monitor with the
+   * same message are duplicates regardless of their code. The same
+   * message of another monitor or context is not.
+   */
+  void SetDeduplicate(bool dedup) { dedup_ = dedup; }
+
+  bool GetDeduplicate() const { return dedup_; }
+
+  //! Hash of a warning message in DedupSet::Global()
+  uint64_t GetDedupHash(std::string_view msg) const {
+    return DedupSet::Hash(msg, dedup_seed_);
+  }
+
   bool SetLogOutput(std::string const& fname);
 
   bool SetErrOutput(std::string const& fname);
 
+  //! Store large numeric arrays in a binary sidecar file
+  /*!
+   * Arrays with at least min_size elements are written to the sidecar
+   * and the log only records a reference "@file:offset dtype[shape]".
+   * Sidecars are shared by the monitors of a context like devices.
+   *
+   * @param fname    name of the sidecar file, empty to disable sidecars
+   * @param min_size smallest number of elements stored in the sidecar
+   */
+  void SetSidecar(std::string const& fname, size_t min_size = 1024);
+
+  //! Reset the section counter of the default context
   static void Start();
 
  protected:
@@ -71,53 +475,314 @@ class Monitor {
 
   virtual std::string getSectionID() const;
 
-  static void advance();
+  void advance();
+
+  //! Stamp an indexed record with the next sequence number and time
+  /*!
+   * @param section buffer receiving the section ID of the record
+   */
+  RecordInfo stampRecord(char* section, size_t size) const;
+
+  //! Whether a record of level goes anywhere
+  /*!
+   * Records below the level of the monitor are counted as suppressed.
+   */
+  bool isRecorded(Level level) {
+    if (level >= GetLevel()) return true;
+    suppressed_.Add();
+    return FlightRecorder::IsEnabled();
+  }
 
-  std::shared_ptr<std::ostream> log_device_;
-  std::shared_ptr<std::ostream> err_device_;
+  //! Hand a record to device, counting it and timing the call
+  void writeDevice(Device* device, struct iovec const* iov, int iovcnt,
+                   RecordInfo const* info);
+
+  //! Write the failed background writes of device as errors
+  void reportErrors(Device* device);
+
+  //! Copy a section transition into the flight recorder
+  void recordTransition(char const* kind);
+
+  //! Write the common head of a record followed by body
+  /*!
+   * The record goes to device if level is not filtered out and to the
+   * flight recorder if it is enabled.
+   */
+  void write(Device* device, Level level, char const* kind,
+             std::string const& body);
+
+  //! Write a JSON record with fields and an optional encoded value
+  /*!
+   * The record is encoded into a buffer of the calling thread that is
+   * reused by the next record.
+   *
+   * @param value encoded JSON written under key "value" unless empty
+   */
+  void writeJSON(Device* device, Level level, char const* kind,
+                 std::string const& msg, Field const* fields, int nfields,
+                 std::string_view value = {});
+
+  //! Report the offending values found by an array check
+  void reportCheck(std::string const& msg, ArrayStats const& stats,
+                   double vmin, double vmax);
+
+  //! Write n elements that are not numbers, formatted by operator<<
+  template <typename It>
+  void logElements(std::string const& msg, It first, size_t n);
+
+  //! Write an array of numbers
+  template <typename T>
+  void logArray(std::string const& msg, T const* a,
+                std::vector<size_t> const& shape);
+
+  //! Append numbers separated by spaces, formatted like operator<<
+  /*!
+   * With json, numbers are written as a JSON array in their shortest exact
+   * form instead.
+   */
+  template <typename T>
+  static void formatArray(std::string* out, T const* a, size_t n,
+                          bool json = false);
+
+  //! Get the device fname of the application, opening it if needed
+  DevicePtr findDevice(std::string const& fname);
+
+  //! Devices of the application, switched while other threads write
+  /*!
+   * The application keeps the devices it installed until it is destroyed,
+   * so a thread still writing to the previous device writes to a valid one.
+   */
+  std::atomic<Device*> log_device_{nullptr};
+  std::atomic<Device*> err_device_{nullptr};
+
+  std::shared_ptr<Sidecar> sidecar_;
+  size_t sidecar_min_size_ = 0;
 
   std::string name_;
 
-  static std::vector<uint32_t> sections_;
+  std::atomic<Level> level_{kLog};
+
+  Format format_ = kText;
+
+  bool indexed_ = false;
+
+  bool dedup_ = false;
+
+  //! Hash of the context and the monitor name, seeds the message hashes
+  uint64_t dedup_seed_;
+
+  //! Sections left and nanoseconds spent in them while profiling
+  Counter profile_calls_;
+  Counter profile_ns_;
+
+  //! Largest arena use of one section
+  std::atomic<uint64_t> arena_peak_{0};
+
+  //! MPI calls within the sections, see AddCommunication
+  Counter comm_calls_;
+  Counter comm_ns_;
+  Counter comm_bytes_;
+
+  //! Logging volume and latency, see GetVolume
+  Counter records_;
+  Counter bytes_;
+  Counter suppressed_;
+  Histogram write_latency_{Device::LatencyBuckets()};
+  inline static std::atomic<bool> timing_writes_{false};
+
+  //! Owning application context
+  Application* app_;
 };
 
 using MonitorPtr = std::unique_ptr<Monitor>;
 
 using MonitorMap = std::map<std::string, MonitorPtr>;
 
-using DevicePtr = std::shared_ptr<std::ostream>;
-
-using DeviceMap = std::map<std::string, DevicePtr>;
-
 template <typename T>
 void Monitor::Log(std::string const& msg, T const& a) {
+  if (!isRecorded(kLog)) return;
   advance();
-  char buf[880];
-  snprintf(buf, sizeof(buf), "Log, %s, %12s, %s, ", getTimeStamp().c_str(),
-           name_.c_str(), getSectionID().c_str());
-  (*log_device_) << buf << "\"" << msg << " = " << a << "\"\n";
+
+  if (format_ == kJSON) {
+    if constexpr (IsNumber<T>::value || std::is_same<T, bool>::value) {
+      Field field("value", a);
+      writeJSON(log_device_.load(), kLog, "Log", msg, &field, 1);
+    } else {
+      std::ostringstream ss;
+      ss << a;
+      Field field("value", ss.str());
+      writeJSON(log_device_.load(), kLog, "Log", msg, &field, 1);
+    }
+    return;
+  }
+
+  std::ostringstream ss;
+  ss << "\"" << msg << " = " << a << "\"\n";
+  write(log_device_.load(), kLog, "Log", ss.str());
 }
 
 template <typename T>
 void Monitor::Log(std::string const& msg, T* a, int n) {
-  advance();
-  char buf[880];
-  snprintf(buf, sizeof(buf), "Log, %s, %12s, %s, ", getTimeStamp().c_str(),
-           name_.c_str(), getSectionID().c_str());
-  (*log_device_) << buf << "\"" << msg << " = ";
-  for (int i = 0; i < n; ++i) (*log_device_) << a[i] << " ";
-  (*log_device_) << "\"\n";
+  using U = typename std::remove_cv<T>::type;
+
+  if constexpr (IsNumber<U>::value) {
+    logArray<U>(msg, a, {static_cast<size_t>(n)});
+  } else {
+    logElements(msg, a, static_cast<size_t>(n));
+  }
 }
 
 template <typename T>
 void Monitor::Log(std::string const& msg, std::vector<T> const& a) {
+  if constexpr (IsNumber<T>::value) {
+    logArray<T>(msg, a.data(), {a.size()});
+  } else {
+    logElements(msg, a.begin(), a.size());
+  }
+}
+
+template <typename T>
+void Monitor::Log(std::string const& msg, T const* a,
+                  std::vector<size_t> const& shape) {
+  static_assert(IsNumber<T>::value, "Shaped arrays must be numeric");
+  logArray<T>(msg, a, shape);
+}
+
+template <typename T>
+bool Monitor::Check(std::string const& msg, T const& val, double vmin,
+                    double vmax) {
+  double x = static_cast<double>(val);
+
+  if (std::isnan(x) || std::isinf(x)) {
+    Error(msg + " = " + std::to_string(x) + " is not finite");
+    return false;
+  }
+
+  if (x < vmin || x > vmax) {
+    Warn(msg + " = " + std::to_string(x) + " is outside [" +
+         std::to_string(vmin) + ", " + std::to_string(vmax) + "]");
+    return false;
+  }
+
+  return true;
+}
+
+template <typename It>
+void Monitor::logElements(std::string const& msg, It first, size_t n) {
+  if (!isRecorded(kLog)) return;
+  advance();
+
+  if (format_ == kJSON) {
+    std::string value = "[";
+    JsonEncoder json(&value);
+    for (size_t i = 0; i < n; ++i, ++first) {
+      std::ostringstream ss;
+      ss << *first;
+      if (i > 0) value += ",";
+      json.String(ss.str());
+    }
+    value += "]";
+    writeJSON(log_device_.load(), kLog, "Log", msg, nullptr, 0, value);
+    return;
+  }
+
+  std::ostringstream ss;
+  ss << "\"" << msg << " = ";
+  for (size_t i = 0; i < n; ++i, ++first) ss << *first << " ";
+  ss << "\"\n";
+  write(log_device_.load(), kLog, "Log", ss.str());
+}
+
+template <typename T>
+void Monitor::logArray(std::string const& msg, T const* a,
+                       std::vector<size_t> const& shape) {
+  if (!isRecorded(kLog)) return;
   advance();
-  char buf[880];
-  snprintf(buf, sizeof(buf), "Log, %s, %12s, %s, ", getTimeStamp().c_str(),
-           name_.c_str(), getSectionID().c_str());
-  (*log_device_) << buf << "\"" << msg << " = ";
-  for (size_t i = 0; i < a.size(); ++i) (*log_device_) << a[i] << " ";
-  (*log_device_) << "\"\n";
+
+  size_t n = 1;
+  for (auto extent : shape) n *= extent;
+
+  bool json = format_ == kJSON;
+  std::string body = json ? "" : "\"" + msg + " = ";
+
+  // reference to the data instead of the data
+  std::string ref;
+  auto type_and_shape = [&]() {
+    ref += std::string(GetTypeName<T>()) + "[";
+    for (size_t i = 0; i < shape.size(); ++i) {
+      if (i > 0) ref += ",";
+      ref += std::to_string(shape[i]);
+    }
+    ref += "]";
+  };
+
+  if (kLog < GetLevel()) {
+    // only the flight recorder sees this record, do not format the data
+    type_and_shape();
+  } else if (sidecar_ != nullptr && n >= sidecar_min_size_) {
+    uint64_t offset = sidecar_->Write(GetTypeName<T>(), a, sizeof(T), shape);
+    ref = "@" + sidecar_->GetFileName() + ":" + std::to_string(offset) + " ";
+    type_and_shape();
+  }
+
+  if (!ref.empty()) {
+    if (json) {
+      JsonEncoder(&body).String(ref);
+    } else {
+      body += ref;
+    }
+  } else {
+    body.reserve(body.size() + n * 12 + 3);
+    formatArray(&body, a, n, json);
+  }
+
+  if (json) {
+    writeJSON(log_device_.load(), kLog, "Log", msg, nullptr, 0, body);
+  } else {
+    body += "\"\n";
+    write(log_device_.load(), kLog, "Log", body);
+  }
+}
+
+template <typename T>
+void Monitor::formatArray(std::string* out, T const* a, size_t n, bool json) {
+  char buf[4096];
+  char* pos = buf;
+  char* end = buf + sizeof(buf);
+
+  if (json) *pos++ = '[';
+
+  for (size_t i = 0; i < n; ++i) {
+    // longest number is 20 digits for integers, 24 characters for doubles
+    if (end - pos < 64) {
+      out->append(buf, pos - buf);
+      pos = buf;
+    }
+
+    if (json) {
+      if (i > 0) *pos++ = ',';
+      if constexpr (std::is_floating_point<T>::value) {
+        if (!std::isfinite(a[i])) {
+          memcpy(pos, "null", 4);
+          pos += 4;
+          continue;
+        }
+      }
+      pos = std::to_chars(pos, end, a[i]).ptr;
+      continue;
+    }
+
+    if constexpr (std::is_floating_point<T>::value) {
+      pos = std::to_chars(pos, end, a[i], std::chars_format::general, 6).ptr;
+    } else {
+      pos = std::to_chars(pos, end, a[i]).ptr;
+    }
+    *pos++ = ' ';
+  }
+
+  if (json) *pos++ = ']';
+
+  out->append(buf, pos - buf);
 }
 
 #endif  // SRC_MONITOR_HPP_
@@ -0,0 +1,383 @@
+// C/C++
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// POSIX C extensions
+#include <fcntl.h>     // open()
+#include <sys/mman.h>  // mmap()
+#include <sys/stat.h>  // fstat()
+#include <unistd.h>    // close()
+
+// application
+#include "exceptions.hpp"
+#include "globals.hpp"
+#include "parameters.hpp"
+
+#ifdef MPI_PARALLEL
+#include <mpi.h>
+#endif
+
+//! Magic number of serialized parameters
+static const char kMagic[8] = {'A', 'P', 'P', 'P', 'A', 'R', 'A', 'M'};
+
+static std::string_view trim(std::string_view str) {
+  auto first = str.find_first_not_of(" \t\r");
+  if (first == std::string_view::npos) return {};
+  auto last = str.find_last_not_of(" \t\r");
+  return str.substr(first, last - first + 1);
+}
+
+//! Modification time of a file in nanoseconds, 0 if it does not exist
+static uint64_t modificationTime(std::string const& fname) {
+  struct stat st;
+  if (stat(fname.c_str(), &st) != 0) return 0;
+  return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000 +
+         st.st_mtim.tv_nsec;
+}
+
+static std::string readFile(std::string const& fname) {
+  std::ifstream in(fname, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+void Parameters::Load(std::string const& fname, std::string const& cache) {
+  if (!cache.empty() &&
+      modificationTime(cache) > modificationTime(fname) &&
+      Deserialize(readFile(cache))) {
+    return;
+  }
+
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw NotFoundError("Parameters::Load", "Input file " + fname);
+  }
+
+  struct stat st;
+  fstat(fd, &st);
+  size_t size = st.st_size;
+
+  if (size > 0) {
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      throw RuntimeError("Parameters::Load", "Cannot map file " + fname);
+    }
+
+    try {
+      LoadString({static_cast<char const*>(data), size}, fname);
+    } catch (...) {
+      munmap(data, size);
+      close(fd);
+      throw;
+    }
+
+    munmap(data, size);
+  }
+  close(fd);
+
+  if (!cache.empty()) {
+    std::ofstream(cache, std::ios::binary) << Serialize();
+  }
+}
+
+void Parameters::LoadString(std::string_view text, std::string const& source) {
+  std::string block;
+  int nline = 0;
+
+  while (!text.empty()) {
+    auto eol = text.find('\n');
+    auto line = text.substr(0, eol);
+    text = eol == std::string_view::npos ? std::string_view()
+                                         : text.substr(eol + 1);
+    nline++;
+
+    auto comment = line.find('#');
+    if (comment != std::string_view::npos) line = line.substr(0, comment);
+    line = trim(line);
+    if (line.empty()) continue;
+
+    auto where = [&]() {
+      return (source.empty() ? "line " : source + ":") + std::to_string(nline);
+    };
+
+    if (line.front() == '<') {
+      if (line.back() != '>') {
+        throw RuntimeError("Parameters::LoadString",
+                           where() + ": unterminated block name");
+      }
+      block = trim(line.substr(1, line.size() - 2));
+      continue;
+    }
+
+    auto eq = line.find('=');
+    if (eq == std::string_view::npos) {
+      throw RuntimeError("Parameters::LoadString",
+                         where() + ": expected name = value");
+    }
+
+    auto name = trim(line.substr(0, eq));
+    auto value = trim(line.substr(eq + 1));
+    if (name.empty()) {
+      throw RuntimeError("Parameters::LoadString", where() + ": empty name");
+    }
+
+    Set(block, std::string(name), std::string(value));
+  }
+}
+
+int Parameters::ApplyOverrides(int argc, char** argv) {
+  int napplied = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg.empty() || arg[0] == '-') continue;
+
+    auto slash = arg.find('/');
+    auto eq = arg.find('=');
+    if (slash == std::string_view::npos || eq == std::string_view::npos ||
+        slash > eq || slash == 0) {
+      continue;
+    }
+
+    Set(std::string(arg.substr(0, slash)),
+        std::string(trim(arg.substr(slash + 1, eq - slash - 1))),
+        std::string(trim(arg.substr(eq + 1))));
+    napplied++;
+  }
+
+  return napplied;
+}
+
+void Parameters::LoadShared(std::string const& fname) {
+  std::exception_ptr failure;
+  std::string error;
+
+  if (Globals::my_rank == 0) {
+    try {
+      Load(fname);
+    } catch (ExceptionBase const& e) {
+      failure = std::current_exception();
+      error = e.GetMessage();
+    } catch (std::exception const& e) {
+      failure = std::current_exception();
+      error = e.what();
+    }
+  }
+
+#ifdef MPI_PARALLEL
+  uint64_t size = error.size();
+  MPI_Bcast(&size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+  error.resize(size);
+  if (size > 0) MPI_Bcast(&error[0], size, MPI_CHAR, 0, MPI_COMM_WORLD);
+#endif
+
+  if (failure) std::rethrow_exception(failure);
+  if (!error.empty()) {
+    throw RuntimeError("Parameters::LoadShared",
+                       "Rank 0 failed to load " + fname + ": " + error);
+  }
+
+  Broadcast();
+}
+
+void Parameters::Broadcast() {
+#ifdef MPI_PARALLEL
+  std::string data;
+  if (Globals::my_rank == 0) data = Serialize();
+
+  uint64_t size = data.size();
+  MPI_Bcast(&size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+  data.resize(size);
+  MPI_Bcast(&data[0], size, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+  if (Globals::my_rank != 0) Deserialize(data);
+#endif
+}
+
+void Parameters::Set(std::string const& block, std::string const& name,
+                     std::string const& value) {
+  auto& entry = entries_[makeKey(block, name)];
+
+  if (entry == nullptr) {
+    entry = std::make_unique<Entry>();
+    entry->block = block;
+    entry->name = name;
+    entry->order = entries_.size() - 1;
+  }
+
+  auto convertAll = [&]() {
+    for (int type : {kReal, kInteger, kBoolean}) {
+      if (entry->types & type) convert(entry.get(), type);
+    }
+  };
+
+  // keep the old value if the new one breaks a handle
+  std::string old = entry->value;
+  entry->value = value;
+  try {
+    convertAll();
+  } catch (...) {
+    entry->value = old;
+    convertAll();
+    throw;
+  }
+}
+
+Parameters::Entry* Parameters::find(std::string const& block,
+                                    std::string const& name) {
+  auto it = entries_.find(makeKey(block, name));
+  if (it == entries_.end()) {
+    throw NotFoundError("Parameters", "Parameter " + makeKey(block, name));
+  }
+  return it->second.get();
+}
+
+void Parameters::convert(Entry* entry, int type) {
+  char const* str = entry->value.c_str();
+  char* end = nullptr;
+  bool ok = !entry->value.empty();
+
+  errno = 0;
+  switch (type) {
+    case kReal:
+      entry->real = std::strtod(str, &end);
+      ok = ok && *end == '\0' && errno == 0;
+      break;
+    case kInteger:
+      entry->integer = std::strtoll(str, &end, 10);
+      ok = ok && *end == '\0' && errno == 0;
+      break;
+    case kBoolean: {
+      std::string lower = entry->value;
+      std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+      if (lower == "true" || lower == "yes" || lower == "on" || lower == "1") {
+        entry->boolean = true;
+      } else if (lower == "false" || lower == "no" || lower == "off" ||
+                 lower == "0") {
+        entry->boolean = false;
+      } else {
+        ok = false;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  if (!ok) {
+    static char const* names[] = {"", "real", "integer", "", "boolean"};
+    throw RuntimeError("Parameters", "Parameter " +
+                                         makeKey(entry->block, entry->name) +
+                                         " = '" + entry->value + "' is not " +
+                                         names[type]);
+  }
+}
+
+std::string Parameters::ToString() const {
+  std::vector<Entry const*> sorted;
+  for (auto const& it : entries_) sorted.push_back(it.second.get());
+
+  // group by block, blocks and parameters in order of first appearance
+  std::map<std::string, size_t> block_order;
+  for (auto entry : sorted) {
+    auto it = block_order.find(entry->block);
+    if (it == block_order.end() || entry->order < it->second) {
+      block_order[entry->block] = entry->order;
+    }
+  }
+
+  std::sort(sorted.begin(), sorted.end(), [&](Entry const* a, Entry const* b) {
+    size_t ba = block_order[a->block], bb = block_order[b->block];
+    return ba != bb ? ba < bb : a->order < b->order;
+  });
+
+  std::string text;
+  std::string const* block = nullptr;
+  for (auto entry : sorted) {
+    if (block == nullptr || *block != entry->block) {
+      block = &entry->block;
+      text += "<" + *block + ">\n";
+    }
+    text += entry->name + " = " + entry->value + "\n";
+  }
+
+  return text;
+}
+
+std::string Parameters::Serialize() const {
+  std::string data(kMagic, sizeof(kMagic));
+
+  auto append = [&](std::string const& str) {
+    uint32_t size = str.size();
+    data.append(reinterpret_cast<char const*>(&size), sizeof(size));
+    data.append(str);
+  };
+
+  // in order of first appearance, so that it is kept on other ranks
+  std::vector<Entry const*> sorted;
+  for (auto const& it : entries_) sorted.push_back(it.second.get());
+  std::sort(sorted.begin(), sorted.end(),
+            [](Entry const* a, Entry const* b) { return a->order < b->order; });
+
+  uint64_t count = sorted.size();
+  data.append(reinterpret_cast<char const*>(&count), sizeof(count));
+
+  for (auto entry : sorted) {
+    append(entry->block);
+    append(entry->name);
+    append(entry->value);
+  }
+
+  return data;
+}
+
+bool Parameters::Deserialize(std::string_view data) {
+  if (data.size() < sizeof(kMagic) + sizeof(uint64_t) ||
+      memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+  data.remove_prefix(sizeof(kMagic));
+
+  uint64_t count;
+  memcpy(&count, data.data(), sizeof(count));
+  data.remove_prefix(sizeof(count));
+
+  // each parameter takes at least three sizes
+  if (count > data.size() / (3 * sizeof(uint32_t))) return false;
+
+  auto next = [&](std::string* str) {
+    uint32_t size;
+    if (data.size() < sizeof(size)) return false;
+    memcpy(&size, data.data(), sizeof(size));
+    data.remove_prefix(sizeof(size));
+
+    if (data.size() < size) return false;
+    str->assign(data.data(), size);
+    data.remove_prefix(size);
+    return true;
+  };
+
+  std::vector<std::string> fields(3 * count);
+  for (auto& field : fields) {
+    if (!next(&field)) return false;
+  }
+
+  // values replace existing ones, so that handles stay valid
+  for (size_t i = 0; i < count; ++i) {
+    Set(fields[3 * i], fields[3 * i + 1], fields[3 * i + 2]);
+  }
+
+  return true;
+}
@@ -0,0 +1,243 @@
+#ifndef SRC_PARAMETERS_HPP_
+#define SRC_PARAMETERS_HPP_
+
+// C/C++
+#include <charconv>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+//! Parameters of an input file and command-line overrides
+/*!
+ * Input files are divided into blocks of "name = value" lines:
+ *
+ *   <mesh>
+ *   nx1  = 64      # cells in x1
+ *   xmin = -0.5
+ *
+ * and command-line arguments "mesh/nx1=128" override or add parameters.
+ * Application::Start loads the file given with -i on rank 0, broadcasts
+ * it to the other ranks and applies the overrides.
+ *
+ * Parameters are looked up by name once, into a typed handle. Reading a
+ * handle is a plain load, so handles can be used in hot code:
+ *
+ *   static auto nx1 = params->GetHandle<int64_t>("mesh", "nx1");
+ *   for (int64_t i = 0; i < *nx1; ++i) ...
+ *
+ * Handles stay valid and see new values of Set(). Set() must not be
+ * called while other threads read the parameter.
+ */
+class Parameters {
+ public:
+  //! Typed reference to the value of a parameter
+  template <typename T>
+  class Handle {
+   public:
+    Handle() : value_(nullptr) {}
+
+    explicit Handle(T const* value) : value_(value) {}
+
+    T const& operator*() const { return *value_; }
+
+    T const* operator->() const { return value_; }
+
+    T const& Get() const { return *value_; }
+
+   protected:
+    T const* value_;
+  };
+
+  Parameters() {}
+
+  Parameters(Parameters const&) = delete;
+  Parameters& operator=(Parameters const&) = delete;
+
+  //! Parse an input file, adding to and replacing existing parameters
+  /*!
+   * The file is memory-mapped and parsed in one pass. If cache is given,
+   * the parsed parameters are read from the binary cache file instead as
+   * long as it is newer than fname, and written to it otherwise.
+   */
+  void Load(std::string const& fname, std::string const& cache = "");
+
+  //! Parse an input file on rank 0 and share the parameters with all ranks
+  /*!
+   * Collective over MPI_COMM_WORLD. If rank 0 fails to parse the file, it
+   * rethrows its error and the other ranks throw a RuntimeError with the
+   * same message instead of waiting for the parameters.
+   */
+  void LoadShared(std::string const& fname);
+
+  //! Parse input file text
+  void LoadString(std::string_view text, std::string const& source = "");
+
+  //! Apply the "block/name=value" arguments of a command line
+  /*!
+   * @return number of overrides applied
+   */
+  int ApplyOverrides(int argc, char** argv);
+
+  //! Share the parameters of rank 0 with all ranks
+  /*!
+   * Collective over MPI_COMM_WORLD. Parameters of rank 0 are added to
+   * or replace those of the other ranks. Without MPI this does nothing.
+   */
+  void Broadcast();
+
+  //! Add or replace a parameter
+  /*!
+   * An exception is thrown if the value does not convert to the type of
+   * an existing handle of the parameter.
+   */
+  void Set(std::string const& block, std::string const& name,
+           std::string const& value);
+
+  bool Has(std::string const& block, std::string const& name) const {
+    return entries_.count(makeKey(block, name)) > 0;
+  }
+
+  size_t Count() const { return entries_.size(); }
+
+  //! Handle of a parameter; an exception is thrown if it is missing
+  template <typename T>
+  Handle<T> GetHandle(std::string const& block, std::string const& name);
+
+  //! Handle of a parameter that is added with value def if missing
+  template <typename T>
+  Handle<T> GetHandle(std::string const& block, std::string const& name,
+                      T const& def);
+
+  double GetReal(std::string const& block, std::string const& name) {
+    return *GetHandle<double>(block, name);
+  }
+
+  int64_t GetInteger(std::string const& block, std::string const& name) {
+    return *GetHandle<int64_t>(block, name);
+  }
+
+  bool GetBoolean(std::string const& block, std::string const& name) {
+    return *GetHandle<bool>(block, name);
+  }
+
+  std::string const& GetString(std::string const& block,
+                               std::string const& name) {
+    return *GetHandle<std::string>(block, name);
+  }
+
+  //! Parameters in input file format, blocks in order of first appearance
+  std::string ToString() const;
+
+  //! Binary form of the parameters for caches and broadcasts
+  std::string Serialize() const;
+
+  //! Add or replace the parameters of a binary form made with Serialize()
+  /*!
+   * @return false if data is not a serialized parameter set
+   */
+  bool Deserialize(std::string_view data);
+
+ protected:
+  //! Types a value has been converted to
+  enum Type {
+    kReal = 1,
+    kInteger = 2,
+    kBoolean = 4,
+  };
+
+  struct Entry {
+    std::string block;
+    std::string name;
+    std::string value;
+
+    //! Order of first appearance
+    size_t order;
+
+    //! Types of the handles of the entry
+    int types = 0;
+
+    double real = 0.;
+    int64_t integer = 0;
+    bool boolean = false;
+  };
+
+  static std::string makeKey(std::string const& block,
+                             std::string const& name) {
+    return block + "/" + name;
+  }
+
+  Entry* find(std::string const& block, std::string const& name);
+
+  //! Convert the value of entry to type, throw if it does not convert
+  static void convert(Entry* entry, int type);
+
+  template <typename T>
+  static int typeOf() {
+    if (std::is_same<T, bool>::value) return kBoolean;
+    if (std::is_floating_point<T>::value) return kReal;
+    if (std::is_integral<T>::value) return kInteger;
+    return 0;
+  }
+
+  template <typename T>
+  static std::string toString(T const& value);
+
+  //! Entries by "block/name", stable in memory for handles
+  std::map<std::string, std::unique_ptr<Entry>> entries_;
+};
+
+template <typename T>
+Parameters::Handle<T> Parameters::GetHandle(std::string const& block,
+                                            std::string const& name) {
+  static_assert(std::is_same<T, double>::value ||
+                    std::is_same<T, int64_t>::value ||
+                    std::is_same<T, bool>::value ||
+                    std::is_same<T, std::string>::value,
+                "Parameters are double, int64_t, bool or std::string");
+
+  Entry* entry = find(block, name);
+
+  if constexpr (std::is_same<T, std::string>::value) {
+    return Handle<T>(&entry->value);
+  } else {
+    convert(entry, typeOf<T>());
+    entry->types |= typeOf<T>();
+
+    if constexpr (std::is_same<T, bool>::value) {
+      return Handle<T>(&entry->boolean);
+    } else if constexpr (std::is_same<T, double>::value) {
+      return Handle<T>(&entry->real);
+    } else {
+      return Handle<T>(&entry->integer);
+    }
+  }
+}
+
+template <typename T>
+Parameters::Handle<T> Parameters::GetHandle(std::string const& block,
+                                            std::string const& name,
+                                            T const& def) {
+  if (!Has(block, name)) Set(block, name, toString(def));
+  return GetHandle<T>(block, name);
+}
+
+template <typename T>
+std::string Parameters::toString(T const& value) {
+  if constexpr (std::is_same<T, std::string>::value) {
+    return value;
+  } else if constexpr (std::is_same<T, bool>::value) {
+    return value ? "true" : "false";
+  } else if constexpr (std::is_floating_point<T>::value) {
+    char buf[32];
+    auto end = std::to_chars(buf, buf + sizeof(buf), value).ptr;
+    return std::string(buf, end - buf);
+  } else {
+    return std::to_string(value);
+  }
+}
+
+#endif  // SRC_PARAMETERS_HPP_
@@ -0,0 +1,153 @@
+// C/C++
+#include <cstdint>
+
+// application
+#include "application.hpp"
+#include "globals.hpp"
+#include "profiler.hpp"
+
+#ifdef PMPI_PROFILING
+
+//! Times one MPI call and attributes it to the open sections
+/*!
+ * The call is added to every monitor on the section stack of the calling
+ * thread, so that the MPI time of a section includes that of its
+ * children, like its profiled time does. Calls are only timed while the
+ * Profiler is enabled; otherwise a wrapper costs one relaxed load.
+ */
+class CommTimer {
+ public:
+  CommTimer(int count, MPI_Datatype type)
+      : start_(Profiler::IsEnabled() ? Profiler::Now() : 0),
+        count_(count),
+        type_(type) {}
+
+  ~CommTimer() {
+    if (start_ == 0 || !Profiler::IsEnabled()) return;
+
+    uint64_t ns = Profiler::Now() - start_;
+
+    uint64_t bytes = 0;
+    if (type_ != MPI_DATATYPE_NULL && count_ > 0) {
+      int size;
+      PMPI_Type_size(type_, &size);
+      bytes = static_cast<uint64_t>(count_) * size;
+    }
+
+    auto sections = Application::GetCurrent()->GetSections();
+    int depth = sections->GetDepth();
+    for (int i = 0; i < depth; ++i) {
+      Monitor* monitor = sections->GetMonitor(i);
+      if (monitor != nullptr) monitor->AddCommunication(ns, bytes);
+    }
+  }
+
+ protected:
+  uint64_t start_;
+  int count_;
+  MPI_Datatype type_;
+};
+
+// point-to-point
+
+int MPI_Send(const void* buf, int count, MPI_Datatype type, int dest, int tag,
+             MPI_Comm comm) {
+  CommTimer timer(count, type);
+  return PMPI_Send(buf, count, type, dest, tag, comm);
+}
+
+int MPI_Recv(void* buf, int count, MPI_Datatype type, int source, int tag,
+             MPI_Comm comm, MPI_Status* status) {
+  CommTimer timer(count, type);
+  return PMPI_Recv(buf, count, type, source, tag, comm, status);
+}
+
+int MPI_Isend(const void* buf, int count, MPI_Datatype type, int dest,
+              int tag, MPI_Comm comm, MPI_Request* request) {
+  CommTimer timer(count, type);
+  return PMPI_Isend(buf, count, type, dest, tag, comm, request);
+}
+
+int MPI_Irecv(void* buf, int count, MPI_Datatype type, int source, int tag,
+              MPI_Comm comm, MPI_Request* request) {
+  CommTimer timer(count, type);
+  return PMPI_Irecv(buf, count, type, source, tag, comm, request);
+}
+
+int MPI_Sendrecv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                 int dest, int sendtag, void* recvbuf, int recvcount,
+                 MPI_Datatype recvtype, int source, int recvtag,
+                 MPI_Comm comm, MPI_Status* status) {
+  CommTimer timer(sendcount, sendtype);
+  return PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag, recvbuf,
+                       recvcount, recvtype, source, recvtag, comm, status);
+}
+
+int MPI_Wait(MPI_Request* request, MPI_Status* status) {
+  CommTimer timer(0, MPI_DATATYPE_NULL);
+  return PMPI_Wait(request, status);
+}
+
+int MPI_Waitall(int count, MPI_Request requests[], MPI_Status statuses[]) {
+  CommTimer timer(0, MPI_DATATYPE_NULL);
+  return PMPI_Waitall(count, requests, statuses);
+}
+
+// collectives
+
+int MPI_Barrier(MPI_Comm comm) {
+  CommTimer timer(0, MPI_DATATYPE_NULL);
+  return PMPI_Barrier(comm);
+}
+
+int MPI_Bcast(void* buf, int count, MPI_Datatype type, int root,
+              MPI_Comm comm) {
+  CommTimer timer(count, type);
+  return PMPI_Bcast(buf, count, type, root, comm);
+}
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int count,
+               MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm) {
+  CommTimer timer(count, type);
+  return PMPI_Reduce(sendbuf, recvbuf, count, type, op, root, comm);
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count,
+                  MPI_Datatype type, MPI_Op op, MPI_Comm comm) {
+  CommTimer timer(count, type);
+  return PMPI_Allreduce(sendbuf, recvbuf, count, type, op, comm);
+}
+
+int MPI_Gather(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+               void* recvbuf, int recvcount, MPI_Datatype recvtype, int root,
+               MPI_Comm comm) {
+  CommTimer timer(sendcount, sendtype);
+  return PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                     recvtype, root, comm);
+}
+
+int MPI_Gatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                void* recvbuf, const int recvcounts[], const int displs[],
+                MPI_Datatype recvtype, int root, MPI_Comm comm) {
+  CommTimer timer(sendcount, sendtype);
+  return PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts,
+                      displs, recvtype, root, comm);
+}
+
+int MPI_Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                  void* recvbuf, int recvcount, MPI_Datatype recvtype,
+                  MPI_Comm comm) {
+  CommTimer timer(sendcount, sendtype);
+  return PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                        recvtype, comm);
+}
+
+int MPI_Alltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                 void* recvbuf, int recvcount, MPI_Datatype recvtype,
+                 MPI_Comm comm) {
+  CommTimer timer(sendcount, sendtype);
+  return PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                       recvtype, comm);
+}
+
+#endif  // PMPI_PROFILING
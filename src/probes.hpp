@@ -0,0 +1,117 @@
+#ifndef SRC_PROBES_HPP_
+#define SRC_PROBES_HPP_
+
+// application
+#include "globals.hpp"
+
+/*!
+ * USDT (user statically-defined tracing) probes of provider "application"
+ * for perf, bpftrace and SystemTap, e.g.
+ *
+ *   bpftrace -e 'usdt:./app:application:monitor__enter
+ *                { printf("%s %d\n", str(arg0), arg1); }'
+ *
+ * A probe site is a single nop with an ELF note (.note.stapsdt) telling
+ * the tracer where it is and how to read its arguments. Each probe has a
+ * semaphore that tracers increment while attached; the arguments are only
+ * computed while it is non-zero:
+ *
+ *   if (APP_PROBE_ENABLED(monitor__log)) {
+ *     APP_PROBE3(monitor__log, name, depth, msg);
+ *   }
+ *
+ * With USDT_OPTION=USDT_PROBES, the probes use <sys/sdt.h> if cmake found
+ * it, and otherwise emit the same notes themselves on x86-64 and aarch64
+ * with GCC or Clang. Elsewhere, and by default, probes compile to nothing.
+ * Semaphores are defined with APP_PROBE_SEMAPHORE in one source file.
+ */
+
+#if defined(USDT_PROBES) && defined(HAVE_SYS_SDT_H)
+
+#define APP_PROBES_COMPILED 1
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define APP_PROBE2(name, a1, a2) STAP_PROBE2(application, name, a1, a2)
+#define APP_PROBE3(name, a1, a2, a3) STAP_PROBE3(application, name, a1, a2, a3)
+
+#elif defined(USDT_PROBES) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__aarch64__))
+
+#define APP_PROBES_COMPILED 1
+
+// the note layout of <sys/sdt.h> version 3, with a semaphore; args is the
+// argument string, e.g. "8@%0 -4@%1", where the operands print as the
+// location of each argument
+#define APP_PROBE_ASM_(name, args, ...)                                     \
+  __asm__ __volatile__(                                                    \
+      "990: nop\n"                                                         \
+      ".pushsection .note.stapsdt,\"?\",\"note\"\n"                        \
+      ".balign 4\n"                                                        \
+      ".4byte 992f-991f, 994f-993f, 3\n"                                   \
+      "991: .asciz \"stapsdt\"\n"                                          \
+      "992: .balign 4\n"                                                   \
+      "993: .8byte 990b\n"                                                 \
+      ".8byte _.stapsdt.base\n"                                            \
+      ".8byte application_" #name "_semaphore\n"                           \
+      ".asciz \"application\"\n"                                           \
+      ".asciz \"" #name "\"\n"                                             \
+      ".asciz \"" args "\"\n"                                              \
+      "994: .balign 4\n"                                                   \
+      ".popsection\n"                                                      \
+      ".ifndef _.stapsdt.base\n"                                           \
+      ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+      ".weak _.stapsdt.base\n"                                             \
+      ".hidden _.stapsdt.base\n"                                           \
+      "_.stapsdt.base: .space 1\n"                                         \
+      ".size _.stapsdt.base, 1\n"                                          \
+      ".popsection\n"                                                      \
+      ".endif\n"                                                           \
+      :                                                                    \
+      : __VA_ARGS__)
+
+//! Probe with a pointer and an int argument
+#define APP_PROBE2(name, a1, a2) \
+  APP_PROBE_ASM_(name, "8@%0 -4@%1", "nor"(a1), "nor"(a2))
+
+//! Probe with a pointer, an int and a pointer argument
+#define APP_PROBE3(name, a1, a2, a3) \
+  APP_PROBE_ASM_(name, "8@%0 -4@%1 8@%2", "nor"(a1), "nor"(a2), "nor"(a3))
+
+#else
+
+#define APP_PROBES_COMPILED 0
+
+#define APP_PROBE2(name, a1, a2) \
+  do {                           \
+  } while (0)
+#define APP_PROBE3(name, a1, a2, a3) \
+  do {                               \
+  } while (0)
+
+#endif
+
+#if APP_PROBES_COMPILED
+
+//! Define the semaphore of a probe, at namespace scope of one source file
+#define APP_PROBE_SEMAPHORE(name)       \
+  unsigned short application_##name##_semaphore \
+      __attribute__((section(".probes"), used)) = 0
+
+#define APP_PROBE_SEMAPHORE_DECL(name) \
+  extern unsigned short application_##name##_semaphore
+
+//! Whether a tracer is attached to the probe
+#define APP_PROBE_ENABLED(name) \
+  __builtin_expect(application_##name##_semaphore != 0, 0)
+
+#else
+
+#define APP_PROBE_SEMAPHORE(name) static_assert(true, "")
+#define APP_PROBE_SEMAPHORE_DECL(name) static_assert(true, "")
+#define APP_PROBE_ENABLED(name) false
+
+#endif
+
+#endif  // SRC_PROBES_HPP_
@@ -0,0 +1,46 @@
+#ifndef SRC_PROFILER_HPP_
+#define SRC_PROFILER_HPP_
+
+// C/C++
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+//! Switch of the section profiler
+/*!
+ * While profiling is enabled, every monitor accumulates the number of its
+ * sections (Enter/Leave pairs, e.g. Application::Logger scopes) and the
+ * wall time spent in them, children included. Enabling and disabling is
+ * safe while other threads log: sections entered before profiling was
+ * enabled are not counted. When disabled, a section costs one relaxed
+ * atomic load more. See Application::GetProfile for the report.
+ */
+class Profiler {
+ public:
+  static void Enable() {
+    start_.store(Now(), std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_release);
+  }
+
+  static void Disable() { enabled_.store(false, std::memory_order_relaxed); }
+
+  static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  //! Time profiling was enabled last, see Now()
+  static uint64_t GetStartTime() {
+    return start_.load(std::memory_order_relaxed);
+  }
+
+  //! Steady clock in nanoseconds
+  static uint64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+ protected:
+  inline static std::atomic<bool> enabled_{false};
+  inline static std::atomic<uint64_t> start_{0};
+};
+
+#endif  // SRC_PROFILER_HPP_
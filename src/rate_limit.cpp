@@ -0,0 +1,160 @@
+// C/C++
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// application
+#include "rate_limit.hpp"
+
+static uint64_t nowNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+RateLimit::RateLimit(char const* site, uint64_t every, uint64_t max,
+                     double interval)
+    : site_(site),
+      every_(every > 0 ? every : 1),
+      max_(max),
+      interval_(static_cast<uint64_t>(interval * 1.e9)),
+      count_(0),
+      passed_(0),
+      window_start_(0),
+      window_count_(0) {
+  // push onto the list of all limits
+  next_ = head_.load(std::memory_order_relaxed);
+  while (!head_.compare_exchange_weak(next_, this, std::memory_order_release,
+                                      std::memory_order_relaxed)) {
+  }
+}
+
+bool RateLimit::Allow() {
+  uint64_t n = count_.fetch_add(1, std::memory_order_relaxed);
+  if (n % every_ != 0) return false;
+
+  if (max_ > 0) {
+    // the first thread past the end of the interval starts the next one
+    uint64_t now = nowNanoseconds();
+    uint64_t start = window_start_.load(std::memory_order_relaxed);
+    if (now - start >= interval_ &&
+        window_start_.compare_exchange_strong(start, now,
+                                              std::memory_order_relaxed)) {
+      window_count_.store(0, std::memory_order_relaxed);
+    }
+
+    if (window_count_.fetch_add(1, std::memory_order_relaxed) >= max_) {
+      return false;
+    }
+  }
+
+  passed_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+std::vector<std::string> RateLimit::GetSummary() {
+  std::vector<std::string> lines;
+  char buf[256];
+
+  for (auto limit = head_.load(std::memory_order_acquire); limit != nullptr;
+       limit = limit->next_) {
+    uint64_t suppressed = limit->GetSuppressed();
+    if (suppressed == 0) continue;
+
+    snprintf(buf, sizeof(buf), "%s: suppressed %lu of %lu", limit->site_,
+             static_cast<unsigned long>(suppressed),
+             static_cast<unsigned long>(limit->GetCount()));
+    lines.push_back(buf);
+  }
+
+  for (auto const& dup : DedupSet::Global().GetDuplicates()) {
+    snprintf(buf, sizeof(buf), "suppressed %lu duplicates of ",
+             static_cast<unsigned long>(dup.second));
+    lines.push_back(buf + ("\"" + dup.first + "\""));
+  }
+
+  return lines;
+}
+
+std::atomic<RateLimit*> RateLimit::head_(nullptr);
+
+DedupSet::~DedupSet() {
+  for (auto& slot : slots_) delete[] slot.text.load();
+}
+
+DedupSet& DedupSet::Global() {
+  static DedupSet set;
+  return set;
+}
+
+uint64_t DedupSet::Hash(std::string_view str, uint64_t seed) {
+  uint64_t hash = seed;
+  for (unsigned char c : str) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+bool DedupSet::Insert(uint64_t hash, std::string_view text) {
+  // zero marks an empty slot
+  if (hash == 0) hash = 1;
+
+  size_t index = hash % kCapacity;
+  for (size_t probe = 0; probe < kCapacity; ++probe) {
+    Slot& slot = slots_[index];
+
+    uint64_t found = slot.hash.load(std::memory_order_acquire);
+    if (found == 0 &&
+        slot.hash.compare_exchange_strong(found, hash,
+                                          std::memory_order_acq_rel)) {
+      char* copy = new char[text.size() + 1];
+      memcpy(copy, text.data(), text.size());
+      copy[text.size()] = '\0';
+      slot.text.store(copy, std::memory_order_release);
+      return true;
+    }
+
+    if (found == hash) {
+      slot.duplicates.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    index = (index + 1) % kCapacity;
+  }
+
+  // full, let the message through
+  return true;
+}
+
+uint64_t DedupSet::GetDuplicates(uint64_t hash) const {
+  if (hash == 0) hash = 1;
+
+  size_t index = hash % kCapacity;
+  for (size_t probe = 0; probe < kCapacity; ++probe) {
+    uint64_t found = slots_[index].hash.load(std::memory_order_acquire);
+    if (found == hash) {
+      return slots_[index].duplicates.load(std::memory_order_relaxed);
+    }
+    if (found == 0) break;
+
+    index = (index + 1) % kCapacity;
+  }
+
+  return 0;
+}
+
+std::vector<std::pair<std::string, uint64_t>> DedupSet::GetDuplicates()
+    const {
+  std::vector<std::pair<std::string, uint64_t>> dups;
+
+  for (auto const& slot : slots_) {
+    uint64_t n = slot.duplicates.load(std::memory_order_relaxed);
+    char const* text = slot.text.load(std::memory_order_acquire);
+    if (n > 0 && text != nullptr) dups.push_back({text, n});
+  }
+
+  return dups;
+}
@@ -0,0 +1,144 @@
+#ifndef SRC_RATE_LIMIT_HPP_
+#define SRC_RATE_LIMIT_HPP_
+
+// C/C++
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Limit on how often a call site writes a record
+/*!
+ * A call site passes every Nth occurrence, and of those at most max per
+ * interval seconds. The counts of suppressed occurrences of all sites are
+ * summarized when the application is destroyed. Use APP_WARN_LIMITED to
+ * declare a limit once per call site:
+ *
+ *   APP_WARN_LIMITED(monitor, 1000, 10, 60., "dt is small: " + str);
+ *
+ * The message is only built if the occurrence passes.
+ */
+class RateLimit {
+ public:
+  /*!
+   * @param site     name of the call site, e.g. "hydro.cpp:42"
+   * @param every    pass occurrences 1, every + 1, 2 * every + 1, ...
+   * @param max      most occurrences passed per interval, 0 for no limit
+   * @param interval length of the interval in seconds
+   */
+  RateLimit(char const* site, uint64_t every, uint64_t max = 0,
+            double interval = 1.);
+
+  RateLimit(RateLimit const&) = delete;
+  RateLimit& operator=(RateLimit const&) = delete;
+
+  //! Count an occurrence and return whether it passes
+  bool Allow();
+
+  char const* GetSite() const { return site_; }
+
+  uint64_t GetCount() const { return count_.load(std::memory_order_relaxed); }
+
+  uint64_t GetSuppressed() const {
+    return GetCount() - passed_.load(std::memory_order_relaxed);
+  }
+
+  //! One line per call site or message with suppressed occurrences
+  /*!
+   * Includes the duplicates held back by DedupSet::Global().
+   */
+  static std::vector<std::string> GetSummary();
+
+ protected:
+  char const* site_;
+  uint64_t every_;
+  uint64_t max_;
+  uint64_t interval_;  //!< nanoseconds
+
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> passed_;
+
+  //! Start of the current interval and occurrences passed within it
+  std::atomic<uint64_t> window_start_;
+  std::atomic<uint64_t> window_count_;
+
+  //! Next limit in the list of all limits
+  RateLimit* next_;
+
+  static std::atomic<RateLimit*> head_;
+};
+
+//! Lock-free set of message hashes for deduplication
+/*!
+ * Insert() returns true for the first occurrence of a message and counts
+ * the duplicates otherwise. The set is an open-addressing table of fixed
+ * capacity that never shrinks. Once it is full, new messages are let
+ * through without being remembered.
+ */
+class DedupSet {
+ public:
+  static const size_t kCapacity = 4096;
+
+  DedupSet() = default;
+
+  ~DedupSet();
+
+  DedupSet(DedupSet const&) = delete;
+  DedupSet& operator=(DedupSet const&) = delete;
+
+  //! Set shared by all monitors of the process
+  static DedupSet& Global();
+
+  //! 64-bit FNV-1a hash, continued from seed
+  static uint64_t Hash(std::string_view str,
+                       uint64_t seed = 14695981039346656037ull);
+
+  //! Record a message given by its hash
+  /*!
+   * @param text message kept for the summary of the first occurrence
+   * @return true for the first occurrence
+   */
+  bool Insert(uint64_t hash, std::string_view text);
+
+  //! Number of duplicates of a message held back so far
+  uint64_t GetDuplicates(uint64_t hash) const;
+
+  //! Messages with duplicates and their number
+  std::vector<std::pair<std::string, uint64_t>> GetDuplicates() const;
+
+ protected:
+  struct Slot {
+    std::atomic<uint64_t> hash{0};
+    std::atomic<uint64_t> duplicates{0};
+    std::atomic<char*> text{nullptr};
+  };
+
+  Slot slots_[kCapacity];
+};
+
+#define APP_STRINGIFY_(x) #x
+#define APP_STRINGIFY(x) APP_STRINGIFY_(x)
+
+//! Warn through monitor if this call site passes its rate limit
+#define APP_WARN_LIMITED(monitor, every, max, interval, msg)            \
+  do {                                                                  \
+    static RateLimit app_rate_limit(__FILE__ ":" APP_STRINGIFY(__LINE__), \
+                                    every, max, interval);              \
+    if (app_rate_limit.Allow()) (monitor)->Warn(msg);                   \
+  } while (0)
+
+//! Warn through monitor the first time this call site is reached
+/*!
+ * Later calls cost a single atomic load and are not counted.
+ */
+#define APP_WARN_ONCE(monitor, msg)                             \
+  do {                                                          \
+    static std::atomic<bool> app_warned(false);                 \
+    if (!app_warned.load(std::memory_order_relaxed) &&          \
+        !app_warned.exchange(true, std::memory_order_relaxed)) { \
+      (monitor)->Warn(msg);                                     \
+    }                                                           \
+  } while (0)
+
+#endif  // SRC_RATE_LIMIT_HPP_
@@ -0,0 +1,215 @@
+// C/C++
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+// POSIX C extensions
+#include <fcntl.h>     // O_CREAT, O_RDWR
+#include <sys/mman.h>  // shm_open(), mmap()
+#include <sys/stat.h>  // fstat()
+#include <unistd.h>    // ftruncate(), close()
+
+// application
+#include "exceptions.hpp"
+#include "shm_ring.hpp"
+
+static const char kMagic[8] = {'A', 'P', 'P', 'R', 'I', 'N', 'G', '1'};
+
+//! Size of the length in front of each record
+static const size_t kLengthSize = sizeof(uint64_t);
+
+static uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+static std::string shmName(std::string const& name) {
+  return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+std::unique_ptr<ShmRing> ShmRing::Create(std::string const& name,
+                                         size_t capacity) {
+  std::unique_ptr<ShmRing> ring(new ShmRing(shmName(name), true));
+
+  size_t pow2 = 4096;
+  while (pow2 < capacity) pow2 *= 2;
+
+  shm_unlink(ring->name_.c_str());
+  int fd = shm_open(ring->name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    throw RuntimeError("ShmRing", "Cannot create shared memory " + ring->name_);
+  }
+
+  ring->size_ = sizeof(Header) + pow2;
+  void* addr = MAP_FAILED;
+  if (ftruncate(fd, ring->size_) == 0) {
+    addr = mmap(nullptr, ring->size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                0);
+  }
+  close(fd);
+
+  if (addr == MAP_FAILED) {
+    shm_unlink(ring->name_.c_str());
+    throw RuntimeError("ShmRing", "Cannot map shared memory " + ring->name_);
+  }
+
+  ring->header_ = new (addr) Header;
+  ring->data_ = static_cast<char*>(addr) + sizeof(Header);
+  ring->capacity_ = pow2;
+
+  ring->header_->capacity = pow2;
+  ring->header_->seq.store(0, std::memory_order_relaxed);
+  ring->header_->head.store(0, std::memory_order_relaxed);
+  ring->header_->tail.store(0, std::memory_order_relaxed);
+
+  // readers check the magic last written
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(ring->header_->magic, kMagic, sizeof(kMagic));
+
+  return ring;
+}
+
+std::unique_ptr<ShmRing> ShmRing::Attach(std::string const& name) {
+  std::unique_ptr<ShmRing> ring(new ShmRing(shmName(name), false));
+
+  int fd = shm_open(ring->name_.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    throw NotFoundError("ShmRing", "shared memory " + ring->name_);
+  }
+
+  struct stat st;
+  void* addr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Header)) {
+    ring->size_ = st.st_size;
+    addr = mmap(nullptr, ring->size_, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+
+  if (addr == MAP_FAILED) {
+    throw RuntimeError("ShmRing", "Cannot map shared memory " + ring->name_);
+  }
+
+  ring->header_ = static_cast<Header*>(addr);
+  ring->data_ = static_cast<char*>(addr) + sizeof(Header);
+  ring->capacity_ = ring->header_->capacity;
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  if (memcmp(ring->header_->magic, kMagic, sizeof(kMagic)) != 0 ||
+      ring->size_ != sizeof(Header) + ring->capacity_) {
+    throw RuntimeError("ShmRing", ring->name_ + " is not a log ring");
+  }
+
+  return ring;
+}
+
+ShmRing::~ShmRing() {
+  if (header_ != nullptr) munmap(header_, size_);
+  if (owner_) shm_unlink(name_.c_str());
+}
+
+void ShmRing::copyOut(uint64_t pos, void* dst, size_t size) const {
+  size_t offset = pos & (capacity_ - 1);
+  size_t first = std::min(size, capacity_ - offset);
+  memcpy(dst, data_ + offset, first);
+  memcpy(static_cast<char*>(dst) + first, data_, size - first);
+}
+
+void ShmRing::copyIn(uint64_t pos, void const* src, size_t size) {
+  size_t offset = pos & (capacity_ - 1);
+  size_t first = std::min(size, capacity_ - offset);
+  memcpy(data_ + offset, src, first);
+  memcpy(data_, static_cast<char const*>(src) + first, size - first);
+}
+
+void ShmRing::Write(struct iovec const* iov, int iovcnt) {
+  uint64_t length = 0;
+  for (int i = 0; i < iovcnt; ++i) length += iov[i].iov_len;
+  length = std::min<uint64_t>(length, capacity_ / 4);
+
+  uint64_t head = header_->head.load(std::memory_order_relaxed);
+  uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+  uint64_t need = kLengthSize + align8(length);
+
+  uint64_t seq = header_->seq.load(std::memory_order_relaxed);
+  header_->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // drop the oldest records, readers see the new tail before their bytes
+  // are overwritten
+  while (head + need - tail > capacity_) {
+    uint64_t old;
+    copyOut(tail, &old, kLengthSize);
+    tail += kLengthSize + align8(old);
+  }
+  header_->tail.store(tail, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  copyIn(head, &length, kLengthSize);
+  uint64_t pos = head + kLengthSize;
+  uint64_t left = length;
+  for (int i = 0; i < iovcnt && left > 0; ++i) {
+    size_t n = std::min<uint64_t>(iov[i].iov_len, left);
+    copyIn(pos, iov[i].iov_base, n);
+    pos += n;
+    left -= n;
+  }
+
+  header_->head.store(head + need, std::memory_order_release);
+  header_->seq.store(seq + 2, std::memory_order_release);
+}
+
+uint64_t ShmRing::Read(uint64_t* pos, std::string* out) const {
+  std::vector<char> copy;
+
+  for (;;) {
+    uint64_t seq = header_->seq.load(std::memory_order_acquire);
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    uint64_t tail = header_->tail.load(std::memory_order_acquire);
+
+    // a position beyond the head belongs to an earlier ring of that name
+    uint64_t start = *pos > head ? tail : std::max(*pos, tail);
+    uint64_t lost = start - std::min(*pos, start);
+
+    copy.resize(head - start);
+    copyOut(start, copy.data(), copy.size());
+
+    // a write was in progress when the copy started (odd seq) or ran
+    // during it: records below its tail may have been overwritten, even if
+    // seq still reads the same odd value. A write in progress leaves the
+    // head, so the rest of the copy is complete
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((seq & 1) || header_->seq.load(std::memory_order_relaxed) != seq) {
+      uint64_t new_tail = header_->tail.load(std::memory_order_relaxed);
+      if (new_tail > head) continue;
+      if (new_tail > start) {
+        lost += new_tail - start;
+        copy.erase(copy.begin(), copy.begin() + (new_tail - start));
+        start = new_tail;
+      }
+    }
+
+    size_t offset = 0;
+    while (offset + kLengthSize <= copy.size()) {
+      uint64_t length;
+      memcpy(&length, copy.data() + offset, kLengthSize);
+      offset += kLengthSize;
+      if (length > copy.size() - offset) break;
+
+      out->append(copy.data() + offset, length);
+      offset += align8(length);
+    }
+
+    *pos = head;
+    return lost;
+  }
+}
+
+ShmDevice::~ShmDevice() { Flush(); }
+
+int64_t ShmDevice::commit(struct iovec const* iov, int iovcnt) {
+  std::unique_lock<std::mutex> lock(ring_mutex_);
+  ring_->Write(iov, iovcnt);
+  return -1;
+}
@@ -0,0 +1,131 @@
+#ifndef SRC_SHM_RING_HPP_
+#define SRC_SHM_RING_HPP_
+
+// C/C++
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// POSIX C extensions
+#include <sys/uio.h>  // iovec
+
+// application
+#include "device.hpp"
+
+//! Ring of records in named POSIX shared memory (/dev/shm)
+/*!
+ * The shared memory holds a 128-byte header followed by the data area of
+ * capacity bytes, a power of two:
+ *
+ *   char     magic[8]   "APPRING1"
+ *   uint64_t capacity   size of the data area
+ *   ...                 padding to 64 bytes
+ *   uint64_t seq        odd while a record is written
+ *   uint64_t head       bytes written since the ring was created
+ *   uint64_t tail       position of the oldest record still in the ring
+ *
+ * Positions grow without wrapping and are taken modulo capacity. A record
+ * is a uint64_t length followed by the data, padded to 8 bytes. The writer
+ * overwrites the oldest records when the ring is full, advancing the tail
+ * before touching their bytes. It never waits for readers, which need not
+ * exist. A reader copies the records it has not seen and then checks seq.
+ * If a write overlapped the copy, the records below the new tail are
+ * dropped as lost. A reader never writes to the shared memory.
+ */
+class ShmRing {
+ public:
+  static const size_t kDefaultCapacity = 1 << 20;
+
+  //! Create ring name, replacing a ring left behind by an earlier run
+  /*!
+   * @param name     shared memory name, "/" is prepended if missing
+   * @param capacity size of the data area, rounded up to a power of two
+   */
+  static std::unique_ptr<ShmRing> Create(std::string const& name,
+                                         size_t capacity = kDefaultCapacity);
+
+  //! Attach to an existing ring for reading
+  static std::unique_ptr<ShmRing> Attach(std::string const& name);
+
+  //! Unmap the ring; the creator also removes its name
+  ~ShmRing();
+
+  //! Append one record given in pieces
+  /*!
+   * Records longer than a quarter of the capacity are truncated. Only one
+   * thread may write at a time.
+   */
+  void Write(struct iovec const* iov, int iovcnt);
+
+  //! Append the data of the records written since *pos to out
+  /*!
+   * Start with *pos = 0 to read every record still in the ring. Records
+   * end where their writer ended them, e.g. with a newline.
+   *
+   * @return bytes of records overwritten before they could be read
+   */
+  uint64_t Read(uint64_t* pos, std::string* out) const;
+
+  std::string const& GetName() const { return name_; }
+
+  size_t GetCapacity() const { return capacity_; }
+
+ protected:
+  struct Header {
+    char magic[8];
+    uint64_t capacity;
+    alignas(64) std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+  };
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "ring positions must be lock-free to be shared");
+
+  ShmRing(std::string const& name, bool owner)
+      : name_(name), owner_(owner) {}
+
+  //! Copy size bytes from position pos of the data area to dst
+  void copyOut(uint64_t pos, void* dst, size_t size) const;
+
+  //! Copy size bytes from src to position pos of the data area
+  void copyIn(uint64_t pos, void const* src, size_t size);
+
+  std::string name_;
+  bool owner_;
+
+  Header* header_ = nullptr;
+  char* data_ = nullptr;
+  size_t capacity_ = 0;
+  size_t size_ = 0;  //!< size of the mapping
+};
+
+//! Device writing every record into a shared-memory ring
+/*!
+ * Monitors write to a ring when their device name starts with "shm:",
+ * e.g. InstallMonitor("hydro", "shm:hydro", "hydro.err"). The ring of rank
+ * r gets the suffix ".r<r>" if there is more than one rank. Writing costs
+ * a memory copy and no system call; the tool logtail shows the records
+ * while the run goes on. The ring is removed when the device is
+ * destroyed.
+ */
+class ShmDevice : public Device {
+ public:
+  explicit ShmDevice(std::string const& name,
+                     size_t capacity = ShmRing::kDefaultCapacity)
+      : ring_(ShmRing::Create(name, capacity)) {}
+
+  ~ShmDevice();
+
+  ShmRing const* GetRing() const { return ring_.get(); }
+
+ protected:
+  int64_t commit(struct iovec const* iov, int iovcnt) override;
+
+  std::unique_ptr<ShmRing> ring_;
+  std::mutex ring_mutex_;
+};
+
+#endif  // SRC_SHM_RING_HPP_
@@ -1,6 +1,8 @@
 // C/C++
 // first 2x macros and signal() are the only ISO C features; rest are POSIX C extensions
+#include <algorithm>
 #include <csignal>    // SIGTERM, SIGINT, SIGALARM, signal(), sigemptyset(), ...
+#include <cstring>    // memset()
 #include <iostream>
 #include <unistd.h>   // alarm() Unix OS utility; not in C standard --> no <cunistd>
 #include <memory>
@@ -16,6 +18,36 @@
 
 static std::mutex sig_mutex;
 
+//! Fatal signals passed to the fatal handler
+static const int fatal_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGABRT};
+
+static void (*fatal_handler)(int) = nullptr;
+
+static void (*control_handler)() = nullptr;
+
+//! Signals of the control handler and their actions before it was set
+static const int control_signals[] = {SIGHUP, SIGUSR1};
+static struct sigaction control_saved[2];
+static bool control_set = false;
+
+static void (*step_handler)() = nullptr;
+
+//! Alternate stack for handlers of fatal signals
+static char fatal_stack[64 * 1024];
+
+static void onFatalSignal(int s) {
+  if (fatal_handler != nullptr) fatal_handler(s);
+
+  // the handler was reset to the default action, which ends the process
+  raise(s);
+}
+
+#ifdef MPI_PARALLEL
+//! Global stop word on world rank 0 shared by all ensemble members
+static MPI_Win stop_win = MPI_WIN_NULL;
+static int stop_flags[Signal::NSIGNAL];
+#endif
+
 Signal* Signal::GetInstance() {
   // RAII
   std::unique_lock<std::mutex> lock(sig_mutex);
@@ -60,13 +92,40 @@ int Signal::CheckSignalFlags() {
   int ret = 0;
   sigprocmask(SIG_BLOCK, &mask_, nullptr);
 #ifdef MPI_PARALLEL
+  if (stop_win != MPI_WIN_NULL && Globals::member_rank == 0) {
+    int global[NSIGNAL];
+    MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, stop_win);
+    MPI_Get_accumulate(signalflag_, NSIGNAL, MPI_INT, global, NSIGNAL, MPI_INT,
+                       0, 0, NSIGNAL, MPI_INT, MPI_MAX, stop_win);
+    MPI_Win_unlock(0, stop_win);
+    for (int n=0; n<NSIGNAL; n++)
+      signalflag_[n] = std::max(signalflag_[n], global[n]);
+  }
   MPI_Allreduce(MPI_IN_PLACE,
                 const_cast<void *>(reinterpret_cast<volatile void *>(signalflag_)),
-                NSIGNAL, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+                NSIGNAL, MPI_INT, MPI_MAX, Globals::member_comm);
 #endif
   for (int n=0; n<NSIGNAL; n++)
     ret += signalflag_[n];
+#ifdef MPI_PARALLEL
+  // publish a stop raised on another rank of this member to all members
+  if (stop_win != MPI_WIN_NULL && Globals::member_rank == 0 && ret > 0) {
+    MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, stop_win);
+    MPI_Accumulate(signalflag_, NSIGNAL, MPI_INT, 0, 0, NSIGNAL, MPI_INT,
+                   MPI_MAX, stop_win);
+    MPI_Win_unlock(0, stop_win);
+  }
+#endif
   sigprocmask(SIG_UNBLOCK, &mask_, nullptr);
+
+  // reconfigure between time steps, outside of the signal handler
+  if (controlflag_ != 0) {
+    controlflag_ = 0;
+    if (control_handler != nullptr) control_handler();
+  }
+
+  if (step_handler != nullptr) step_handler();
+
   return ret;
 }
 
@@ -111,6 +170,85 @@ void Signal::SetSignalFlag(int s) {
   return;
 }
 
+void Signal::setControlFlag(int) { controlflag_ = 1; }
+
+void Signal::SetControlHandler(void (*handler)()) {
+  std::unique_lock<std::mutex> lock(sig_mutex);
+
+  control_handler = handler;
+
+  if (handler == nullptr) {
+    if (!control_set) return;
+    for (int i = 0; i < 2; ++i) {
+      sigaction(control_signals[i], &control_saved[i], nullptr);
+    }
+    control_set = false;
+    return;
+  }
+
+  if (control_set) return;
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = setControlFlag;
+  action.sa_flags = SA_RESTART;
+
+  for (int i = 0; i < 2; ++i) {
+    sigaction(control_signals[i], &action, &control_saved[i]);
+  }
+  control_set = true;
+}
+
+void Signal::SetStepHandler(void (*handler)()) {
+  std::unique_lock<std::mutex> lock(sig_mutex);
+  step_handler = handler;
+}
+
+void Signal::ConnectMembers() {
+#ifdef MPI_PARALLEL
+  if (Globals::nmembers <= 1) return;
+
+  for (int n=0; n<NSIGNAL; n++)
+    stop_flags[n] = 0;
+  MPI_Win_create(stop_flags, Globals::my_rank == 0 ? sizeof(stop_flags) : 0,
+                 sizeof(int), MPI_INFO_NULL, MPI_COMM_WORLD, &stop_win);
+#endif
+}
+
+void Signal::DisconnectMembers() {
+#ifdef MPI_PARALLEL
+  if (stop_win != MPI_WIN_NULL) {
+    MPI_Win_free(&stop_win);
+  }
+#endif
+}
+
+void Signal::CatchFatalSignals(void (*handler)(int)) {
+  std::unique_lock<std::mutex> lock(sig_mutex);
+
+  fatal_handler = handler;
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+
+  if (handler == nullptr) {
+    action.sa_handler = SIG_DFL;
+  } else {
+    stack_t stack;
+    stack.ss_sp = fatal_stack;
+    stack.ss_size = sizeof(fatal_stack);
+    stack.ss_flags = 0;
+    sigaltstack(&stack, nullptr);
+
+    action.sa_handler = onFatalSignal;
+    action.sa_flags = SA_ONSTACK | SA_RESETHAND;
+  }
+
+  for (auto s : fatal_signals) sigaction(s, &action, nullptr);
+}
+
 void Signal::SetWallTimeAlarm(int t) {
   alarm(t);
   return;
@@ -122,4 +260,5 @@ void Signal::CancelWallTimeAlarm() {
 }
 
 int Signal::signalflag_[Signal::NSIGNAL];
+volatile sig_atomic_t Signal::controlflag_ = 0;
 Signal* Signal::mysig_ = nullptr;
@@ -21,13 +21,56 @@ public:
   static void Destroy();
   static void SetSignalFlag(int s);
 
+  //! Reduce signal flags over the ranks of this ensemble member
+  /*!
+   * With more than one ensemble member, member rank 0 also exchanges the
+   * flags with a global stop word on world rank 0, so that a stop seen by
+   * any member reaches every member within one more check.
+   *
+   * @return sum of the flags set
+   */
   int CheckSignalFlags();
   int GetSignalFlag(int s);
   void SetWallTimeAlarm(int t);
   void CancelWallTimeAlarm();
 
+  //! Call handler on SIGSEGV, SIGBUS, SIGFPE and SIGABRT
+  /*!
+   * On the calling thread the handler runs on an alternate signal stack,
+   * so that it also runs after a stack overflow. It must be
+   * async-signal-safe. The default action of the signal follows. A
+   * nullptr handler restores the default actions.
+   */
+  static void CatchFatalSignals(void (*handler)(int));
+
+  //! Call handler at the next CheckSignalFlags after SIGHUP or SIGUSR1
+  /*!
+   * The signals only set a flag. The handler runs later on the thread
+   * calling CheckSignalFlags, which is the safe point of a time step. A
+   * nullptr handler restores the actions the signals had before the first
+   * handler was set.
+   */
+  static void SetControlHandler(void (*handler)());
+
+  //! Call handler at the end of every CheckSignalFlags
+  /*!
+   * All ranks of the member call CheckSignalFlags at the same step, so the
+   * handler may be collective over the member. nullptr removes it.
+   */
+  static void SetStepHandler(void (*handler)());
+
+  //! Collectively create the global stop word shared by ensemble members
+  void ConnectMembers();
+
+  //! Collectively release the global stop word
+  void DisconnectMembers();
+
 protected:
+  //! Set on SIGHUP and SIGUSR1
+  static void setControlFlag(int);
+
   static int signalflag_[NSIGNAL];
+  static volatile sig_atomic_t controlflag_;
   sigset_t mask_;
 
 private:
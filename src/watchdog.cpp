@@ -0,0 +1,249 @@
+// C/C++
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// POSIX C extensions
+#include <dirent.h>       // opendir()
+#include <execinfo.h>     // backtrace()
+#include <fcntl.h>        // open()
+#include <sys/syscall.h>  // SYS_gettid, SYS_tgkill
+#include <unistd.h>       // write(), syscall()
+
+// application
+#include "application.hpp"
+#include "flight_recorder.hpp"
+#include "globals.hpp"
+#include "watchdog.hpp"
+
+#ifdef MPI_PARALLEL
+#include <mpi.h>
+#endif
+
+static std::mutex dog_mutex;
+
+//! Maximum number of frames of a backtrace
+static const int kMaxFrames = 64;
+
+//! Backtrace requested from a thread
+/*!
+ * The upper half holds the sequence number of the request, the lower half
+ * the file descriptor plus one, or 0 once the request is taken by the
+ * thread or withdrawn after the timeout. A late answer to an earlier
+ * request finds another sequence number and writes nothing.
+ */
+static std::atomic<uint64_t> backtrace_request(0);
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "backtrace_request is used in a signal handler");
+
+//! Sequence number of the last backtrace written
+static std::atomic<uint32_t> backtrace_done(0);
+static uint32_t backtrace_seq = 0;
+static std::mutex backtrace_mutex;
+
+//! Signal asking a thread for its backtrace
+static int backtraceSignal() { return SIGRTMIN + 2; }
+
+static void onBacktraceSignal(int, siginfo_t* info, void*) {
+  int saved_errno = errno;
+
+  uint64_t seq = static_cast<uint32_t>(info->si_value.sival_int);
+  uint64_t request = backtrace_request.load();
+  if ((request >> 32) == seq && (request & 0xffffffffu) != 0 &&
+      backtrace_request.compare_exchange_strong(request, seq << 32)) {
+    int fd = static_cast<int>(request & 0xffffffffu) - 1;
+
+    void* frames[kMaxFrames];
+    int n = backtrace(frames, kMaxFrames);
+    backtrace_symbols_fd(frames, n, fd);
+    backtrace_done.store(seq, std::memory_order_release);
+  }
+
+  errno = saved_errno;
+}
+
+//! Ask thread tid for its backtrace to fd, false if it did not answer
+static bool requestBacktrace(pid_t pid, pid_t tid, int fd) {
+  uint64_t seq = ++backtrace_seq;
+  uint64_t request = (seq << 32) | static_cast<uint32_t>(fd + 1);
+  backtrace_request.store(request);
+
+  siginfo_t info;
+  memset(&info, 0, sizeof(info));
+  info.si_signo = backtraceSignal();
+  info.si_code = SI_QUEUE;
+  info.si_pid = pid;
+  info.si_uid = getuid();
+  info.si_value.sival_int = static_cast<int>(seq);
+  if (syscall(SYS_rt_tgsigqueueinfo, pid, tid, backtraceSignal(), &info) !=
+      0) {
+    backtrace_request.store(0);
+    return false;
+  }
+
+  // a thread blocking the signal does not answer
+  for (int i = 0; i < 1000; ++i) {
+    if (backtrace_done.load(std::memory_order_acquire) == seq) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // withdraw the request, or wait for the thread that took it
+  if (backtrace_request.compare_exchange_strong(request, 0)) return false;
+  while (backtrace_done.load(std::memory_order_acquire) != seq) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+//! Write the backtraces of all other threads to fd
+static void dumpBacktraces(int fd) {
+  std::unique_lock<std::mutex> lock(backtrace_mutex);
+
+  DIR* dir = opendir("/proc/self/task");
+  if (dir == nullptr) return;
+
+  pid_t pid = getpid();
+  pid_t self = syscall(SYS_gettid);
+
+  while (auto entry = readdir(dir)) {
+    pid_t tid = atoi(entry->d_name);
+    if (tid <= 0 || tid == self) continue;
+
+    char header[64];
+    int len = snprintf(header, sizeof(header), "# backtrace of thread %d\n",
+                       static_cast<int>(tid));
+    if (write(fd, header, len) < 0) break;
+
+    requestBacktrace(pid, tid, fd);
+  }
+
+  closedir(dir);
+}
+
+Watchdog* Watchdog::GetInstance() {
+  // RAII
+  std::unique_lock<std::mutex> lock(dog_mutex);
+
+  if (Watchdog::mydog_ == nullptr) {
+    Watchdog::mydog_ = new Watchdog();
+  }
+
+  return mydog_;
+}
+
+void Watchdog::Destroy() {
+  std::unique_lock<std::mutex> lock(dog_mutex);
+
+  if (Watchdog::mydog_ != nullptr) {
+    delete Watchdog::mydog_;
+    Watchdog::mydog_ = nullptr;
+  }
+}
+
+void Watchdog::Start(double timeout, bool abort, std::string const& fname) {
+  Stop();
+
+  timeout_ = timeout;
+  abort_ = abort;
+  fname_ = Application::GetRankFileName(fname);
+  stop_ = false;
+
+  // load the unwinder now, backtrace() may allocate on its first call
+  void* frames[kMaxFrames];
+  backtrace(frames, kMaxFrames);
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_sigaction = onBacktraceSignal;
+  action.sa_flags = SA_RESTART | SA_SIGINFO;
+  sigaction(backtraceSignal(), &action, nullptr);
+
+  running_.store(true);
+
+  thread_ = std::thread([this]() {
+    using clock = std::chrono::steady_clock;
+
+    // check a few times per timeout
+    auto period = std::chrono::duration<double>(timeout_ / 4.);
+
+    uint64_t last = progress_.load(std::memory_order_relaxed);
+    auto since = clock::now();
+    bool reported = false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!cv_.wait_for(lock, period, [this]() { return stop_; })) {
+      uint64_t progress = progress_.load(std::memory_order_relaxed);
+      auto now = clock::now();
+
+      if (progress != last) {
+        last = progress;
+        since = now;
+        reported = false;
+        continue;
+      }
+
+      double stalled = std::chrono::duration<double>(now - since).count();
+      if (stalled < timeout_ || reported) continue;
+
+      Dump(stalled);
+      reported = true;
+
+      if (abort_) {
+#ifdef MPI_PARALLEL
+        MPI_Abort(MPI_COMM_WORLD, 1);
+#endif
+        std::abort();
+      }
+    }
+  });
+}
+
+void Watchdog::Stop() {
+  if (!thread_.joinable()) return;
+
+  running_.store(false);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+
+  thread_.join();
+}
+
+void Watchdog::Dump(double stalled) {
+  int fd = open(fname_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) return;
+
+  char buf[160];
+  snprintf(buf, sizeof(buf),
+           "# Watchdog: no progress for %.1f s on rank %d\n"
+           "# section stacks\n",
+           stalled, Globals::my_rank);
+  std::string report = buf;
+
+  // the default context outlives the watchdog, see Application::Destroy
+  report += Application::GetInstance()->GetSectionStacks();
+
+  if (FlightRecorder::IsEnabled()) {
+    report += "# flight recorder dumped\n";
+  }
+
+  if (write(fd, report.data(), report.size()) >= 0) dumpBacktraces(fd);
+  close(fd);
+
+  if (FlightRecorder::IsEnabled()) FlightRecorder::Dump("Watchdog");
+}
+
+std::atomic<bool> Watchdog::running_(false);
+std::atomic<uint64_t> Watchdog::progress_(0);
+Watchdog* Watchdog::mydog_ = nullptr;
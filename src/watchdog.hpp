@@ -0,0 +1,84 @@
+#ifndef SRC_WATCHDOG_HPP_
+#define SRC_WATCHDOG_HPP_
+
+// C/C++
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//! Detector of a rank that stopped making progress
+/*!
+ * Monitor::Enter and Monitor::Leave, i.e. every Application::Logger
+ * scope, and explicit calls of Tick() count as progress. If there is no
+ * progress for timeout seconds, a background thread writes to a per-rank
+ * file (hang.log, hang.r0003.log for rank 3 of several):
+ *
+ *   - the section stack of each thread of the default context,
+ *     e.g. "main > hydro > riemann"
+ *   - a backtrace of every thread of the process
+ *
+ * and dumps the flight recorder if it is enabled. With abort, the job is
+ * then aborted (MPI_Abort with MPI) so that a hung rank does not hold the
+ * allocation until the wall-time limit. Otherwise the watchdog reports
+ * again after the next progress and timeout.
+ *
+ * Application::Start starts the watchdog with -w <seconds>, or with
+ * -W <seconds> to abort.
+ */
+class Watchdog {
+ protected:
+  Watchdog() {}
+
+ public:
+  static Watchdog* GetInstance();
+  static void Destroy();
+
+  ~Watchdog() { Stop(); }
+
+  //! Report progress, a relaxed load and store
+  static void Tick() {
+    progress_.store(progress_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+  }
+
+  static bool IsRunning() { return running_.load(std::memory_order_relaxed); }
+
+  //! Start watching; a running watchdog is stopped first
+  /*!
+   * @param timeout seconds without progress that count as a hang
+   * @param abort   abort the job after the report
+   * @param fname   report file, suffixed with the rank
+   */
+  void Start(double timeout, bool abort = false,
+             std::string const& fname = "hang.log");
+
+  void Stop();
+
+  //! Append the report to the report file now
+  /*!
+   * @param stalled seconds without progress, for the header
+   */
+  void Dump(double stalled);
+
+ protected:
+  static std::atomic<bool> running_;
+  static std::atomic<uint64_t> progress_;
+
+  double timeout_ = 0.;
+  bool abort_ = false;
+  std::string fname_;
+
+  std::thread thread_;
+  bool stop_ = false;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+ private:
+  //! Pointer to the single Watchdog instance
+  static Watchdog* mydog_;
+};
+
+#endif  // SRC_WATCHDOG_HPP_
@@ -0,0 +1,84 @@
+// C/C++
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// application
+#include <application/application.hpp>
+
+void func2() {
+  Application::Logger app(APP_MONITOR("B"));
+
+  app->Log("First step");
+  app->Log("Second step");
+}
+
+void func1() {
+  Application::Logger app("A");
+
+  app->Log("First step");
+  app->Log("Second step");
+
+  func2();
+}
+
+void run_case(Application* ctx, int id) {
+  Application::Scope scope(ctx);
+
+  std::string fname = "context" + std::to_string(id) + ".out";
+  ctx->InstallMonitor("A", fname, "stderr");
+  ctx->InstallMonitor("B", fname, "stderr");
+
+  for (int n = 0; n < 100; ++n) func1();
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  int ncases = 4;
+  std::vector<Application*> contexts;
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < ncases; ++i) contexts.push_back(new Application());
+
+  for (int i = 0; i < ncases; ++i)
+    threads.emplace_back(run_case, contexts[i], i);
+
+  for (auto& t : threads) t.join();
+
+  // the section counters of exited threads are released
+  int status = 0;
+  for (int i = 0; i < ncases; ++i) {
+    std::string stacks = contexts[i]->GetSectionStacks();
+    if (!stacks.empty()) {
+      std::cerr << "context " << i << " keeps exited threads:" << std::endl
+                << stacks;
+      status = 1;
+    }
+  }
+
+  for (auto ctx : contexts) delete ctx;
+
+  // each context numbers its sections independently
+  for (int i = 0; i < ncases; ++i) {
+    std::ifstream fin("context" + std::to_string(i) + ".out");
+    std::string line, last;
+    int nlines = 0;
+    while (std::getline(fin, line)) {
+      last = line;
+      nlines++;
+    }
+
+    if (nlines != 402 || last.find(", 101.2.2., ") == std::string::npos) {
+      std::cerr << "context " << i << ": " << nlines << " lines, last line "
+                << last << std::endl;
+      status = 1;
+    }
+  }
+
+  Application::Destroy();
+
+  return status;
+}
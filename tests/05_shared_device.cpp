@@ -0,0 +1,124 @@
+// C/C++
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX C extensions
+#include <sys/stat.h>  // stat()
+#include <unistd.h>    // access()
+
+// application
+#include <application/application.hpp>
+
+void work(int id, int nrecords) {
+  auto app = Application::GetInstance();
+  auto monitor = app->GetMonitor(id % 2 ? "A" : "B");
+
+  std::string payload(id * 10 + 1, 'a' + id);
+  for (int i = 0; i < nrecords; ++i) monitor->Log(payload);
+}
+
+int check(std::string const& fname, int nthreads, int nrecords) {
+  std::ifstream fin(fname);
+  std::string line;
+  std::vector<int> count(nthreads, 0);
+  int nbad = 0;
+
+  while (std::getline(fin, line)) {
+    if (line.find("Installing monitor") != std::string::npos) continue;
+
+    // a whole record ends with the payload of one thread in quotes
+    auto first = line.find('"', line.find(", ", line.rfind("., ")));
+    auto last = line.rfind('"');
+    std::string payload = line.substr(first + 1, last - first - 1);
+    int id = payload.size() / 10;
+
+    if (line.compare(0, 5, "Log, ") != 0 || id >= nthreads ||
+        payload != std::string(id * 10 + 1, 'a' + id)) {
+      nbad++;
+    } else {
+      count[id]++;
+    }
+  }
+
+  int status = nbad > 0;
+  for (int id = 0; id < nthreads; ++id) {
+    if (count[id] != nrecords) status = 1;
+  }
+
+  if (status) {
+    std::cerr << fname << ": " << nbad << " torn records" << std::endl;
+  }
+
+  return status;
+}
+
+int run(std::string const& fname, FlushPolicy const& policy) {
+  int nthreads = 8, nrecords = 5000;
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("A", fname, "stderr");
+  app->InstallMonitor("B", fname, "stderr");
+  app->GetDevice(fname)->SetFlushPolicy(policy);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < nthreads; ++i) threads.emplace_back(work, i, nrecords);
+  for (auto& t : threads) t.join();
+
+  app->GetDevice(fname)->Flush();
+
+  return check(fname, nthreads, nrecords);
+}
+
+//! Records of a thread that exits are committed without a Flush
+int checkStale(std::string const& fname) {
+  auto app = Application::GetInstance();
+  app->InstallMonitor("C", fname, "stderr");
+  app->GetDevice(fname)->SetFlushPolicy(FlushPolicy::PerBytes(1 << 20));
+
+  struct stat st;
+  stat(fname.c_str(), &st);
+  auto before = st.st_size;
+
+  std::thread([app]() { app->GetMonitor("C")->Log("stale"); }).join();
+
+  Device::StartFlusher(0.01);
+  for (int i = 0; i < 200 && st.st_size == before; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    stat(fname.c_str(), &st);
+  }
+
+  if (st.st_size == before) {
+    std::cerr << fname << ": buffer of an exited thread not committed"
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  int status = 0;
+  status |= run("shared_record.out", FlushPolicy::PerRecord());
+  status |= run("shared_bytes.out", FlushPolicy::PerBytes(4096));
+  status |= run("shared_interval.out", FlushPolicy::PerInterval(0.001));
+  status |= checkStale("shared_stale.out");
+
+  // failed writes are queued as errors of the device
+  if (access("/dev/full", W_OK) == 0) {
+    FileDevice full("/dev/full");
+    full.Write("lost\n");
+    if (!full.HasErrors() || full.TakeErrors().empty()) {
+      std::cerr << "Failed write not reported" << std::endl;
+      status = 1;
+    }
+  }
+
+  Application::Destroy();
+
+  return status;
+}
@@ -0,0 +1,96 @@
+// C/C++
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// application
+#include <application/application.hpp>
+
+// reference formatting of the original implementation
+template <typename T>
+std::string reference(std::string const& msg, std::vector<T> const& a) {
+  std::ostringstream ss;
+  ss << "\"" << msg << " = ";
+  for (auto v : a) ss << v << " ";
+  ss << "\"";
+  return ss.str();
+}
+
+std::vector<std::string> read_lines(std::string const& fname) {
+  std::ifstream fin(fname);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(fin, line)) lines.push_back(line);
+  return lines;
+}
+
+bool ends_with(std::string const& str, std::string const& tail) {
+  return str.size() >= tail.size() &&
+         str.compare(str.size() - tail.size(), tail.size(), tail) == 0;
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("array", "array.out", "array.err");
+  auto monitor = app->GetMonitor("array");
+
+  std::vector<double> dvalues = {0.1, 1. / 3., -2.5e-12, 1e20, 123456789., 0.};
+  std::vector<float> fvalues = {0.1f, 3.f, -7.25f};
+  std::vector<int64_t> ivalues = {0, -1, 9223372036854775807LL};
+
+  monitor->Log("double", dvalues);
+  monitor->Log("float", fvalues.data(), fvalues.size());
+  monitor->Log("int64", ivalues);
+
+  // large arrays go to the sidecar
+  std::vector<double> field(3 * 1000);
+  for (size_t i = 0; i < field.size(); ++i) field[i] = 0.5 * i;
+
+  monitor->SetSidecar("array.bin", 1000);
+  monitor->Log("small", dvalues);
+  monitor->Log("field", field.data(), {3, 1000});
+  monitor->Log("again", field);
+
+  app->GetDevice("array.out")->Flush();
+
+  int status = 0;
+  auto lines = read_lines("array.out");
+  if (lines.size() != 7 ||
+      !ends_with(lines[1], reference("double", dvalues)) ||
+      !ends_with(lines[2], reference("float", fvalues)) ||
+      !ends_with(lines[3], reference("int64", ivalues)) ||
+      !ends_with(lines[4], reference("small", dvalues)) ||
+      !ends_with(lines[5], "\"field = @array.bin:0 float64[3,1000]\"") ||
+      !ends_with(lines[6], "\"again = @array.bin:24064 float64[3000]\"")) {
+    std::cerr << "Unexpected text output in array.out" << std::endl;
+    status = 1;
+  }
+
+  // read back the second array from the sidecar
+  std::ifstream fin("array.bin", std::ios::binary);
+  fin.seekg(24064);
+
+  char header[64];
+  std::vector<double> data(field.size());
+  fin.read(header, sizeof(header));
+  fin.read(reinterpret_cast<char *>(data.data()), data.size() * sizeof(double));
+
+  uint64_t nbytes;
+  std::memcpy(&nbytes, header + 56, sizeof(nbytes));
+  if (!fin || std::memcmp(header, "APPARRAY", 8) != 0 ||
+      std::strncmp(header + 8, "float64", 8) != 0 ||
+      nbytes != field.size() * sizeof(double) || data != field) {
+    std::cerr << "Unexpected binary output in array.bin" << std::endl;
+    status = 1;
+  }
+
+  Application::Destroy();
+
+  return status;
+}
@@ -0,0 +1,97 @@
+// C/C++
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+// application
+#include <application/application.hpp>
+
+template <typename T>
+std::vector<T> make_field(size_t n) {
+  std::vector<T> a(n);
+  for (size_t i = 0; i < n; ++i) a[i] = std::sin(0.01 * i);
+
+  a[5] = std::numeric_limits<T>::quiet_NaN();
+  a[17] = std::numeric_limits<T>::infinity();
+  a[18] = -std::numeric_limits<T>::infinity();
+  a[n - 2] = 2.5;
+  a[n / 2] = -1.5;
+  return a;
+}
+
+bool close(double a, double b) {
+  return std::abs(a - b) <= 1e-9 * std::max(1., std::abs(b));
+}
+
+template <typename T>
+int compare(size_t n) {
+  auto a = make_field<T>(n);
+  auto ref = CheckArray(a.data(), n, -1., 1., CheckISA::kScalar);
+
+  // expected from the construction of the field
+  int status = 0;
+  if (ref.nnan != 1 || ref.ninf != 2 || ref.nout != 2 || ref.nfirst != 5 ||
+      ref.first[0] != 5 || ref.first[4] != n - 2 || ref.max != 2.5 ||
+      ref.min != -1.5) {
+    std::cerr << "Scalar check of " << n << " elements is wrong" << std::endl;
+    status = 1;
+  }
+
+  for (auto isa : {CheckISA::kAVX2, CheckISA::kAVX512}) {
+    auto stats = CheckArray(a.data(), n, -1., 1., isa);
+
+    bool same = stats.nnan == ref.nnan && stats.ninf == ref.ninf &&
+                stats.nout == ref.nout && stats.nfirst == ref.nfirst &&
+                stats.min == ref.min && stats.max == ref.max &&
+                close(stats.mean, ref.mean) && close(stats.l2, ref.l2);
+    for (int i = 0; same && i < ref.nfirst; ++i)
+      same = stats.first[i] == ref.first[i];
+
+    if (!same) {
+      std::cerr << GetCheckISAName(isa) << " check of " << n
+                << " elements differs from scalar" << std::endl;
+      status = 1;
+    }
+  }
+
+  return status;
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("check", "check.out", "check.out");
+  auto monitor = app->GetMonitor("check");
+
+  int status = 0;
+  for (size_t n : {64, 1003, 100000}) {
+    status |= compare<float>(n);
+    status |= compare<double>(n);
+  }
+
+  // a float just above the bound is out of range
+  std::vector<float> edge = {0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.8f};
+  for (auto isa : {CheckISA::kScalar, CheckISA::kAVX2, CheckISA::kAVX512}) {
+    auto stats = CheckArray(edge.data(), edge.size(), 0.1, 0.8, isa);
+    if (stats.nout != 1 || stats.first[0] != 7) {
+      std::cerr << GetCheckISAName(isa) << " float bounds are wrong"
+                << std::endl;
+      status = 1;
+    }
+  }
+
+  // reports through the monitor
+  auto field = make_field<double>(1000);
+  if (monitor->Check("field", field, -1., 1.).IsValid()) status = 1;
+  if (!monitor->Check("dt", 0.5, 0., 1.)) status = 1;
+  if (monitor->Check("dt", -0.5, 0., 1.)) status = 1;
+
+  std::cout << "Array checks use " << GetCheckISAName(GetCheckISA())
+            << std::endl;
+
+  Application::Destroy();
+
+  return status;
+}
@@ -0,0 +1,96 @@
+// C/C++
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// application
+#include <application/application.hpp>
+#include <application/exceptions.hpp>
+
+bool contains(std::string const& str, std::string const& line) {
+  if (str.find(line) != std::string::npos) return true;
+  std::cerr << "Missing '" << line << "' in" << std::endl << str;
+  return false;
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto metrics = Application::GetInstance()->GetMetrics();
+
+  auto cells = metrics->GetCounter("cells_updated", "Cells updated");
+  auto dt = metrics->GetGauge("time_step");
+  auto latency = metrics->GetHistogram("step_seconds", {0.5, 1., 2.});
+
+  metrics->StartExporter("metrics.prom", 0.01);
+
+  // threads record concurrently
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 100000; ++i) {
+        cells->Add(2);
+        dt->Add(0.25);
+        latency->Observe(i % 4 * 0.5);
+      }
+    });
+  }
+  for (auto &th : threads) th.join();
+
+  // registering again returns the same metric
+  int status = 0;
+  if (metrics->GetCounter("cells_updated") != cells) status = 1;
+
+  if (cells->Value() != 1600000 || dt->Value() != 200000.) {
+    std::cerr << "Wrong counter or gauge" << std::endl;
+    status = 1;
+  }
+
+  auto prom = metrics->Snapshot();
+  if (!contains(prom, "# HELP cells_updated Cells updated\n") ||
+      !contains(prom, "# TYPE cells_updated counter\n") ||
+      !contains(prom, "cells_updated{rank=\"0\",member=\"0\"} 1600000\n") ||
+      !contains(prom, "time_step{rank=\"0\",member=\"0\"} 200000\n") ||
+      !contains(prom,
+                "step_seconds_bucket{rank=\"0\",member=\"0\",le=\"0.5\"} "
+                "400000\n") ||
+      !contains(prom,
+                "step_seconds_bucket{rank=\"0\",member=\"0\",le=\"+Inf\"} "
+                "800000\n") ||
+      !contains(prom, "step_seconds_sum{rank=\"0\",member=\"0\"} 600000\n")) {
+    status = 1;
+  }
+
+  auto json = metrics->Snapshot(Metrics::kJSON);
+  if (!contains(json, "\"counters\": {\"cells_updated\": 1600000}") ||
+      !contains(json, "\"step_seconds\": {\"bounds\": [0.5, 1, 2], "
+                      "\"counts\": [400000, 200000, 200000, 0], "
+                      "\"sum\": 600000, \"count\": 800000}")) {
+    status = 1;
+  }
+
+  // the final snapshot of the exporter is complete
+  metrics->StopExporter();
+
+  std::ifstream fin("metrics.prom");
+  std::stringstream ss;
+  ss << fin.rdbuf();
+  if (ss.str() != prom) {
+    std::cerr << "Exported snapshot differs" << std::endl;
+    status = 1;
+  }
+
+  try {
+    metrics->GetCounter("bad name");
+    status = 1;
+  } catch (RuntimeError const &) {
+  }
+
+  Application::Destroy();
+
+  return status;
+}
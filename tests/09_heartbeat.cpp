@@ -0,0 +1,57 @@
+// C/C++
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// application
+#include <application/application.hpp>
+#include <application/heartbeat.hpp>
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("beat", "heartbeat.out", "heartbeat.out");
+
+  auto beat = Heartbeat::GetInstance();
+  Heartbeat::SetTotal(100);
+  beat->Start(0.02, app->GetMonitor("beat"), 3600);
+
+  for (int step = 1; step <= 100; ++step) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    Heartbeat::SetProgress(step);
+  }
+
+  beat->Stop();
+
+  int status = 0;
+  if (Heartbeat::FormatDuration(3725.2) != "01:02:05") status = 1;
+  if (Heartbeat::GetRSS() == 0) status = 1;
+
+  // a rate and an ETA are given from the second heartbeat on
+  std::ifstream fin("heartbeat.out");
+  std::string line;
+  int nbeats = 0, neta = 0;
+  while (std::getline(fin, line)) {
+    if (line.find("Heartbeat = step ") == std::string::npos) continue;
+    nbeats++;
+    if (line.find("/100 (") == std::string::npos ||
+        line.find(", wall left ") == std::string::npos) {
+      std::cerr << "Incomplete heartbeat: " << line << std::endl;
+      status = 1;
+    }
+    if (line.find(" steps/s, ETA ") != std::string::npos) neta++;
+  }
+
+  if (nbeats < 2 || neta < 1) {
+    std::cerr << nbeats << " heartbeats, " << neta << " with ETA"
+              << std::endl;
+    status = 1;
+  }
+
+  Application::Destroy();
+
+  return status;
+}
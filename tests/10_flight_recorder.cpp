@@ -0,0 +1,148 @@
+// C/C++
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// POSIX C extensions
+#include <sys/wait.h>  // waitpid()
+#include <unistd.h>    // fork()
+
+// application
+#include <application/application.hpp>
+#include <application/flight_recorder.hpp>
+
+std::string read_file(std::string const &fname) {
+  std::ifstream fin(fname);
+  std::stringstream ss;
+  ss << fin.rdbuf();
+  return ss.str();
+}
+
+void func(Monitor *monitor, int thread) {
+  Application::Logger app("recorder");
+  for (int i = 0; i < 20; ++i) {
+    monitor->Log("thread " + std::to_string(thread) + " record " +
+                 std::to_string(i));
+  }
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("recorder", "recorder.out", "recorder.out");
+
+  // file output only has warnings, the recorder keeps everything
+  auto monitor = app->GetMonitor("recorder");
+  monitor->SetLevel(Monitor::kWarn);
+
+  FlightRecorder::Enable(8, "flight.log");
+
+  std::thread t1(func, monitor, 1), t2(func, monitor, 2);
+  t1.join();
+  t2.join();
+
+  monitor->Debug("debug detail");
+  monitor->Error("boom");
+  monitor->Flush();
+
+  int status = 0;
+
+  auto dump = read_file("flight.log");
+  auto out = read_file("recorder.out");
+
+  if (dump.find("# Flight recorder dump on Error") == std::string::npos ||
+      dump.find("thread 1 record 19") == std::string::npos ||
+      dump.find("thread 2 record 19") == std::string::npos ||
+      dump.find("thread 1 record 5") != std::string::npos ||
+      dump.find("Leave,     recorder") == std::string::npos ||
+      dump.find("debug detail") == std::string::npos ||
+      dump.find("\"boom\", 0") == std::string::npos) {
+    std::cerr << "Unexpected dump" << std::endl << dump;
+    status = 1;
+  }
+
+  if (out.find("record 1") != std::string::npos ||
+      out.find("\"boom\", 0") == std::string::npos) {
+    std::cerr << "Filtered records were written" << std::endl << out;
+    status = 1;
+  }
+
+  // a crashing process leaves its last records behind
+  pid_t pid = fork();
+  if (pid == 0) {
+    FlightRecorder::Enable(4, "crash.log");
+    monitor->Log("before crash");
+    raise(SIGSEGV);
+    _exit(0);
+  }
+
+  int wstatus;
+  waitpid(pid, &wstatus, 0);
+
+  auto crash = read_file("crash.log");
+  if (!WIFSIGNALED(wstatus) || WTERMSIG(wstatus) != SIGSEGV ||
+      crash.find("# Flight recorder dump on SIGSEGV") == std::string::npos ||
+      crash.find("before crash") == std::string::npos) {
+    std::cerr << "Unexpected crash dump" << std::endl << crash;
+    status = 1;
+  }
+
+  // writers keep their rings while recording is switched on and off
+  std::atomic<bool> stop(false);
+  std::thread writer([&]() {
+    while (!stop.load()) monitor->Debug("busy");
+  });
+  for (int i = 0; i < 100; ++i) {
+    FlightRecorder::Enable(4 + i % 3, "flight_toggle.log");
+    FlightRecorder::Disable();
+  }
+  stop.store(true);
+  writer.join();
+
+  // rings of exited threads are reused once every ring has been taken
+  FlightRecorder::Enable(4, "flight_threads.log");
+  int nthreads = FlightRecorder::kMaxThreads + 8;
+  for (int i = 0; i < nthreads; ++i) {
+    std::thread([monitor, i]() {
+      monitor->Debug("short thread " + std::to_string(i));
+    }).join();
+  }
+  FlightRecorder::Dump("test");
+
+  auto threads = read_file("flight_threads.log");
+  if (threads.find("short thread " + std::to_string(nthreads - 1)) ==
+      std::string::npos) {
+    std::cerr << "Late threads were not recorded" << std::endl;
+    status = 1;
+  }
+
+  // a reused ring is numbered for its last owner
+  int last = -1, highest = -1;
+  for (size_t pos = threads.find("# thread "); pos != std::string::npos;
+       pos = threads.find("# thread ", pos + 1)) {
+    int number = std::stoi(threads.substr(pos + 9));
+    highest = std::max(highest, number);
+
+    size_t next = threads.find("# thread ", pos + 1);
+    if (threads.substr(pos, next - pos)
+            .find("short thread " + std::to_string(nthreads - 1)) !=
+        std::string::npos) {
+      last = number;
+    }
+  }
+  if (last < 0 || last != highest) {
+    std::cerr << "Last thread numbered " << last << " of " << highest
+              << std::endl;
+    status = 1;
+  }
+
+  Application::Destroy();
+
+  return status;
+}
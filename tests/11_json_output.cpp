@@ -0,0 +1,95 @@
+// C/C++
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// application
+#include <application/application.hpp>
+
+std::string read_file(std::string const &fname) {
+  std::ifstream fin(fname);
+  std::stringstream ss;
+  ss << fin.rdbuf();
+  return ss.str();
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("text", "fields.out", "fields.out");
+  app->InstallMonitor("json", "json.out", "json.out");
+
+  auto text = app->GetMonitor("text");
+  auto json = app->GetMonitor("json");
+  json->SetFormat(Monitor::kJSON);
+
+  double dt = 0.015625;
+  int iter = 12;
+  std::string name = "say \"hi\", then\tgo\n";
+  std::vector<double> field = {1.5, NAN, -2.};
+
+  text->Log("step done", {"dt", dt}, {"iter", iter}, {"ok", true});
+
+  json->Log("step done", {"dt", dt}, {"iter", iter}, {"ok", true},
+            {"name", name}, {"count", size_t(7)});
+  json->Log("plain");
+  json->Log("x", 2.5);
+  json->Log("field", field);
+  json->Log("words", std::vector<std::string>{"a", "b\"c"});
+  json->Warn("careful", 3);
+
+  text->Flush();
+  json->Flush();
+
+  int status = 0;
+
+  auto out = read_file("fields.out");
+  if (out.find(", \"step done: dt = 0.015625, iter = 12, ok = true\"\n") ==
+      std::string::npos) {
+    std::cerr << "Unexpected text record" << std::endl << out;
+    status = 1;
+  }
+
+  // strip the time stamps, which change between runs; the monitor was
+  // installed in text format
+  std::string lines, line;
+  std::istringstream ss(read_file("json.out"));
+  std::getline(ss, line);
+  while (std::getline(ss, line)) {
+    auto pos = line.find("\"kind\"");
+    if (line.compare(0, 9, "{\"time\":\"") != 0 || pos == std::string::npos) {
+      std::cerr << "Missing time stamp in " << line << std::endl;
+      status = 1;
+      continue;
+    }
+    lines += line.substr(pos) + "\n";
+  }
+
+  std::string expected =
+      "\"kind\":\"Log\",\"monitor\":\"json\",\"section\":\"5.\","
+      "\"msg\":\"step done\",\"dt\":0.015625,\"iter\":12,\"ok\":true,"
+      "\"name\":\"say \\\"hi\\\", then\\tgo\\n\",\"count\":7}\n"
+      "\"kind\":\"Log\",\"monitor\":\"json\",\"section\":\"6.\","
+      "\"msg\":\"plain\"}\n"
+      "\"kind\":\"Log\",\"monitor\":\"json\",\"section\":\"7.\","
+      "\"msg\":\"x\",\"value\":2.5}\n"
+      "\"kind\":\"Log\",\"monitor\":\"json\",\"section\":\"8.\","
+      "\"msg\":\"field\",\"value\":[1.5,null,-2]}\n"
+      "\"kind\":\"Log\",\"monitor\":\"json\",\"section\":\"9.\","
+      "\"msg\":\"words\",\"value\":[\"a\",\"b\\\"c\"]}\n"
+      "\"kind\":\"Warn\",\"monitor\":\"json\",\"section\":\"10.\","
+      "\"msg\":\"careful\",\"code\":3}\n";
+
+  if (lines != expected) {
+    std::cerr << "Unexpected JSON records" << std::endl << lines;
+    status = 1;
+  }
+
+  Application::Destroy();
+
+  return status;
+}
@@ -0,0 +1,189 @@
+// C/C++
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// application
+#include <application/application.hpp>
+#include <application/device.hpp>
+#include <application/log_index.hpp>
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->SetIndexed(true);
+  app->InstallMonitor("a", "index_0.out", "index_0.out");
+  app->InstallMonitor("b", "index_0.out", "index_0.out");
+  app->InstallMonitor("c", "index_1.out", "index_1.out");
+
+  auto a = app->GetMonitor("a");
+  auto b = app->GetMonitor("b");
+  auto c = app->GetMonitor("c");
+  c->SetFormat(Monitor::kJSON);
+
+  const int nthreads = 4;
+  const int nrecords = 500;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < nrecords; ++i) {
+        auto monitor = i % 3 == 0 ? a : i % 3 == 1 ? b : c;
+        monitor->Log("thread " + std::to_string(t) + " record", i);
+      }
+    });
+  }
+  for (auto &th : threads) th.join();
+
+  // sections of other threads are never two levels deep
+  a->Enter();
+  a->Enter();
+  for (int i = 0; i < 3; ++i) a->Log("inside");
+  a->Leave();
+  a->Leave();
+
+  a->Flush();
+  c->Flush();
+
+  int status = 0;
+
+  // one index entry per record, installation messages included
+  int nb = nthreads * ((nrecords + 1) / 3) + 1;
+  int nc = nthreads * (nrecords / 3);
+  int nab = nthreads * nrecords - nc + 3 + 2;
+
+  LogIndex log0("index_0.out");
+  if (log0.GetEntries().size() != static_cast<size_t>(nab)) {
+    std::cerr << "Expected " << nab << " entries, found "
+              << log0.GetEntries().size() << std::endl;
+    status = 1;
+  }
+
+  for (auto const &entry : log0.GetEntries()) {
+    auto record = log0.Read(entry);
+    if (record.compare(0, 5, "Log, ") != 0 || record.back() != '\n' ||
+        record.find(", " + entry.section + ", " + std::to_string(entry.seq) +
+                    ", ") == std::string::npos) {
+      std::cerr << "Index entry does not match record " << record;
+      status = 1;
+      break;
+    }
+  }
+
+  // select by monitor
+  IndexQuery query;
+  query.monitor = "b";
+  std::ostringstream out;
+  size_t nfound = log0.Query(query, out);
+
+  std::istringstream lines(out.str());
+  std::string line;
+  size_t nlines = 0;
+  while (std::getline(lines, line)) {
+    nlines++;
+    if (line.find(",            b, ") == std::string::npos) {
+      std::cerr << "Record of another monitor: " << line << std::endl;
+      status = 1;
+    }
+  }
+  if (nlines != nfound || nfound != static_cast<size_t>(nb)) {
+    std::cerr << "Found " << nfound << " records of monitor b" << std::endl;
+    status = 1;
+  }
+
+  // select by section: the parent of the "inside" records
+  query.monitor = "a";
+  std::string inside;
+  for (auto const &entry : log0.Find(query)) {
+    if (log0.Read(entry).find("\"inside\"") != std::string::npos) {
+      inside = entry.section;
+    }
+  }
+  query.section = inside.substr(0, inside.rfind('.', inside.size() - 2));
+  if (inside.empty() || log0.Find(query).size() != 3) {
+    std::cerr << "Expected 3 records in section " << query.section
+              << std::endl;
+    status = 1;
+  }
+
+  // merge both files in time order
+  LogIndex log1("index_1.out");
+  int njson = 0;
+  for (auto const &entry : log1.GetEntries()) {
+    auto record = log1.Read(entry);
+    if (record.find("\"seq\":" + std::to_string(entry.seq)) !=
+        std::string::npos) {
+      njson++;
+    }
+  }
+  if (njson != nc) {
+    std::cerr << "Found " << njson << " of " << nc << " JSON records"
+              << std::endl;
+    status = 1;
+  }
+
+  std::ostringstream merged;
+  size_t nmerged =
+      LogIndex::Merge({"index_0.out", "index_1.out"}, IndexQuery(), merged);
+  if (nmerged != static_cast<size_t>(nab + nc + 1)) {
+    std::cerr << "Merged " << nmerged << " records" << std::endl;
+    status = 1;
+  }
+
+  // time stamps have the same width, so they compare as strings
+  std::istringstream mlines(merged.str());
+  std::string last;
+  while (std::getline(mlines, line)) {
+    auto pos = line.find("\"20");
+    std::string time = line.substr(pos + 1, 29);
+    time[10] = 'T';
+    if (time < last) {
+      std::cerr << "Out of order: " << time << " after " << last << std::endl;
+      status = 1;
+      break;
+    }
+    last = time;
+  }
+
+  // the index is enabled while other threads write to the device
+  {
+    auto device = std::make_shared<FileDevice>("index_2.out");
+    std::atomic<uint64_t> seq(0);
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < nthreads; ++t) {
+      writers.emplace_back([&]() {
+        for (int i = 0; i < nrecords; ++i) {
+          RecordInfo info = {seq.fetch_add(1), 0, "d", "1."};
+          std::string record = "record " + std::to_string(info.seq) + "\n";
+          struct iovec iov = {&record[0], record.size()};
+          device->Write(&iov, 1, &info);
+        }
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    device->EnableIndex();
+    for (auto &th : writers) th.join();
+    device->Flush();
+  }
+
+  LogIndex log2("index_2.out");
+  for (auto const &entry : log2.GetEntries()) {
+    if (log2.Read(entry) != "record " + std::to_string(entry.seq) + "\n") {
+      std::cerr << "Index entry " << entry.seq << " points to "
+                << log2.Read(entry);
+      status = 1;
+      break;
+    }
+  }
+
+  Application::Destroy();
+
+  return status;
+}
@@ -0,0 +1,133 @@
+// C/C++
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// application
+#include <application/application.hpp>
+#include <application/exceptions.hpp>
+#include <application/rate_limit.hpp>
+
+std::string read_file(std::string const &fname) {
+  std::ifstream fin(fname);
+  std::stringstream ss;
+  ss << fin.rdbuf();
+  return ss.str();
+}
+
+int count_lines(std::string const &str, std::string const &pattern) {
+  int n = 0;
+  for (auto pos = str.find(pattern); pos != std::string::npos;
+       pos = str.find(pattern, pos + 1)) {
+    n++;
+  }
+  return n;
+}
+
+void old_step() { APP_WARN_DEPRECATED("Use new_step() instead."); }
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("main", "limit.out", "limit.out");
+  app->InstallMonitor("dedup", "dedup.out", "dedup.out");
+
+  auto log = app->GetMonitor("main");
+  auto dedup = app->GetMonitor("dedup");
+  dedup->SetDeduplicate(true);
+
+  // every 10th of 4000 occurrences on 4 threads, no limit per interval
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 1000; ++i) {
+        APP_WARN_LIMITED(log, 10, 0, 1., "every tenth");
+        APP_WARN_LIMITED(log, 1, 5, 3600., "five per hour");
+        APP_WARN_ONCE(log, "only once");
+        dedup->Warn("same message", i);
+      }
+    });
+  }
+  for (auto &th : threads) th.join();
+
+  dedup->Warn("other message");
+
+  // the same message of another monitor is not a duplicate
+  app->InstallMonitor("dedup2", "dedup2.out", "dedup2.out");
+  auto dedup2 = app->GetMonitor("dedup2");
+  dedup2->SetDeduplicate(true);
+  dedup2->Warn("same message");
+  dedup2->Warn("same message");
+
+  for (int i = 0; i < 3; ++i) old_step();
+  app->WarnDeprecated("old_api");
+  app->WarnDeprecated("old_api");
+
+  log->Flush();
+  dedup->Flush();
+  dedup2->Flush();
+
+  int status = 0;
+
+  auto out = read_file("limit.out");
+  if (count_lines(out, "\"every tenth\"") != 400 ||
+      count_lines(out, "\"five per hour\"") != 5 ||
+      count_lines(out, "\"only once\"") != 1 ||
+      count_lines(out, "old_step is deprecated. Use new_step() instead.") != 1 ||
+      count_lines(out, "\"old_api is deprecated\"") != 1) {
+    std::cerr << "Unexpected rate-limited warnings" << std::endl;
+    status = 1;
+  }
+
+  out = read_file("dedup.out");
+  if (count_lines(out, "Warn, ") != 2 ||
+      DedupSet::Global().GetDuplicates(dedup->GetDedupHash("same message")) !=
+          3999) {
+    std::cerr << "Unexpected deduplicated warnings" << std::endl << out;
+    status = 1;
+  }
+
+  out = read_file("dedup2.out");
+  if (count_lines(out, "\"same message\"") != 1 ||
+      DedupSet::Global().GetDuplicates(dedup2->GetDedupHash("same message")) !=
+          1) {
+    std::cerr << "Unexpected deduplicated warnings" << std::endl << out;
+    status = 1;
+  }
+
+  auto summary = RateLimit::GetSummary();
+  int nsummary = 0;
+  for (auto const &line : summary) {
+    if (line.find("suppressed 3600 of 4000") != std::string::npos ||
+        line.find("suppressed 3995 of 4000") != std::string::npos ||
+        line.find("suppressed 3999 duplicates of \"same message\"") !=
+            std::string::npos ||
+        line.find("suppressed 1 duplicates of \"same message\"") !=
+            std::string::npos ||
+        line.find("suppressed 1 duplicates of \"old_api") !=
+            std::string::npos) {
+      nsummary++;
+    }
+  }
+  if (nsummary != 5) {
+    std::cerr << "Unexpected summary" << std::endl;
+    for (auto const &line : summary) std::cerr << line << std::endl;
+    status = 1;
+  }
+
+  app->MakeDeprecationWarningsFatal();
+  try {
+    app->WarnDeprecated("old_api");
+    std::cerr << "Deprecation warning is not fatal" << std::endl;
+    status = 1;
+  } catch (RuntimeError const &) {
+  }
+
+  Application::Destroy();
+
+  return status;
+}
@@ -0,0 +1,114 @@
+// C/C++
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// application
+#include <application/application.hpp>
+#include <application/signal.hpp>
+
+std::string read_file(std::string const &fname) {
+  std::ifstream fin(fname);
+  std::stringstream ss;
+  ss << fin.rdbuf();
+  return ss.str();
+}
+
+static volatile sig_atomic_t host_signal = 0;
+
+//! Handler of the program before the control file is set
+void onHostSignal(int) { host_signal = 1; }
+
+void step(int n) {
+  for (int i = 0; i < n; ++i) {
+    Application::Logger log(APP_MONITOR("work"));
+    log->Log("step", i);
+  }
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("main", "control.out", "control.out");
+  app->InstallMonitor("work", "work.out", "work.out");
+
+  std::signal(SIGHUP, onHostSignal);
+  Application::SetControlFile("control.txt");
+  auto sig = Signal::GetInstance();
+
+  std::ofstream("control.txt") << "# first reconfiguration\n"
+                                  "level work warn\n"
+                                  "profile on\n"
+                                  "output main control2.out\n"
+                                  "bogus command\n";
+
+  // nothing changes before the safe point
+  raise(SIGHUP);
+  step(3);
+  sig->CheckSignalFlags();
+  step(5);
+
+  std::ofstream("control.txt") << "level * debug\n"
+                                  "profile off\n"
+                                  "dump profile profile.txt\n"
+                                  "dump metrics metrics.prom\n";
+  raise(SIGUSR1);
+  sig->CheckSignalFlags();
+  step(2);
+
+  app->GetMonitor("work")->Flush();
+  app->GetMonitor("main")->Flush();
+
+  int status = 0;
+
+  auto work = read_file("work.out");
+  if (work.find("\"step = 2\"") == std::string::npos ||
+      work.find("\"step = 3\"") != std::string::npos ||
+      work.find("\"step = 1\"", work.rfind("\"step = 2\"")) ==
+          std::string::npos) {
+    std::cerr << "Levels were not changed at the safe points" << std::endl
+              << work;
+    status = 1;
+  }
+
+  auto main = read_file("control2.out");
+  if (main.find("control.txt:5: cannot apply \"bogus command\"") ==
+      std::string::npos) {
+    std::cerr << "Monitor main was not redirected" << std::endl;
+    status = 1;
+  }
+
+  // the five sections between the reconfigurations were profiled
+  std::istringstream profile(read_file("profile.txt"));
+  std::string line, name;
+  int sections = 0;
+  while (std::getline(profile, line)) {
+    std::istringstream(line) >> name >> sections;
+    if (name == "work") break;
+  }
+  if (name != "work" || sections != 5) {
+    std::cerr << "Unexpected profile" << std::endl
+              << read_file("profile.txt");
+    status = 1;
+  }
+
+  if (!std::ifstream("metrics.prom")) {
+    std::cerr << "Metrics were not dumped" << std::endl;
+    status = 1;
+  }
+
+  // without a control file the program handles the signals again
+  Application::SetControlFile("");
+  raise(SIGHUP);
+  if (host_signal != 1) {
+    std::cerr << "Handler of the program was not restored" << std::endl;
+    status = 1;
+  }
+
+  Application::Destroy();
+
+  return status;
+}
@@ -0,0 +1,112 @@
+// C/C++
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// application
+#include <application/application.hpp>
+#include <application/exceptions.hpp>
+
+int main(int, char **argv) {
+  std::ofstream("params.in") << "# test problem\n"
+                                "<job>\n"
+                                "problem_id = blast   # basename\n"
+                                "\n"
+                                "<mesh>\n"
+                                "nx1  = 64\n"
+                                "xmin = -0.5\n"
+                                "periodic = yes\n"
+                                "<job>\n"
+                                "tlim = 1e-2\n";
+
+  // argv ends with a null pointer, which MPI_Init relies on
+  char const *args[] = {argv[0], "-i", "params.in", "mesh/nx1=128",
+                        "output/dt = 0.1", nullptr};
+  Application::Start(5, const_cast<char **>(args));
+
+  auto params = Application::GetInstance()->GetParameters();
+  int status = 0;
+
+  auto nx1 = params->GetHandle<int64_t>("mesh", "nx1");
+  auto xmin = params->GetHandle<double>("mesh", "xmin");
+  auto dt = params->GetHandle<double>("output", "dt");
+  auto cfl = params->GetHandle<double>("time", "cfl", 0.3);
+
+  if (*nx1 != 128 || *xmin != -0.5 || *dt != 0.1 || *cfl != 0.3 ||
+      !params->GetBoolean("mesh", "periodic") ||
+      params->GetString("job", "problem_id") != "blast" ||
+      params->GetReal("job", "tlim") != 1.e-2) {
+    std::cerr << "Unexpected parameters" << std::endl << params->ToString();
+    status = 1;
+  }
+
+  // handles see new values
+  params->Set("mesh", "nx1", "256");
+  if (*nx1 != 256) {
+    std::cerr << "Handle does not see the new value" << std::endl;
+    status = 1;
+  }
+
+  // values that do not convert are rejected
+  int nerrors = 0;
+  try {
+    params->Set("mesh", "nx1", "many");
+  } catch (RuntimeError const &) {
+    nerrors++;
+  }
+  try {
+    params->GetInteger("mesh", "xmin");
+  } catch (RuntimeError const &) {
+    nerrors++;
+  }
+  try {
+    params->GetReal("mesh", "ny1");
+  } catch (NotFoundError const &) {
+    nerrors++;
+  }
+  try {
+    Parameters missing;
+    missing.LoadShared("missing.in");
+  } catch (NotFoundError const &) {
+    nerrors++;
+  } catch (RuntimeError const &) {
+    nerrors++;
+  }
+  if (nerrors != 4 || *nx1 != 256) {
+    std::cerr << "Invalid parameters were accepted" << std::endl;
+    status = 1;
+  }
+
+  // integers are decimal, leading zeros do not make them octal
+  params->Set("mesh", "nx1", "0256");
+  if (*nx1 != 256) {
+    std::cerr << "Integer with leading zero parsed as " << *nx1 << std::endl;
+    status = 1;
+  }
+  params->Set("mesh", "nx1", "256");
+
+  // blocks keep the order of the input file
+  std::string expected =
+      "<job>\nproblem_id = blast\ntlim = 1e-2\n"
+      "<mesh>\nnx1 = 256\nxmin = -0.5\nperiodic = yes\n"
+      "<output>\ndt = 0.1\n"
+      "<time>\ncfl = 0.3\n";
+  if (params->ToString() != expected) {
+    std::cerr << "Unexpected input file" << std::endl << params->ToString();
+    status = 1;
+  }
+
+  // the binary cache reproduces the parsed file
+  std::remove("params.cache");
+  Parameters parsed, cached;
+  parsed.Load("params.in", "params.cache");
+  cached.Load("params.in", "params.cache");
+  if (parsed.ToString() != cached.ToString() || cached.Count() != 5) {
+    std::cerr << "Cache differs from the input file" << std::endl;
+    status = 1;
+  }
+
+  Application::Destroy();
+
+  return status;
+}
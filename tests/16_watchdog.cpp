@@ -0,0 +1,70 @@
+// C/C++
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// application
+#include <application/application.hpp>
+#include <application/watchdog.hpp>
+
+std::string read_file(std::string const &fname) {
+  std::ifstream fin(fname);
+  std::stringstream ss;
+  ss << fin.rdbuf();
+  return ss.str();
+}
+
+void sleep(double seconds) {
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("outer", "watchdog.out", "watchdog.out");
+  app->InstallMonitor("inner", "watchdog.out", "watchdog.out");
+
+  std::remove("hang.log");
+
+  auto dog = Watchdog::GetInstance();
+  dog->Start(0.2);
+
+  // steady progress is no hang
+  for (int i = 0; i < 20; ++i) {
+    Application::Logger log(APP_MONITOR("outer"));
+    sleep(0.03);
+  }
+
+  int status = 0;
+  if (!read_file("hang.log").empty()) {
+    std::cerr << "hang reported despite progress" << std::endl;
+    status = 1;
+  }
+
+  // stall inside nested sections
+  {
+    Application::Logger outer(APP_MONITOR("outer"));
+    Application::Logger inner(APP_MONITOR("inner"));
+    sleep(0.6);
+  }
+
+  dog->Stop();
+
+  std::string report = read_file("hang.log");
+  for (auto what : {"no progress", "outer > inner", "backtrace of thread"}) {
+    if (report.find(what) == std::string::npos) {
+      std::cerr << "missing in hang.log: " << what << std::endl;
+      status = 1;
+    }
+  }
+
+  if (status != 0) std::cerr << report;
+
+  Application::Destroy();
+  return status;
+}
@@ -0,0 +1,87 @@
+// C/C++
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// application
+#include <application/application.hpp>
+#include <application/imbalance.hpp>
+#include <application/signal.hpp>
+
+std::string read_file(std::string const &fname) {
+  std::ifstream fin(fname);
+  std::stringstream ss;
+  ss << fin.rdbuf();
+  return ss.str();
+}
+
+void step() {
+  Application::Logger solver(APP_MONITOR("solver"));
+  {
+    Application::Logger io(APP_MONITOR("io"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("main", "imbalance.out", "imbalance.out");
+  app->InstallMonitor("solver", "imbalance.out", "imbalance.out");
+  app->InstallMonitor("io", "imbalance.out", "imbalance.out");
+
+  std::remove("imbalance.csv");
+  Application::SetImbalanceInterval(2);
+
+  auto sig = Signal::GetInstance();
+  for (int i = 0; i < 3; ++i) {
+    step();
+    sig->CheckSignalFlags();
+  }
+
+  int status = 0;
+
+  // only member rank 0 gets the rows and writes the reports; the solver
+  // includes io, so it comes first
+  auto rows = Imbalance::Reduce(app);
+  bool root = !rows.empty();
+  if (root && (rows.size() != 2 || rows[0].section != "solver" ||
+               rows[0].calls % 3 != 0 || rows[1].section != "io" ||
+               rows[0].max < rows[1].max || rows[0].factor < 1. ||
+               rows[0].slowest.empty())) {
+    std::cerr << "Unexpected reduction" << std::endl
+              << Imbalance::FormatTable(rows);
+    status = 1;
+  }
+
+  auto csv = read_file("imbalance.csv");
+  if (root &&
+      (csv.find("report,section,calls,min,mean,max,imbalance,mpi,slowest\n") != 0 ||
+       csv.find("\n1,solver,") == std::string::npos ||
+       csv.find("\n1,io,") == std::string::npos)) {
+    std::cerr << "Unexpected first report" << std::endl << csv;
+    status = 1;
+  }
+
+  Application::Destroy();
+
+  csv = read_file("imbalance.csv");
+  if (root && csv.find("\n2,solver,") == std::string::npos) {
+    std::cerr << "No final report" << std::endl << csv;
+    status = 1;
+  }
+
+  if (root &&
+      read_file("imbalance.out").find("max/mean") == std::string::npos) {
+    std::cerr << "No table on monitor main" << std::endl;
+    status = 1;
+  }
+
+  return status;
+}
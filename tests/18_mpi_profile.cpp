@@ -0,0 +1,47 @@
+// C/C++
+#include <cstdint>
+#include <iostream>
+
+// application
+#include <application/application.hpp>
+#include <application/signal.hpp>
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("step", "mpi_profile.out", "mpi_profile.out");
+  app->InstallMonitor("exchange", "mpi_profile.out", "mpi_profile.out");
+
+  Profiler::Enable();
+
+  // with MPI, each check reduces three int flags over the ranks
+  auto sig = Signal::GetInstance();
+  const int nchecks = 5;
+  for (int i = 0; i < nchecks; ++i) {
+    Application::Logger step(APP_MONITOR("step"));
+    Application::Logger exchange(APP_MONITOR("exchange"));
+    sig->CheckSignalFlags();
+  }
+
+  // the MPI calls are only counted by a build with PMPI_PROFILING
+  int status = 0;
+  for (auto name : {"step", "exchange"}) {
+    uint64_t calls, bytes;
+    double seconds;
+    app->GetMonitor(name)->GetCommunication(&calls, &seconds, &bytes);
+
+    if (calls != 0 &&
+        (calls != nchecks || bytes != 3 * sizeof(int) * nchecks ||
+         seconds <= 0.)) {
+      std::cerr << name << ": " << calls << " MPI calls, " << bytes
+                << " bytes, " << seconds << " s" << std::endl;
+      status = 1;
+    }
+  }
+
+  std::cout << app->GetProfile();
+
+  Application::Destroy();
+  return status;
+}
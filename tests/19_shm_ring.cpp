@@ -0,0 +1,67 @@
+// C/C++
+#include <iostream>
+#include <string>
+
+// application
+#include <application/application.hpp>
+#include <application/shm_ring.hpp>
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("live", "shm:app_test_live", "shm:app_test_live");
+
+  auto log = app->GetMonitor("live");
+  log->Log("first");
+  log->Warn("second");
+
+  int status = 0;
+
+  // a reader attaching later sees what is still in the ring
+  auto reader = ShmRing::Attach("app_test_live");
+  uint64_t pos = 0;
+  std::string records;
+  uint64_t lost = reader->Read(&pos, &records);
+  if (lost != 0 || records.find("\"first\"") == std::string::npos ||
+      records.find("\"second\"") == std::string::npos ||
+      records.find("Installing monitor live") == std::string::npos) {
+    std::cerr << "Unexpected records" << std::endl << records;
+    status = 1;
+  }
+
+  // nothing new, nothing read
+  records.clear();
+  reader->Read(&pos, &records);
+  if (!records.empty()) {
+    std::cerr << "Records read twice" << std::endl;
+    status = 1;
+  }
+
+  // a small ring overwrites what the reader missed
+  auto ring = ShmRing::Create("app_test_small", 4096);
+  auto small = ShmRing::Attach("app_test_small");
+  uint64_t small_pos = 0;
+
+  std::string line(100, 'x');
+  line.back() = '\n';
+  for (int i = 0; i < 100; ++i) {
+    struct iovec iov = {const_cast<char *>(line.data()), line.size()};
+    ring->Write(&iov, 1);
+  }
+
+  // lost bytes count whole records of a length and 104 padded bytes
+  records.clear();
+  lost = small->Read(&small_pos, &records);
+  size_t nread = records.size() / line.size();
+  if (lost == 0 || records.size() % line.size() != 0 ||
+      nread * (8 + 104) + lost != 100 * (8 + 104) ||
+      records.size() > ring->GetCapacity()) {
+    std::cerr << "Unexpected overwrite: lost " << lost << ", read "
+              << records.size() << std::endl;
+    status = 1;
+  }
+
+  Application::Destroy();
+  return status;
+}
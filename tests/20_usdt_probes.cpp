@@ -0,0 +1,76 @@
+// C/C++
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+// POSIX C extensions
+#include <elf.h>  // Elf64_Ehdr, Elf64_Shdr, Elf64_Nhdr
+
+// application
+#include <application/application.hpp>
+
+//! Probe names of provider "application" in the stapsdt notes of fname
+std::set<std::string> find_probes(std::string const &fname) {
+  std::ifstream in(fname, std::ios::binary);
+  std::vector<char> elf((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+
+  std::set<std::string> probes;
+  if (elf.size() < sizeof(Elf64_Ehdr)) return probes;
+
+  auto ehdr = reinterpret_cast<Elf64_Ehdr const *>(elf.data());
+  auto shdrs = reinterpret_cast<Elf64_Shdr const *>(elf.data() + ehdr->e_shoff);
+  char const *strtab = elf.data() + shdrs[ehdr->e_shstrndx].sh_offset;
+
+  for (int i = 0; i < ehdr->e_shnum; ++i) {
+    if (strcmp(strtab + shdrs[i].sh_name, ".note.stapsdt") != 0) continue;
+
+    char const *pos = elf.data() + shdrs[i].sh_offset;
+    char const *end = pos + shdrs[i].sh_size;
+    while (pos + sizeof(Elf64_Nhdr) <= end) {
+      auto nhdr = reinterpret_cast<Elf64_Nhdr const *>(pos);
+      char const *name = pos + sizeof(Elf64_Nhdr);
+      char const *desc = name + ((nhdr->n_namesz + 3) & ~3u);
+
+      // pc, base and semaphore addresses, then provider, name and args
+      if (nhdr->n_type == 3 && strcmp(name, "stapsdt") == 0) {
+        char const *provider = desc + 3 * 8;
+        char const *probe = provider + strlen(provider) + 1;
+        if (strcmp(provider, "application") == 0) probes.insert(probe);
+      }
+
+      pos = desc + ((nhdr->n_descsz + 3) & ~3u);
+    }
+  }
+
+  return probes;
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  // probes fire nothing without a tracer
+  {
+    Application::Logger log(APP_MONITOR("probed"));
+    log->Log("message");
+  }
+
+  int status = 0;
+  if (Monitor::HasProbes()) {
+    auto probes = find_probes("/proc/self/exe");
+    for (auto name : {"monitor__enter", "monitor__leave", "monitor__log",
+                      "monitor__warn", "monitor__error"}) {
+      if (probes.count(name) == 0) {
+        std::cerr << "No USDT note for probe " << name << std::endl;
+        status = 1;
+      }
+    }
+  }
+
+  Application::Destroy();
+  return status;
+}
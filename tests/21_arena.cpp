@@ -0,0 +1,123 @@
+// C/C++
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// application
+#include <application/application.hpp>
+#include <application/arena.hpp>
+
+using ArenaVector = std::vector<double, ArenaAllocator<double>>;
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("outer", "arena.out", "arena.out");
+  app->InstallMonitor("inner", "arena.out", "arena.out");
+
+  int status = 0;
+
+  auto arena = Application::GetArena();
+  double *first = nullptr;
+  {
+    Application::Logger outer(APP_MONITOR("outer"));
+    ArenaVector a(1000);
+
+    {
+      Application::Logger inner(APP_MONITOR("inner"));
+      ArenaVector b(2000);
+      first = b.data();
+    }
+
+    // the memory of the inner section is reused
+    {
+      Application::Logger inner(APP_MONITOR("inner"));
+      ArenaVector c(2000);
+      if (c.data() != first) {
+        std::cerr << "Memory of a section was not released" << std::endl;
+        status = 1;
+      }
+    }
+  }
+
+  if (arena->GetUsed() != 0) {
+    std::cerr << arena->GetUsed() << " bytes left in the arena" << std::endl;
+    status = 1;
+  }
+
+  uint64_t inner = app->GetMonitor("inner")->GetArenaPeak();
+  uint64_t outer = app->GetMonitor("outer")->GetArenaPeak();
+  if (inner < 2000 * sizeof(double) || inner > 2000 * sizeof(double) + 64 ||
+      outer < 3000 * sizeof(double) || outer > 3000 * sizeof(double) + 128) {
+    std::cerr << "Unexpected peaks" << std::endl << app->GetArenaStats();
+    status = 1;
+  }
+
+  // an allocation larger than a chunk gets its own
+  {
+    Application::Logger log(APP_MONITOR("inner"));
+    ArenaVector big(Arena::kChunkSize);
+    big.back() = 1.;
+  }
+
+  // over-aligned types get aligned addresses, not only aligned offsets
+  struct alignas(64) Block {
+    double v[8];
+  };
+  {
+    Application::Logger log(APP_MONITOR("inner"));
+    int misaligned = 0;
+    for (int i = 0; i < 1000; ++i) {
+      void *p = arena->Allocate(40, 64);
+      misaligned += reinterpret_cast<uintptr_t>(p) % 64 != 0;
+    }
+
+    std::vector<Block, ArenaAllocator<Block>> blocks(100);
+    for (auto const &b : blocks) {
+      misaligned += reinterpret_cast<uintptr_t>(&b) % alignof(Block) != 0;
+    }
+
+    if (misaligned > 0) {
+      std::cerr << misaligned << " misaligned allocations" << std::endl;
+      status = 1;
+    }
+  }
+
+  // released memory is poisoned in debug mode
+  Arena::SetPoison(true);
+  char *text = nullptr;
+  {
+    Application::Logger log(APP_MONITOR("inner"));
+    text = static_cast<char *>(arena->Allocate(100, 1));
+    memset(text, 'x', 100);
+  }
+  Arena::SetPoison(false);
+
+  for (int i = 0; i < 100; ++i) {
+    if (static_cast<unsigned char>(text[i]) != Arena::kPoison) {
+      std::cerr << "Released memory was not poisoned" << std::endl;
+      status = 1;
+      break;
+    }
+  }
+
+  // other threads have their own arenas
+  Arena *other = nullptr;
+  std::thread([&other]() {
+    Application::Logger log(APP_MONITOR("inner"));
+    ArenaVector v(10);
+    other = v.get_allocator().GetArena();
+  }).join();
+
+  if (other == nullptr || other == arena) {
+    std::cerr << "Threads share an arena" << std::endl;
+    status = 1;
+  }
+
+  Application::Destroy();
+  return status;
+}
@@ -0,0 +1,96 @@
+// C/C++
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// application
+#include <application/application.hpp>
+#include <application/exceptions.hpp>
+
+__attribute__((noinline)) static void throwingLookup(int depth) {
+  if (depth > 0) return throwingLookup(depth - 1);
+  throw RuntimeError("throwingLookup", "lookup failed");
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  int status = 0;
+
+  // frames are recorded and resolved on demand, what() is formatted once
+  try {
+    throwingLookup(3);
+  } catch (RuntimeError const &e) {
+    if (e.GetNumFrames() < 4) {
+      std::cerr << "Too few frames: " << e.GetNumFrames() << std::endl;
+      status = 1;
+    }
+
+    char const *what = e.what();
+    if (strstr(what, "lookup failed") == nullptr ||
+        strstr(what, "Backtrace:") == nullptr ||
+        strstr(what, "#0 ") == nullptr) {
+      std::cerr << "Unexpected what(): " << what << std::endl;
+      status = 1;
+    }
+    if (e.what() != what) {
+      std::cerr << "what() formatted twice" << std::endl;
+      status = 1;
+    }
+  }
+
+  // recording can be turned off
+  ExceptionBase::SetBacktraceDepth(0);
+  try {
+    throwingLookup(0);
+  } catch (RuntimeError const &e) {
+    if (e.GetNumFrames() != 0 ||
+        strstr(e.what(), "Backtrace:") != nullptr) {
+      std::cerr << "Frames recorded with depth 0" << std::endl;
+      status = 1;
+    }
+  }
+  ExceptionBase::SetBacktraceDepth(16);
+
+  // a missing resource gives a failed result, found ones give the path
+  std::ofstream("resource_found.txt") << "resource\n";
+
+  auto found = app->TryFindResource("resource_found.txt");
+  auto missing = app->TryFindResource("resource_missing.txt");
+  if (!found || found.Value().find("resource_found.txt") == std::string::npos) {
+    std::cerr << "Resource not found" << std::endl;
+    status = 1;
+  }
+  if (missing.HasValue() || missing.GetMethod() != "FindResource" ||
+      missing.GetMessage().find("resource_missing.txt") == std::string::npos ||
+      missing.ValueOr("none") != "none") {
+    std::cerr << "Missing resource found" << std::endl;
+    status = 1;
+  }
+
+  // the value of a failed result and the throwing lookup both throw
+  int nerrors = 0;
+  try {
+    missing.Value();
+  } catch (NotFoundError const &) {
+    nerrors++;
+  }
+  try {
+    app->FindResource("resource_missing.txt");
+  } catch (NotFoundError const &e) {
+    if (strstr(e.what(), "resource_missing.txt") != nullptr &&
+        strstr(e.what(), "not found.") != nullptr &&
+        strstr(e.what(), "-DMYPATH=") != nullptr) {
+      nerrors++;
+    }
+  }
+  if (nerrors != 2) {
+    std::cerr << "Missing resource did not throw" << std::endl;
+    status = 1;
+  }
+
+  Application::Destroy();
+  return status;
+}
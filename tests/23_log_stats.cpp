@@ -0,0 +1,75 @@
+// C/C++
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// POSIX C extensions
+#include <sys/stat.h>  // stat()
+
+// application
+#include <application/application.hpp>
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  // writes are timed with -s, as the table is logged then
+  Monitor::SetTimingWrites(true);
+
+  auto app = Application::GetInstance();
+  app->InstallMonitor("chatty", "log_stats.out", "log_stats.err");
+  auto monitor = app->GetMonitor("chatty");
+
+  int status = 0;
+
+  // the installation message is the first record
+  for (int i = 0; i < 99; ++i) monitor->Log("step", i);
+
+  // below the level, and duplicates held back
+  for (int i = 0; i < 10; ++i) monitor->Debug("detail");
+  monitor->SetDeduplicate(true);
+  for (int i = 0; i < 5; ++i) monitor->Warn("same warning");
+
+  monitor->Flush();
+
+  uint64_t records, bytes, suppressed;
+  monitor->GetVolume(&records, &bytes, &suppressed);
+
+  struct stat st;
+  stat("log_stats.out", &st);
+
+  if (records != 101 || suppressed != 14 ||
+      bytes != static_cast<uint64_t>(st.st_size)) {
+    std::cerr << "Unexpected volume: " << records << " records, " << bytes
+              << " of " << st.st_size << " bytes, " << suppressed
+              << " suppressed" << std::endl;
+    status = 1;
+  }
+
+  uint64_t nwrites = 0;
+  for (auto n : monitor->GetWriteLatency().GetCounts()) nwrites += n;
+  if (nwrites != records) {
+    std::cerr << "Writes timed " << nwrites << " times" << std::endl;
+    status = 1;
+  }
+
+  // the file device committed its buffer at least once
+  auto device = app->GetDevice("log_stats.out");
+  auto const &commits = device->GetCommitLatency();
+  uint64_t ncommits = 0;
+  for (auto n : commits.GetCounts()) ncommits += n;
+  if (device->GetRecords() != records || device->GetBytes() != bytes ||
+      ncommits == 0 || commits.GetQuantile(0.5) <= 0.) {
+    std::cerr << "Unexpected device statistics" << std::endl;
+    status = 1;
+  }
+
+  std::string stats = app->GetLogStats();
+  if (stats.find("chatty") == std::string::npos ||
+      stats.find("log_stats.out") == std::string::npos) {
+    std::cerr << "Unexpected table:" << std::endl << stats;
+    status = 1;
+  }
+
+  Application::Destroy();
+  return status;
+}
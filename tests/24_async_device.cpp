@@ -0,0 +1,100 @@
+// C/C++
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX C extensions
+#include <sys/stat.h>  // stat()
+#include <unistd.h>    // access()
+
+// application
+#include <application/application.hpp>
+#include <application/async_device.hpp>
+
+static std::string readFile(std::string const &fname) {
+  std::ifstream in(fname);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+//! Write records of 100 bytes from two threads, check the file is complete
+static int checkBackend(bool uring, std::string const &fname) {
+  auto device = std::make_unique<AsyncFileDevice>(fname, uring);
+  device->SetFlushPolicy(FlushPolicy::PerBytes(4096));
+
+  auto writer = [&](char c) {
+    std::string record(99, c);
+    record += '\n';
+    for (int i = 0; i < 5000; ++i) device->Write(record);
+  };
+
+  std::thread other(writer, 'b');
+  writer('a');
+  other.join();
+  device->Flush();
+
+  std::string data = readFile(fname);
+  int na = 0, nb = 0;
+  for (size_t pos = 0; pos + 100 <= data.size(); pos += 100) {
+    std::string record = data.substr(pos, 100);
+    if (record == std::string(99, 'a') + '\n') na++;
+    if (record == std::string(99, 'b') + '\n') nb++;
+  }
+
+  if (data.size() != 1000000 || na != 5000 || nb != 5000 ||
+      device->HasErrors() ||
+      (!uring && device->GetBackend() != AsyncFileDevice::kThreadPool)) {
+    std::cerr << "Backend " << device->GetBackend() << ": " << data.size()
+              << " bytes, " << na << " + " << nb << " records" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  auto app = Application::GetInstance();
+  int status = 0;
+
+  // io_uring where the kernel allows it, and the writer threads
+  status |= checkBackend(true, "async_uring.out");
+  status |= checkBackend(false, "async_threads.out");
+
+  // monitors select the device by name
+  app->InstallMonitor("async", "async:async_device.out", "async_device.err");
+  auto monitor = app->GetMonitor("async");
+  for (int i = 0; i < 1000; ++i) monitor->Log("step", i);
+  monitor->Flush();
+
+  std::string log = readFile("async_device.out");
+  size_t nlines = 0;
+  for (char c : log) nlines += c == '\n';
+  if (nlines != 1001 || log.find('\0') != std::string::npos ||
+      log.find("\"step = 999\"") == std::string::npos) {
+    std::cerr << "Unexpected log with " << nlines << " lines" << std::endl;
+    status = 1;
+  }
+
+  // failed writes are reported as errors of the monitor
+  if (access("/dev/full", W_OK) == 0) {
+    app->InstallMonitor("full", "async:/dev/full", "async_full.err");
+    auto full = app->GetMonitor("full");
+    full->Log("lost");
+    full->Flush();
+
+    std::string err = readFile("async_full.err");
+    if (err.find("Cannot write") == std::string::npos ||
+        err.find("/dev/full") == std::string::npos) {
+      std::cerr << "Failed write not reported: " << err << std::endl;
+      status = 1;
+    }
+  }
+
+  Application::Destroy();
+  return status;
+}
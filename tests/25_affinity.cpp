@@ -0,0 +1,131 @@
+// C/C++
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+// application
+#include <application/affinity.hpp>
+#include <application/application.hpp>
+#include <application/exceptions.hpp>
+
+//! Affinity with access to the topology and the cpu selection
+class TestAffinity : public Affinity {
+ public:
+  using Affinity::selectCPUs;
+
+  std::vector<CPU> const& GetCPUs() const { return cpus_; }
+};
+
+static std::set<int> toSet(std::vector<int> const& cpus) {
+  return std::set<int>(cpus.begin(), cpus.end());
+}
+
+int main(int argc, char **argv) {
+  Application::Start(argc, argv);
+
+  int status = 0;
+  TestAffinity aff;
+
+  // policies are parsed, unknown ones are rejected
+  aff.SetPolicy("compact");
+  bool compact = aff.GetPolicy() == Affinity::kCompact;
+  aff.SetPolicy("scatter");
+  bool scatter = aff.GetPolicy() == Affinity::kScatter;
+  aff.SetPolicy("0-1:2,4");
+  bool list = aff.GetPolicy() == Affinity::kList;
+  aff.SetPolicy("none");
+  bool none = aff.GetPolicy() == Affinity::kNone;
+
+  bool rejected = false;
+  try {
+    aff.SetPolicy("spread");
+  } catch (RuntimeError const &) {
+    rejected = true;
+  }
+
+  if (!compact || !scatter || !list || !none || !rejected) {
+    std::cerr << "Policies parsed wrongly" << std::endl;
+    status = 1;
+  }
+
+  if (Affinity::FormatCPUList(Affinity::ParseCPUList("10-11,0-3,8,2")) !=
+      "0-3,8,10-11") {
+    std::cerr << "Cpu lists parsed wrongly" << std::endl;
+    status = 1;
+  }
+
+  // a single rank gets all cpus with compact, one thread per core first
+  std::set<int> all, socket0, cores;
+  for (auto const &cpu : aff.GetCPUs()) {
+    all.insert(cpu.id);
+    if (cpu.socket == aff.GetCPUs().front().socket) socket0.insert(cpu.id);
+    cores.insert(cpu.socket * 100000 + cpu.core);
+  }
+
+  aff.SetPolicy("compact");
+  auto selected = aff.selectCPUs();
+  std::set<int> first_cores;
+  for (size_t i = 0; i < cores.size() && i < selected.size(); ++i) {
+    for (auto const &cpu : aff.GetCPUs()) {
+      if (cpu.id == selected[i]) first_cores.insert(cpu.socket * 100000 +
+                                                    cpu.core);
+    }
+  }
+
+  if (all.empty() || toSet(selected) != all || first_cores != cores) {
+    std::cerr << "Unexpected compact selection "
+              << Affinity::FormatCPUList(selected) << std::endl;
+    status = 1;
+  }
+
+  // scatter starts on the first socket
+  aff.SetPolicy("scatter");
+  if (toSet(aff.selectCPUs()) != socket0) {
+    std::cerr << "Unexpected scatter selection" << std::endl;
+    status = 1;
+  }
+
+  // bind to cpus the process may use, and place threads on them
+  std::string inherited = aff.GetBinding();
+  auto allowed = Affinity::ParseCPUList(inherited);
+  std::string policy = std::to_string(allowed.front());
+  if (allowed.size() > 1) policy += "," + std::to_string(allowed.back());
+
+  aff.SetPolicy(policy);
+  if (!aff.BindRank() || aff.GetBinding() != Affinity::FormatCPUList(
+                                                 aff.GetRankCPUs())) {
+    std::cerr << "Rank not bound to " << policy << ": " << aff.GetBinding()
+              << std::endl;
+    status = 1;
+  }
+
+  auto const &rank_cpus = aff.GetRankCPUs();
+  for (int tid = 0; tid < 3; ++tid) {
+    int expected = rank_cpus[tid % rank_cpus.size()];
+    if (!aff.BindThread(tid) ||
+        aff.GetBinding() != std::to_string(expected)) {
+      std::cerr << "Thread " << tid << " bound to " << aff.GetBinding()
+                << std::endl;
+      status = 1;
+    }
+  }
+
+  if (aff.BindThread(-1)) {
+    std::cerr << "Negative thread index bound" << std::endl;
+    status = 1;
+  }
+
+  // the inherited binding is taken over as is with "none"
+  aff.SetPolicy(inherited);
+  aff.BindRank();
+  aff.SetPolicy("none");
+  if (!aff.BindRank() || aff.GetBinding() != inherited ||
+      Affinity::FormatCPUList(aff.GetRankCPUs()) != inherited) {
+    std::cerr << "Binding not kept with none" << std::endl;
+    status = 1;
+  }
+
+  Application::Destroy();
+  return status;
+}
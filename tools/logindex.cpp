@@ -0,0 +1,120 @@
+// C/C++
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// application
+#include <application/exceptions.hpp>
+#include <application/log_index.hpp>
+
+static void usage(char const* prog) {
+  std::cout << "Usage: " << prog << " query [options] <file>\n"
+            << "       " << prog << " merge [options] <file> ...\n"
+            << "Write the records of indexed log files (written with -x),\n"
+            << "query in file order, merge in time order.\n"
+            << "Options:\n"
+            << "  -m <monitor>    records of this monitor only\n"
+            << "  -s <section>    records in this section, e.g. 4.2\n"
+            << "  -t <from,to>    records in this time range; times are\n"
+            << "                  local YYYY-mm-ddTHH:MM:SS[.fff] or seconds\n"
+            << "                  since the epoch, either may be empty\n"
+            << "  -h              this help\n";
+}
+
+//! Parse a time into nanoseconds since the epoch
+static uint64_t parseTime(std::string const& str) {
+  if (str.find('-') == std::string::npos) {
+    return static_cast<uint64_t>(std::strtod(str.c_str(), nullptr) * 1.e9);
+  }
+
+  struct tm local_time;
+  std::memset(&local_time, 0, sizeof(local_time));
+  char const* rest = strptime(str.c_str(), "%Y-%m-%dT%H:%M:%S", &local_time);
+  if (rest == nullptr) {
+    throw RuntimeError("logindex", "Cannot parse time " + str);
+  }
+
+  local_time.tm_isdst = -1;
+  uint64_t time = static_cast<uint64_t>(mktime(&local_time)) * 1000000000;
+  if (*rest == '.') time += std::strtod(rest, nullptr) * 1.e9;
+
+  return time;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2 || std::strcmp(argv[1], "-h") == 0) {
+    usage(argv[0]);
+    return argc < 2;
+  }
+
+  std::string command = argv[1];
+  if (command != "query" && command != "merge") {
+    usage(argv[0]);
+    return 1;
+  }
+
+  IndexQuery query;
+  std::vector<std::string> fnames;
+
+  try {
+    for (int i = 2; i < argc; ++i) {
+      std::string arg = argv[i];
+
+      if (arg.size() == 2 && arg[0] == '-') {
+        if (arg[1] == 'h') {
+          usage(argv[0]);
+          return 0;
+        }
+
+        if (i + 1 >= argc) {
+          throw RuntimeError("logindex", arg + " must be followed by a value");
+        }
+        std::string value = argv[++i];
+
+        switch (arg[1]) {
+          case 'm':
+            query.monitor = value;
+            break;
+          case 's':
+            query.section = value;
+            break;
+          case 't': {
+            auto comma = value.find(',');
+            if (comma == std::string::npos) {
+              throw RuntimeError("logindex", "-t takes from,to");
+            }
+            if (comma > 0) query.tmin = parseTime(value.substr(0, comma));
+            if (comma + 1 < value.size()) {
+              query.tmax = parseTime(value.substr(comma + 1));
+            }
+            break;
+          }
+          default:
+            throw RuntimeError("logindex", "Unknown option " + arg);
+        }
+      } else {
+        fnames.push_back(arg);
+      }
+    }
+
+    if (fnames.empty() || (command == "query" && fnames.size() != 1)) {
+      usage(argv[0]);
+      return 1;
+    }
+
+    if (command == "query") {
+      LogIndex(fnames[0]).Query(query, std::cout);
+    } else {
+      LogIndex::Merge(fnames, query, std::cout);
+    }
+  } catch (ExceptionBase const& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
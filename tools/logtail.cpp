@@ -0,0 +1,85 @@
+// C/C++
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// POSIX C extensions
+#include <unistd.h>  // access()
+
+// application
+#include <application/exceptions.hpp>
+#include <application/shm_ring.hpp>
+
+static void usage(char const* prog) {
+  std::cout << "Usage: " << prog << " [options] <ring>\n"
+            << "Write the records of a shared-memory log ring, e.g. of a\n"
+            << "monitor installed on \"shm:hydro\", without disturbing the\n"
+            << "writer. The ring is a name in /dev/shm.\n"
+            << "Options:\n"
+            << "  -f              keep following new records until the\n"
+            << "                  ring is removed\n"
+            << "  -s <seconds>    poll interval when following [0.1]\n"
+            << "  -h              this help\n";
+}
+
+int main(int argc, char** argv) {
+  bool follow = false;
+  double interval = 0.1;
+  std::string name;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-h") {
+      usage(argv[0]);
+      return 0;
+    } else if (arg == "-f") {
+      follow = true;
+    } else if (arg == "-s" && i + 1 < argc) {
+      interval = std::strtod(argv[++i], nullptr);
+    } else if (arg[0] != '-' && name.empty()) {
+      name = arg;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (name.empty()) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // accept the path of the ring as well
+  if (name.compare(0, 9, "/dev/shm/") == 0) name = name.substr(8);
+
+  try {
+    auto ring = ShmRing::Attach(name);
+    std::string path = "/dev/shm" + ring->GetName();
+
+    uint64_t pos = 0;
+    std::string records;
+    for (;;) {
+      records.clear();
+      uint64_t lost = ring->Read(&pos, &records);
+
+      if (lost > 0) {
+        std::cout << std::flush;
+        std::cerr << "logtail: " << lost << " bytes overwritten" << std::endl;
+      }
+      std::cout << records << std::flush;
+
+      // the writer removes the ring when it is done
+      if (!follow || access(path.c_str(), F_OK) != 0) break;
+
+      std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+    }
+  } catch (ExceptionBase const& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}